@@ -0,0 +1,59 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/*
+** AXIS ALIGNED BOUNDING BOX
+** The box between two corners, lower <= upper on every axis. Used by the
+** broadphases to cull the pairs that cannot touch.
+*/
+struct Aabb
+{
+	glm::vec3 lower;
+	glm::vec3 upper;
+
+	Aabb() : lower(0.0f), upper(0.0f) {}
+	Aabb(const glm::vec3 &lower, const glm::vec3 &upper) : lower(lower), upper(upper) {}
+
+	glm::vec3 getCentre() const { return 0.5f * (lower + upper); }
+	glm::vec3 getExtent() const { return upper - lower; }
+	// half the surface area, the insertion cost of the tree only compares areas
+	float getPerimeter() const
+	{
+		glm::vec3 e = upper - lower;
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	bool overlaps(const Aabb &b) const
+	{
+		return lower.x <= b.upper.x && b.lower.x <= upper.x
+			&& lower.y <= b.upper.y && b.lower.y <= upper.y
+			&& lower.z <= b.upper.z && b.lower.z <= upper.z;
+	}
+	bool contains(const Aabb &b) const
+	{
+		return lower.x <= b.lower.x && lower.y <= b.lower.y && lower.z <= b.lower.z
+			&& b.upper.x <= upper.x && b.upper.y <= upper.y && b.upper.z <= upper.z;
+	}
+
+	// grown by margin on every side
+	Aabb fattened(float margin) const { return Aabb(lower - margin, upper + margin); }
+	// smallest box around both
+	static Aabb merge(const Aabb &a, const Aabb &b) { return Aabb(glm::min(a.lower, b.lower), glm::max(a.upper, b.upper)); }
+
+	// box around this box after the affine transform m
+	Aabb transformed(const glm::mat4 &m) const
+	{
+		// the centre is transformed, the half extent is taken through |m|
+		glm::vec3 centre = glm::vec3(m * glm::vec4(getCentre(), 1.0f));
+		glm::vec3 half = 0.5f * getExtent();
+		glm::vec3 radius = glm::abs(glm::vec3(m[0])) * half.x + glm::abs(glm::vec3(m[1])) * half.y + glm::abs(glm::vec3(m[2])) * half.z;
+		return Aabb(centre - radius, centre + radius);
+	}
+};
+
+// two boxes (usually of two bodies) that overlap, a < b
+struct BodyPair
+{
+	unsigned int a;
+	unsigned int b;
+};
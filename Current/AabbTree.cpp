@@ -0,0 +1,262 @@
+#include <algorithm>
+#include "AabbTree.h"
+
+thread_local std::vector<int> AabbTree::s_stack;
+
+// fat boxes also reach this many steps of displacement ahead
+static const float DISPLACEMENT_MULTIPLIER = 2.0f;
+
+AabbTree::AabbTree()
+{
+	m_root = NULL_NODE;
+	m_freeList = NULL_NODE;
+	m_proxyCount = 0;
+	m_margin = 0.1f;
+}
+
+AabbTree::~AabbTree()
+{
+}
+
+/*
+** NODE POOL
+*/
+int AabbTree::allocateNode()
+{
+	// grow the pool and chain the new nodes onto the free list
+	if (m_freeList == NULL_NODE)
+	{
+		int first = (int)m_nodes.size();
+		m_nodes.resize(std::max<size_t>(16, 2 * m_nodes.size()));
+		for (int i = first; i < (int)m_nodes.size(); i++)
+		{
+			m_nodes[i].parent = i + 1 < (int)m_nodes.size() ? i + 1 : NULL_NODE;
+			m_nodes[i].height = -1;
+		}
+		m_freeList = first;
+	}
+
+	int node = m_freeList;
+	m_freeList = m_nodes[node].parent;
+	m_nodes[node].parent = NULL_NODE;
+	m_nodes[node].child1 = NULL_NODE;
+	m_nodes[node].child2 = NULL_NODE;
+	m_nodes[node].height = 0;
+	m_nodes[node].userData = 0;
+	return node;
+}
+
+void AabbTree::freeNode(int node)
+{
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+/*
+** PROXIES
+*/
+int AabbTree::createProxy(const Aabb &box, unsigned int userData)
+{
+	int proxy = allocateNode();
+	m_nodes[proxy].box = box.fattened(m_margin);
+	m_nodes[proxy].userData = userData;
+	insertLeaf(proxy);
+	m_proxyCount++;
+	return proxy;
+}
+
+void AabbTree::destroyProxy(int proxy)
+{
+	removeLeaf(proxy);
+	freeNode(proxy);
+	m_proxyCount--;
+}
+
+bool AabbTree::moveProxy(int proxy, const Aabb &box, const glm::vec3 &displacement)
+{
+	if (m_nodes[proxy].box.contains(box))
+		return false;
+
+	// grow the box towards where the body is heading
+	Aabb fat = box.fattened(m_margin);
+	glm::vec3 d = DISPLACEMENT_MULTIPLIER * displacement;
+	fat.lower += glm::min(d, glm::vec3(0.0f));
+	fat.upper += glm::max(d, glm::vec3(0.0f));
+
+	removeLeaf(proxy);
+	m_nodes[proxy].box = fat;
+	insertLeaf(proxy);
+	return true;
+}
+
+/*
+** INSERT AND REMOVE
+*/
+
+// walk down to the sibling that costs the least area to pair with the leaf,
+// put both under a new parent and refit and rebalance the way back up
+void AabbTree::insertLeaf(int leaf)
+{
+	if (m_root == NULL_NODE)
+	{
+		m_root = leaf;
+		m_nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	const Aabb leafBox = m_nodes[leaf].box;
+	int index = m_root;
+	while (!m_nodes[index].isLeaf())
+	{
+		const Node &node = m_nodes[index];
+		float area = node.box.getPerimeter();
+		float combinedArea = Aabb::merge(node.box, leafBox).getPerimeter();
+
+		// cost of a new parent here, and the growth every level below pays
+		float cost = 2.0f * combinedArea;
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		// cost of descending into each child
+		float childCost[2];
+		const int children[2] = { node.child1, node.child2 };
+		for (int k = 0; k < 2; k++)
+		{
+			const Node &child = m_nodes[children[k]];
+			float merged = Aabb::merge(leafBox, child.box).getPerimeter();
+			if (child.isLeaf())
+				childCost[k] = merged + inheritanceCost;
+			else
+				childCost[k] = merged - child.box.getPerimeter() + inheritanceCost;
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+	// new parent for the sibling and the leaf
+	int sibling = index;
+	int oldParent = m_nodes[sibling].parent;
+	int newParent = allocateNode();
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].box = Aabb::merge(leafBox, m_nodes[sibling].box);
+	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].child1 = sibling;
+	m_nodes[newParent].child2 = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent == NULL_NODE)
+		m_root = newParent;
+	else if (m_nodes[oldParent].child1 == sibling)
+		m_nodes[oldParent].child1 = newParent;
+	else
+		m_nodes[oldParent].child2 = newParent;
+
+	// refit the ancestors
+	index = m_nodes[leaf].parent;
+	while (index != NULL_NODE)
+	{
+		index = balance(index);
+
+		Node &node = m_nodes[index];
+		node.height = 1 + std::max(m_nodes[node.child1].height, m_nodes[node.child2].height);
+		node.box = Aabb::merge(m_nodes[node.child1].box, m_nodes[node.child2].box);
+		index = node.parent;
+	}
+}
+
+// the leaf's sibling takes the place of their parent
+void AabbTree::removeLeaf(int leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = NULL_NODE;
+		return;
+	}
+
+	int parent = m_nodes[leaf].parent;
+	int grandParent = m_nodes[parent].parent;
+	int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	freeNode(parent);
+	if (grandParent == NULL_NODE)
+	{
+		m_root = sibling;
+		m_nodes[sibling].parent = NULL_NODE;
+		return;
+	}
+
+	if (m_nodes[grandParent].child1 == parent)
+		m_nodes[grandParent].child1 = sibling;
+	else
+		m_nodes[grandParent].child2 = sibling;
+	m_nodes[sibling].parent = grandParent;
+
+	int index = grandParent;
+	while (index != NULL_NODE)
+	{
+		index = balance(index);
+
+		Node &node = m_nodes[index];
+		node.height = 1 + std::max(m_nodes[node.child1].height, m_nodes[node.child2].height);
+		node.box = Aabb::merge(m_nodes[node.child1].box, m_nodes[node.child2].box);
+		index = node.parent;
+	}
+}
+
+/*
+** BALANCE
+*/
+
+// if one child of a is more than a level taller than the other, the taller
+// child c is rotated up into a's place: a takes the shorter of c's children
+// and c keeps a and the taller one. Returns the node now at a's place
+int AabbTree::balance(int a)
+{
+	Node &nodeA = m_nodes[a];
+	if (nodeA.isLeaf() || nodeA.height < 2)
+		return a;
+
+	const int b = nodeA.child1;
+	const int c = nodeA.child2;
+	const int difference = m_nodes[c].height - m_nodes[b].height;
+	if (difference >= -1 && difference <= 1)
+		return a;
+
+	// the taller child goes up, its sibling stays under a
+	const int up = difference > 0 ? c : b;
+	const int stay = difference > 0 ? b : c;
+	Node &nodeUp = m_nodes[up];
+	const int f = nodeUp.child1;
+	const int g = nodeUp.child2;
+
+	// up replaces a under a's parent
+	nodeUp.child1 = a;
+	nodeUp.parent = nodeA.parent;
+	nodeA.parent = up;
+	if (nodeUp.parent == NULL_NODE)
+		m_root = up;
+	else if (m_nodes[nodeUp.parent].child1 == a)
+		m_nodes[nodeUp.parent].child1 = up;
+	else
+		m_nodes[nodeUp.parent].child2 = up;
+
+	// the taller grandchild stays with up, the shorter one moves to a
+	const int tall = m_nodes[f].height > m_nodes[g].height ? f : g;
+	const int shortNode = tall == f ? g : f;
+	nodeUp.child2 = tall;
+	if (difference > 0)
+		nodeA.child2 = shortNode;
+	else
+		nodeA.child1 = shortNode;
+	m_nodes[shortNode].parent = a;
+
+	nodeA.box = Aabb::merge(m_nodes[stay].box, m_nodes[shortNode].box);
+	nodeA.height = 1 + std::max(m_nodes[stay].height, m_nodes[shortNode].height);
+	nodeUp.box = Aabb::merge(nodeA.box, m_nodes[tall].box);
+	nodeUp.height = 1 + std::max(nodeA.height, m_nodes[tall].height);
+
+	return up;
+}
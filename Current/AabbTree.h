@@ -0,0 +1,151 @@
+#pragma once
+#include <vector>
+#include "Aabb.h"
+
+/*
+** AABB TREE CLASS
+** Dynamic bounding volume tree for the rigid body broadphase. Each proxy
+** is a leaf holding a fat box, the body's box grown by a margin and by
+** its displacement over the step, so a body that moves a little stays
+** inside its leaf and the tree is only touched when it leaves it.
+** Inserting walks down to the sibling that grows the total box area the
+** least, and every node on the way back up is rebalanced with a tree
+** rotation when one child is more than one level taller than the other.
+** Queries descend only into the boxes they overlap, so finding every
+** overlapping pair of n proxies is O(n log n).
+** Nodes live in one array with a free list and proxies are node indices,
+** so creating and destroying proxies does not allocate once it has grown.
+*/
+class AabbTree
+{
+public:
+	static const int NULL_NODE = -1;
+
+	AabbTree();
+	~AabbTree();
+
+	/*
+	** GET AND SET METHODS
+	*/
+	float getMargin() const { return m_margin; }
+	const Aabb &getFatAabb(int proxy) const { return m_nodes[proxy].box; }
+	unsigned int getUserData(int proxy) const { return m_nodes[proxy].userData; }
+	unsigned int getProxyCount() const { return m_proxyCount; }
+	// longest path from the root to a leaf, 0 for a single leaf
+	int getHeight() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+
+	void setMargin(float margin) { m_margin = margin; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// add a leaf for the box, userData is handed back by queries
+	int createProxy(const Aabb &box, unsigned int userData);
+	void destroyProxy(int proxy);
+	// the proxy's box is now box and moved by displacement in the last step.
+	// Returns true if it left its fat box and was reinserted
+	bool moveProxy(int proxy, const Aabb &box, const glm::vec3 &displacement);
+
+	// callback(userData) for every proxy whose fat box overlaps box
+	template <class Callback>
+	void query(const Aabb &box, Callback callback) const;
+	// callback(userDataA, userDataB) once for every pair of overlapping fat boxes
+	template <class Callback>
+	void queryPairs(Callback callback) const;
+
+private:
+	struct Node
+	{
+		Aabb box;
+		unsigned int userData;
+		int parent;			// next free node when on the free list
+		int child1;
+		int child2;
+		int height;			// 0 for a leaf, -1 when free
+
+		bool isLeaf() const { return child1 == NULL_NODE; }
+	};
+
+	int allocateNode();
+	void freeNode(int node);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	int balance(int a);
+
+	std::vector<Node> m_nodes;
+	int m_root;
+	int m_freeList;
+	unsigned int m_proxyCount;
+	float m_margin;		// fat boxes are grown by this on every side
+
+	// scratch for the traversals, one per thread
+	static thread_local std::vector<int> s_stack;
+};
+
+template <class Callback>
+void AabbTree::query(const Aabb &box, Callback callback) const
+{
+	if (m_root == NULL_NODE)
+		return;
+
+	std::vector<int> &stack = s_stack;
+	stack.clear();
+	stack.push_back(m_root);
+	while (!stack.empty())
+	{
+		const Node &node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!node.box.overlaps(box))
+			continue;
+
+		if (node.isLeaf())
+		{
+			callback(node.userData);
+		}
+		else
+		{
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+// each leaf queries the tree with its own box and keeps the leaves with a
+// higher index, so a pair is reported once
+template <class Callback>
+void AabbTree::queryPairs(Callback callback) const
+{
+	if (m_root == NULL_NODE)
+		return;
+
+	std::vector<int> stack;
+	for (int leaf = 0; leaf < (int)m_nodes.size(); leaf++)
+	{
+		const Node &self = m_nodes[leaf];
+		if (self.height != 0)
+			continue;
+
+		stack.clear();
+		stack.push_back(m_root);
+		while (!stack.empty())
+		{
+			int index = stack.back();
+			stack.pop_back();
+			const Node &node = m_nodes[index];
+			if (!node.box.overlaps(self.box))
+				continue;
+
+			if (node.isLeaf())
+			{
+				if (index > leaf)
+					callback(self.userData, node.userData);
+			}
+			else
+			{
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+	}
+}
@@ -0,0 +1,984 @@
+/*
+** PHYSICS STEP BENCHMARK
+** Runs the standard scenes at several sizes with no window and reports the
+** cost of a step and how it splits between the force, integration,
+** collision and response phases. Results are written as CSV (one row per
+** scene and size) so runs from different commits can be compared.
+** Built by the benchmark project with HEADLESS defined, like the headless driver.
+** With -jobs it instead measures the job system on its own: the cost of
+** scheduling an empty task for a few submission patterns. With -check it
+** runs consistency checks of the collision code against brute force or
+** exact answers, one row per check, and fails if any of them does.
+**
+** usage: benchmark [-scene name] [-size n] [-steps n] [-warmup n] [-dt seconds] [-integrator name] [-tolerance metres] [-simd level] [-broadphase name] [-iterations n] [-nosleep] [-threads n] [-jobs] [-check] [-out file]
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+#include "BoxCollision.h"
+#include "ContactCache.h"
+#include "DistanceField.h"
+#include "Gjk.h"
+#include "RigidWorld.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "Simd.h"
+#include "SweepAndPrune.h"
+
+using namespace std;
+
+// sizes each scene is run at unless -size is given
+static map<string, vector<unsigned int>> defaultSizes()
+{
+	map<string, vector<unsigned int>> sizes;
+	sizes["cloth"] = { 16, 32, 64, 128, 256 };
+	sizes["drape"] = { 32, 64, 128 };
+	sizes["dome"] = { 32, 64, 128 };
+	sizes["chain"] = { 100, 1000, 10000 };
+	sizes["boxes"] = { 1, 16, 64, 256 };
+	sizes["piles"] = { 50, 200 };
+	sizes["cloud"] = { 1000, 10000, 100000 };
+	sizes["gas"] = { 1000, 10000, 100000, 1000000 };
+	return sizes;
+}
+
+// print the command line options
+static void printUsage()
+{
+	cout << "usage: benchmark [-scene name] [-size n] [-steps n] [-warmup n] [-dt seconds] [-integrator name] [-tolerance metres] [-simd level] [-broadphase name] [-iterations n] [-nosleep] [-threads n] [-jobs] [-check] [-out file]" << endl;
+	cout << "  -scene   only run this scene (cloth, drape, dome, chain, boxes, piles, cloud, gas)" << endl;
+	cout << "  -size    only run this size" << endl;
+	cout << "  -steps   measured steps per run            default 200" << endl;
+	cout << "  -warmup  unmeasured steps before a run     default 20" << endl;
+	cout << "  -dt      fixed time step                    default 0.01" << endl;
+	cout << "  -integrator  particle integrator (euler, verlet, rk4, adaptive-...), boxes and piles always use euler" << endl;
+	cout << "  -tolerance   error allowed per step by the adaptive integrators, default 0.001" << endl;
+	cout << "  -simd    highest vector path to use (scalar, sse4.1, avx2)" << endl;
+	cout << "  -broadphase  body pair search of the box scenes (tree, sap, brute) default tree" << endl;
+	cout << "  -iterations  contact solver iterations of the box scenes default 10" << endl;
+	cout << "  -nosleep     keep every body of the box scenes awake" << endl;
+	cout << "  -threads force loop threads, 0 for all       default 1" << endl;
+	cout << "  -jobs    measure job scheduling overhead instead of the scenes" << endl;
+	cout << "  -check   run the collision consistency checks instead of the scenes" << endl;
+	cout << "  -out     also write the CSV to this file" << endl;
+}
+
+// a job that spawns two children until depth reaches zero, 2^(depth+1) - 1 jobs in all
+static void spawnTree(JobCounter &counter, unsigned int depth)
+{
+	if (depth == 0)
+		return;
+	for (int i = 0; i < 2; i++)
+	{
+		getJobSystem().submit([&counter, depth] { spawnTree(counter, depth - 1); }, &counter);
+	}
+}
+
+// time empty tasks through the job system, one CSV row per submission pattern
+static void runJobBenchmark(ofstream &out)
+{
+	JobSystem &jobs = getJobSystem();
+	const string threads = to_string(jobs.getThreadCount());
+
+	string header = "test,threads,tasks,ns_per_task";
+	cout << header << endl;
+	if (out.is_open())
+		out << header << endl;
+
+	auto report = [&](const string &test, unsigned int tasks, chrono::steady_clock::time_point start)
+	{
+		double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		string row = test + "," + threads + "," + to_string(tasks) + "," + to_string(1.0e9 * wall / tasks);
+		cout << row << endl;
+		if (out.is_open())
+			out << row << endl;
+	};
+
+	// independent jobs submitted from the main thread
+	{
+		const unsigned int tasks = 100000;
+		JobCounter counter;
+		auto start = chrono::steady_clock::now();
+		for (unsigned int i = 0; i < tasks; i++)
+		{
+			jobs.submit([] {}, &counter);
+		}
+		jobs.wait(counter);
+		report("submit", tasks, start);
+	}
+
+	// jobs submitted by jobs, spread by stealing
+	{
+		const unsigned int depth = 16;
+		JobCounter counter;
+		auto start = chrono::steady_clock::now();
+		jobs.submit([&counter, depth] { spawnTree(counter, depth); }, &counter);
+		jobs.wait(counter);
+		report("spawn_tree", (2u << depth) - 1, start);
+	}
+
+	// each job waits on the one before through a dependency counter
+	{
+		const unsigned int tasks = 20000;
+		vector<JobCounter> counters(tasks);
+		auto start = chrono::steady_clock::now();
+		jobs.submit([] {}, &counters[0]);
+		for (unsigned int i = 1; i < tasks; i++)
+		{
+			jobs.submitAfter(counters[i - 1], [] {}, &counters[i]);
+		}
+		jobs.wait(counters[tasks - 1]);
+		report("dependency_chain", tasks, start);
+		for (JobCounter &counter : counters)
+		{
+			jobs.wait(counter);
+		}
+	}
+
+	// empty chunks of a parallel for with the smallest grain
+	{
+		const unsigned int tasks = 1000000;
+		auto start = chrono::steady_clock::now();
+		jobs.parallelFor(0, tasks, 1, [](unsigned int, unsigned int) {});
+		report("parallel_for_chunk", tasks, start);
+	}
+}
+
+/*
+** CHECKS
+*/
+
+// the pairs reported added and removed by an update must be exactly the
+// change in the overlapping pairs, which must be those brute force finds
+static bool checkPairChanges(const SweepAndPrune &sap, const vector<Aabb> &boxes, set<pair<unsigned int, unsigned int>> &pairs)
+{
+	set<pair<unsigned int, unsigned int>> now;
+	for (unsigned int a = 0; a < boxes.size(); a++)
+	{
+		for (unsigned int b = a + 1; b < boxes.size(); b++)
+		{
+			if (boxes[a].overlaps(boxes[b]))
+				now.insert(make_pair(a, b));
+		}
+	}
+
+	set<pair<unsigned int, unsigned int>> found;
+	for (const BodyPair &p : sap.getPairs())
+	{
+		found.insert(make_pair(p.a, p.b));
+	}
+	bool ok = found == now && sap.getPairs().size() == now.size();
+
+	set<pair<unsigned int, unsigned int>> expected = pairs;
+	for (const BodyPair &p : sap.getRemovedPairs())
+	{
+		ok = ok && expected.erase(make_pair(p.a, p.b)) == 1;
+	}
+	for (const BodyPair &p : sap.getAddedPairs())
+	{
+		ok = ok && expected.insert(make_pair(p.a, p.b)).second;
+	}
+	pairs = now;
+	return ok && expected == now;
+}
+
+// a box passing right through another in one update swaps the ends of the
+// pair one way and back, which must report nothing, then random jumps
+static bool checkSweepAndPrune()
+{
+	SweepAndPrune sap;
+	set<pair<unsigned int, unsigned int>> pairs;
+	vector<Aabb> boxes = { Aabb(glm::vec3(0.0f), glm::vec3(1.0f)), Aabb(glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(3.0f, 1.0f, 1.0f)) };
+	bool ok = true;
+	const float passes[] = { -3.0f, 2.0f, 0.5f, -3.0f, 0.5f, 2.0f };
+	for (unsigned int k = 0; k <= sizeof(passes) / sizeof(passes[0]); k++)
+	{
+		if (k > 0)
+			boxes[1] = Aabb(glm::vec3(passes[k - 1], 0.0f, 0.0f), glm::vec3(passes[k - 1] + 1.0f, 1.0f, 1.0f));
+		sap.update(boxes.data(), (unsigned int)boxes.size());
+		ok = ok && checkPairChanges(sap, boxes, pairs);
+		// passing through leaves nothing to report
+		if (k == 1 || k == 2)
+			ok = ok && sap.getAddedPairs().empty() && sap.getRemovedPairs().empty();
+	}
+
+	mt19937 generator(0);
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto randomBox = [&]()
+	{
+		const glm::vec3 lower(4.0f * unit(generator), 4.0f * unit(generator), 4.0f * unit(generator));
+		return Aabb(lower, lower + glm::vec3(unit(generator), unit(generator), unit(generator)));
+	};
+	boxes.clear();
+	for (unsigned int update = 0; update < 200; update++)
+	{
+		// a few boxes join and every other one jumps anywhere
+		for (unsigned int b = 0; b < 4 && boxes.size() < 64; b++)
+		{
+			boxes.push_back(randomBox());
+		}
+		for (unsigned int b = update % 2; b < boxes.size(); b += 2)
+		{
+			boxes[b] = randomBox();
+		}
+		sap.update(boxes.data(), (unsigned int)boxes.size());
+		ok = ok && checkPairChanges(sap, boxes, pairs);
+	}
+	return ok;
+}
+
+// the field baked from the sphere mesh against the exact distance to the
+// sphere, in a shell through the band around it. The mesh's flat faces
+// lie inside the sphere by up to the sagitta of a patch, which bounds the
+// error with a little over for the blend between samples. The sign must
+// hold, the gradient point away from the centre where none of the blended
+// samples is clamped to the band, and lookups away from the surface say so
+static bool checkDistanceField()
+{
+	const float radius = 0.6f;
+	const glm::vec3 centre(0.2f, 0.7f, -0.1f);
+	const float cellSize = radius / 48.0f;
+	const float band = 4.0f * cellSize;
+	Mesh sphere(Mesh::SPHERE);
+	sphere.scale(glm::vec3(radius));
+	sphere.setPos(centre);
+	DistanceField field;
+	field.bake(sphere, cellSize, band);
+
+	// the widest patch of the mesh spans one latitude step at the equator
+	const float sagitta = radius * (1.0f - std::cos(glm::pi<float>() / 24.0f));
+	const float tolerance = sagitta + 0.25f * cellSize;
+
+	mt19937 generator(0);
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	bool ok = field.getBrickCount() > 0;
+	for (unsigned int k = 0; k < 100000 && ok; k++)
+	{
+		glm::vec3 direction(unit(generator), unit(generator), unit(generator));
+		if (glm::length(direction) < 0.1f)
+			continue;
+		direction = glm::normalize(direction);
+		const float exact = 0.9f * band * unit(generator);
+		const glm::vec3 p = centre + (radius + exact) * direction;
+
+		float distance;
+		glm::vec3 gradient;
+		// within the sagitta of the surface the mesh may put p on either side
+		ok = field.sample(p, distance, gradient)
+			&& std::fabs(distance - exact) <= tolerance
+			&& (std::fabs(exact) <= tolerance || (distance > 0.0f) == (exact > 0.0f))
+			&& (std::fabs(exact) >= band - 2.0f * cellSize || glm::dot(gradient, direction) > 0.99f * glm::length(gradient));
+	}
+
+	// the centre and points well outside are beyond the band, as are points
+	// far off the grid and ones that are not a number
+	float distance;
+	glm::vec3 gradient;
+	ok = ok && !field.sample(centre, distance, gradient) && !field.sample(centre + glm::vec3(2.0f * radius, 0.0f, 0.0f), distance, gradient);
+	ok = ok && !field.sample(glm::vec3(1e30f, 0.0f, 0.0f), distance, gradient) && !field.sample(glm::vec3(0.0f, -1e30f, 0.0f), distance, gradient);
+	ok = ok && !field.sample(glm::vec3(0.0f, 0.0f, std::numeric_limits<float>::infinity()), distance, gradient);
+	ok = ok && !field.sample(glm::vec3(std::numeric_limits<float>::quiet_NaN()), distance, gradient);
+	return ok;
+}
+
+// a baked field saved and loaded back samples the same as the one baked,
+// bit for bit, through the band and away from it. A file cut short, one
+// asked for under another hash and one that is missing are all turned away
+// and leave the loaded field as it was
+static bool checkDistanceFieldFile()
+{
+	const float radius = 0.6f;
+	const glm::vec3 centre(0.2f, 0.7f, -0.1f);
+	const float cellSize = radius / 24.0f;
+	Mesh sphere(Mesh::SPHERE);
+	sphere.scale(glm::vec3(radius));
+	sphere.setPos(centre);
+	DistanceField baked;
+	baked.bake(sphere, cellSize, 4.0f * cellSize);
+
+	const string fileName = "distance_field_check.sdf";
+	const string truncatedName = "distance_field_check_truncated.sdf";
+	DistanceField loaded;
+	bool ok = baked.save(fileName) && loaded.load(fileName, baked.getHash());
+
+	// every byte of the file but the last
+	ifstream file(fileName.c_str(), ios::binary);
+	const string bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	file.close();
+	ofstream truncated(truncatedName.c_str(), ios::binary);
+	truncated.write(bytes.data(), bytes.size() - 1);
+	truncated.close();
+	ok = ok && !bytes.empty() && !loaded.load(truncatedName, baked.getHash());
+	ok = ok && !loaded.load(fileName, baked.getHash() + 1) && !loaded.load("distance_field_check_missing.sdf", baked.getHash());
+	remove(fileName.c_str());
+	remove(truncatedName.c_str());
+
+	ok = ok && loaded.getHash() == baked.getHash() && loaded.getBrickCount() == baked.getBrickCount() && loaded.getGridBrickCount() == baked.getGridBrickCount();
+	mt19937 generator(0);
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (unsigned int k = 0; k < 100000 && ok; k++)
+	{
+		const glm::vec3 p = centre + 1.5f * radius * glm::vec3(unit(generator), unit(generator), unit(generator));
+		float bakedDistance = 0.0f, loadedDistance = 0.0f;
+		glm::vec3 bakedGradient(0.0f), loadedGradient(0.0f);
+		const bool inBand = baked.sample(p, bakedDistance, bakedGradient);
+		ok = loaded.sample(p, loadedDistance, loadedGradient) == inBand && (!inBand || (loadedDistance == bakedDistance && loadedGradient == bakedGradient));
+	}
+	return ok;
+}
+
+// exact distance from point p to a box, negative inside by the distance to
+// the nearest face, and the direction from the box to p it is measured along
+static float boxDistance(const OrientedBox &box, const glm::vec3 &p, glm::vec3 &normal)
+{
+	const glm::vec3 local = glm::transpose(box.axes) * (p - box.centre);
+	const glm::vec3 outside = local - glm::clamp(local, -box.halfExtents, box.halfExtents);
+	if (glm::dot(outside, outside) > 0.0f)
+	{
+		normal = box.axes * glm::normalize(outside);
+		return glm::length(outside);
+	}
+	const glm::vec3 inside = glm::abs(local) - box.halfExtents;
+	const int axis = inside.x > inside.y ? (inside.x > inside.z ? 0 : 2) : (inside.y > inside.z ? 1 : 2);
+	normal = box.axes[axis] * (local[axis] < 0.0f ? -1.0f : 1.0f);
+	return inside[axis];
+}
+
+// GJK distances and EPA depths of random sphere-sphere and box-sphere pairs
+// against the exact ones, with the normal along the line of centres or out
+// of the box, and the point reported on B on the surface of its sphere.
+// Pairs about to touch, or with the sphere's centre near two faces of the
+// box at once, have no single right normal and are left out, as are overlaps
+// deeper than contacts get, where EPA's polytope of a sphere is coarse
+static bool checkGjk()
+{
+	mt19937 generator(0);
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	SphereShape sphere(1.0f);
+	BoxShape box(glm::vec3(1.0f));
+	bool ok = true;
+	for (unsigned int k = 0; k < 5000 && ok; k++)
+	{
+		const float radiusA = 0.2f + 0.5f * (unit(generator) + 1.0f);
+		const float radiusB = 0.2f + 0.5f * (unit(generator) + 1.0f);
+		const glm::vec3 centreB = 1.5f * glm::vec3(unit(generator), unit(generator), unit(generator));
+		const glm::vec3 axis = glm::vec3(unit(generator), unit(generator), unit(generator)) + glm::vec3(0.0f, 0.0f, 1.5f);
+		const glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), 3.0f * unit(generator), glm::normalize(axis));
+		const glm::mat4 boxModel = glm::scale(rotation, glm::vec3(radiusA, 0.5f * radiusA + 0.1f, radiusB));
+
+		// sphere A at the origin, or a box turned about it, and sphere B around it
+		const PlacedShape sphereA(&sphere, glm::scale(glm::mat4(1.0f), glm::vec3(radiusA)));
+		const PlacedShape boxA(&box, boxModel);
+		const PlacedShape sphereB(&sphere, glm::scale(glm::translate(glm::mat4(1.0f), centreB), glm::vec3(radiusB)));
+		for (unsigned int pair = 0; pair < 2; pair++)
+		{
+			glm::vec3 normal = glm::normalize(centreB);
+			float exact = glm::length(centreB) - radiusA - radiusB;
+			if (pair == 1)
+			{
+				const OrientedBox oriented(glm::vec3(1.0f), boxModel);
+				exact = boxDistance(oriented, centreB, normal) - radiusB;
+				const glm::vec3 faces = glm::abs(glm::transpose(oriented.axes) * centreB) - oriented.halfExtents;
+				const float second = faces.x + faces.y + faces.z - std::min(faces.x, std::min(faces.y, faces.z)) - std::max(faces.x, std::max(faces.y, faces.z));
+				if (std::max(faces.x, std::max(faces.y, faces.z)) < 0.0f && std::max(faces.x, std::max(faces.y, faces.z)) - second < 0.05f)
+					continue;
+			}
+			if (std::fabs(exact) < 0.01f || exact < -0.3f)
+				continue;
+
+			GjkResult result;
+			const bool intersecting = computePenetration(pair == 0 ? sphereA : boxA, sphereB, nullptr, result);
+			ok = intersecting == (exact < 0.0f)
+				&& std::fabs((intersecting ? -result.depth : result.distance) - exact) <= 2.0e-3f
+				&& glm::dot(result.normal, normal) > 0.999f
+				&& std::fabs(glm::length(result.pointB - centreB) - radiusB) <= 2.0e-3f;
+		}
+	}
+	return ok;
+}
+
+// true if p lies within the box grown by margin
+static bool insideBox(const OrientedBox &box, const glm::vec3 &p, float margin)
+{
+	const glm::vec3 local = glm::abs(glm::transpose(box.axes) * (p - box.centre));
+	return glm::all(glm::lessThanEqual(local, box.halfExtents + margin));
+}
+
+// the separating axis test on boxes placed so the answer is known: a small
+// box resting turned on a large one gives its four bottom corners, a large
+// box turned on a small one the four points kept of their clipped overlap,
+// two boxes on edge crossed at right angles the one point where the edges
+// cross, and boxes just apart nothing. Points lie halfway between the faces
+static bool checkBoxCollision()
+{
+	const float depth = 0.1f;
+	const glm::vec3 up(0.0f, 1.0f, 0.0f);
+	const OrientedBox ground(glm::vec3(1.0f, 0.5f, 1.0f), glm::mat4(1.0f));
+	bool ok = true;
+
+	// face on face, every corner of the small box's bottom inside the top of the large one
+	const glm::mat4 small = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.2f, 1.0f - depth, -0.1f)), 0.3f, up);
+	const OrientedBox resting(glm::vec3(0.5f), small);
+	ContactManifold manifold;
+	ok = ok && collideBoxes(ground, resting, manifold) && manifold.count == 4 && glm::dot(manifold.normal, up) > 0.9999f;
+	for (unsigned int k = 0; k < manifold.count && ok; k++)
+	{
+		const ContactPoint &point = manifold.points[k];
+		bool corner = false;
+		for (unsigned int c = 0; c < 8; c++)
+		{
+			const glm::vec3 bottom = resting.getCorner(c);
+			corner = corner || glm::length(glm::vec3(bottom.x, 0.5f - 0.5f * depth, bottom.z) - point.position) < 1.0e-4f;
+		}
+		ok = corner && std::fabs(point.depth - depth) < 1.0e-4f;
+	}
+
+	// the large box turned on a small one overlaps it in an octagon
+	const OrientedBox post(glm::vec3(0.3f, 0.5f, 0.3f), glm::mat4(1.0f));
+	const glm::mat4 large = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f - depth, 0.0f)), glm::quarter_pi<float>(), up);
+	const OrientedBox slab(glm::vec3(0.5f), large);
+	ok = ok && collideBoxes(post, slab, manifold) && manifold.count == 4 && glm::dot(manifold.normal, up) > 0.9999f;
+	for (unsigned int k = 0; k < manifold.count && ok; k++)
+	{
+		const ContactPoint &point = manifold.points[k];
+		ok = std::fabs(point.depth - depth) < 1.0e-4f && std::fabs(point.position.y - (0.5f - 0.5f * depth)) < 1.0e-4f
+			&& insideBox(post, point.position, 1.0e-4f) && insideBox(slab, point.position, depth);
+	}
+
+	// edge on edge, the lower box's top edge runs along z and the upper box's bottom edge along x
+	const float diagonal = glm::root_two<float>() * 0.5f;
+	const OrientedBox lower(glm::vec3(0.5f), glm::rotate(glm::mat4(1.0f), glm::quarter_pi<float>(), glm::vec3(0.0f, 0.0f, 1.0f)));
+	const glm::mat4 crossed = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f * diagonal - depth, 0.0f)), glm::quarter_pi<float>(), glm::vec3(1.0f, 0.0f, 0.0f));
+	const OrientedBox upper(glm::vec3(0.5f), crossed);
+	ok = ok && collideBoxes(lower, upper, manifold) && manifold.count == 1 && glm::dot(manifold.normal, up) > 0.9999f
+		&& std::fabs(manifold.points[0].depth - depth) < 1.0e-4f
+		&& glm::length(manifold.points[0].position - glm::vec3(0.0f, diagonal - 0.5f * depth, 0.0f)) < 1.0e-4f;
+
+	// lifted clear of each other
+	const OrientedBox apart(glm::vec3(0.5f), glm::translate(glm::mat4(1.0f), 2.0f * depth * up) * crossed);
+	ok = ok && !collideBoxes(lower, apart, manifold);
+	return ok;
+}
+
+// a rigid world of boxes under gravity on the ground, the bodies are handed
+// to the world by start() once none will be added
+struct BoxWorld
+{
+	Gravity gravity;
+	BoxShape shape;
+	vector<RigidBody> bodies;
+	RigidWorld world;
+
+	BoxWorld() : gravity(glm::vec3(0.0f, -9.8f, 0.0f)), shape(glm::vec3(1.0f)) {}
+
+	// a box of the given half extents at pos, returns its index
+	unsigned int add(const glm::vec3 &pos, const glm::vec3 &halfExtents)
+	{
+		RigidBody rb = RigidBody();
+		rb.setMesh(Mesh(Mesh::CUBE));
+		rb.setShape(&shape);
+		rb.setMass(2.0f);
+		rb.scale(halfExtents);
+		rb.translate(pos);
+		bodies.push_back(rb);
+		return (unsigned int)bodies.size() - 1;
+	}
+
+	void start()
+	{
+		for (RigidBody &rb : bodies)
+		{
+			rb.addForce(&gravity);
+			world.addBody(&rb);
+		}
+		world.setGroundHeight(0.0f);
+		world.setCor(0.2f);
+	}
+
+	void run(unsigned int steps)
+	{
+		for (unsigned int i = 0; i < steps; i++)
+		{
+			world.step(0.01f);
+		}
+	}
+};
+
+// a column of boxes set down exactly on top of each other must settle
+// where it is with sleeping off: after five seconds every box moves slower
+// than a body that may sleep, has sunk by no more than the solver's 5 mm
+// slop per contact below it, and has neither slid nor tipped
+static bool checkStack()
+{
+	BoxWorld stack;
+	const unsigned int height = 8;
+	for (unsigned int j = 0; j < height; j++)
+	{
+		stack.add(glm::vec3(0.0f, 1.0f + 2.0f * j, 0.0f), glm::vec3(1.0f));
+	}
+	stack.start();
+	stack.world.setSleeping(false);
+	stack.run(500);
+
+	bool ok = true;
+	for (unsigned int j = 0; j < height; j++)
+	{
+		RigidBody &rb = stack.bodies[j];
+		const float sunk = 1.0f + 2.0f * j - rb.getPos().y;
+		ok = ok && glm::length(rb.getVel()) < 0.05f && glm::length(rb.getAngVel()) < 0.05f
+			&& sunk >= 0.0f && sunk <= 0.005f * (j + 1)
+			&& glm::length(glm::vec2(rb.getPos().x, rb.getPos().z)) < 0.05f
+			&& glm::mat3(rb.getMesh().getRotate())[1][1] > 0.999f;
+	}
+	return ok;
+}
+
+// the contact cache on its own and in a world. Impulses go to the new point
+// with the same id, else to the nearest unclaimed old point close enough,
+// else nowhere. A manifold stored in the frame of a is still valid and is
+// carried along while both bodies move together, but not once b moves or
+// turns against a. In a settled stack every touching pair takes its last
+// manifold instead of being tested, with all four points warm started, and
+// a box lifted off the top is tested again and dropped
+static bool checkContactCache()
+{
+	ContactManifold old;
+	old.count = 3;
+	for (unsigned int k = 0; k < old.count; k++)
+	{
+		old.points[k] = ContactPoint{ glm::vec3((float)k, 0.0f, 0.0f), 0.01f, k + 1 };
+		old.points[k].normalImpulse = (float)(k + 1);
+	}
+	ContactManifold manifold;
+	manifold.count = 4;
+	manifold.points[0] = ContactPoint{ glm::vec3(5.0f, 0.0f, 0.0f), 0.01f, 2 };
+	manifold.points[1] = ContactPoint{ glm::vec3(2.01f, 0.0f, 0.0f), 0.01f, 7 };
+	manifold.points[2] = ContactPoint{ glm::vec3(9.0f, 0.0f, 0.0f), 0.01f, 9 };
+	manifold.points[3] = ContactPoint{ glm::vec3(0.0f), 0.01f, 1 };
+	ContactCache::matchImpulses(old, manifold);
+	bool ok = manifold.points[0].normalImpulse == 2.0f && manifold.points[1].normalImpulse == 3.0f
+		&& manifold.points[2].normalImpulse == 0.0f && manifold.points[3].normalImpulse == 1.0f;
+
+	// both bodies turned and moved together, then b nudged and b turned
+	const glm::mat3 rotationA = glm::mat3(glm::rotate(glm::mat4(1.0f), 0.4f, glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f))));
+	const glm::mat3 rotationB = glm::mat3(glm::rotate(glm::mat4(1.0f), -0.7f, glm::vec3(0.0f, 1.0f, 0.0f)));
+	const glm::vec3 positionA(1.0f, 2.0f, 3.0f);
+	const glm::vec3 positionB(1.5f, 3.9f, 2.8f);
+	const glm::mat3 turn = glm::mat3(glm::rotate(glm::mat4(1.0f), 1.1f, glm::normalize(glm::vec3(-1.0f, 1.0f, 0.5f))));
+	const glm::vec3 shift(-4.0f, 0.5f, 2.0f);
+	manifold.normal = glm::normalize(positionB - positionA);
+	CachedPair entry;
+	ContactCache::storeFound(entry, manifold, rotationA, positionA, rotationB, positionB);
+	ContactManifold placed;
+	ContactCache::placeFound(entry, turn * rotationA, turn * positionA + shift, placed);
+	ok = ok && ContactCache::isStill(entry, turn * rotationA, turn * positionA + shift, turn * rotationB, turn * positionB + shift)
+		&& placed.count == manifold.count && glm::length(placed.normal - turn * manifold.normal) < 1.0e-5f
+		&& !ContactCache::isStill(entry, rotationA, positionA, rotationB, positionB + glm::vec3(0.002f, 0.0f, 0.0f))
+		&& !ContactCache::isStill(entry, rotationA, positionA, glm::mat3(glm::rotate(glm::mat4(1.0f), 0.01f, glm::vec3(1.0f, 0.0f, 0.0f))) * rotationB, positionB);
+	for (unsigned int k = 0; k < placed.count; k++)
+	{
+		ok = ok && glm::length(placed.points[k].position - (turn * manifold.points[k].position + shift)) < 1.0e-4f
+			&& placed.points[k].id == manifold.points[k].id;
+	}
+
+	BoxWorld stack;
+	const unsigned int height = 4;
+	for (unsigned int j = 0; j < height; j++)
+	{
+		stack.add(glm::vec3(0.0f, 1.0f + 2.0f * j, 0.0f), glm::vec3(1.0f));
+	}
+	stack.start();
+	stack.world.setSleeping(false);
+	stack.run(100);
+	for (unsigned int i = 0; i < 100 && ok; i++)
+	{
+		stack.run(1);
+		ok = stack.world.getReusedPairCount() == height - 1 && stack.world.getContacts().size() == height - 1;
+		for (const BodyContact &contact : stack.world.getContacts())
+		{
+			ok = ok && contact.manifold.count == 4;
+			for (unsigned int k = 0; k < contact.manifold.count; k++)
+			{
+				ok = ok && contact.manifold.points[k].normalImpulse > 0.0f;
+			}
+		}
+	}
+	stack.bodies[height - 1].translate(glm::vec3(0.0f, 0.5f, 0.0f));
+	stack.run(1);
+	return ok && stack.world.getContacts().size() == height - 2;
+}
+
+// how far ahead of a wall 10 cm thick standing on the ground a box thrown
+// at it at 300 m/s is after some steps, swept by conservative advancement
+// or not. Sets impacts to the number of impacts the world reported
+static float throwAtWall(float wallMass, unsigned int steps, bool fast, unsigned int &impacts)
+{
+	BoxWorld world;
+	const unsigned int wall = world.add(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.05f, 2.0f, 2.0f));
+	world.bodies[wall].setMass(wallMass);
+	const unsigned int thrown = world.add(glm::vec3(-5.0f, 1.0f, 0.0f), glm::vec3(0.1f));
+	world.bodies[thrown].setVel(glm::vec3(300.0f, 0.0f, 0.0f));
+	world.bodies[thrown].setFast(fast);
+	world.start();
+	impacts = 0;
+	for (unsigned int i = 0; i < steps; i++)
+	{
+		world.run(1);
+		impacts += world.world.getImpactCount();
+	}
+	return world.bodies[thrown].getPos().x - world.bodies[wall].getPos().x;
+}
+
+// a box moving three metres a step is stopped by a heavy wall far thinner
+// than that when it is marked fast, and passes through it when it is not.
+// A wall as light as the box only takes some of its speed, the rest of the
+// step must be swept again from where it hit
+static bool checkContinuousCollision()
+{
+	unsigned int impacts;
+	bool ok = throwAtWall(1000.0f, 10, true, impacts) < -0.15f && impacts > 0;
+	ok = ok && throwAtWall(1000.0f, 10, false, impacts) > 0.15f && impacts == 0;
+	return ok && throwAtWall(2.0f, 2, true, impacts) < -0.15f && impacts > 1;
+}
+
+// islands falling asleep and waking. Two boxes resting apart fall asleep and
+// stay exactly where they are while a third falls from high above. It
+// wakes the one it lands on but not the other, and once everything has
+// settled all three sleep. A force added to one box wakes it alone, and so
+// does waking one by hand
+static bool checkSleeping()
+{
+	BoxWorld world;
+	const unsigned int resting = world.add(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f));
+	const unsigned int far = world.add(glm::vec3(10.0f, 1.0f, 0.0f), glm::vec3(1.0f));
+	const unsigned int dropped = world.add(glm::vec3(0.0f, 40.0f, 0.0f), glm::vec3(1.0f));
+	world.start();
+	RigidWorld &rigid = world.world;
+
+	world.run(100);
+	const glm::vec3 sleptAt = world.bodies[far].getPos();
+	bool ok = rigid.isAsleep(resting) && rigid.isAsleep(far) && !rigid.isAsleep(dropped) && rigid.getAwakeCount() == 1;
+
+	bool woken = false;
+	for (unsigned int i = 0; i < 700 && ok; i++)
+	{
+		world.run(1);
+		woken = woken || !rigid.isAsleep(resting);
+		ok = rigid.isAsleep(far) && world.bodies[far].getPos() == sleptAt;
+	}
+	ok = ok && woken && rigid.getAwakeCount() == 0;
+
+	// a second pull of gravity on the far box
+	world.bodies[far].addForce(&world.gravity);
+	world.run(1);
+	ok = ok && !rigid.isAsleep(far) && rigid.isAsleep(resting) && rigid.isAsleep(dropped);
+
+	world.run(300);
+	ok = ok && rigid.getAwakeCount() == 0;
+	rigid.wakeBody(resting);
+	world.run(1);
+	return ok && !rigid.isAsleep(resting) && rigid.isAsleep(far) && rigid.isAsleep(dropped);
+}
+
+// forces of a jittered cloth of springs, hooke springs, drag and gravity
+// evaluated at the given thread count and vector level, both put back afterwards
+static vector<glm::vec3> evaluateForces(unsigned int threads, SimdLevel level)
+{
+	const unsigned int n = 128;
+	mt19937 generator(0);
+	uniform_real_distribution<float> jitter(-0.2f, 0.2f);
+	ParticleSystem particles;
+	ForcePipeline forces;
+	vector<unsigned int> all;
+	for (unsigned int i = 0; i < n * n; i++)
+	{
+		all.push_back(i);
+		const glm::vec3 pos((float)(i % n) + jitter(generator), jitter(generator), (float)(i / n) + jitter(generator));
+		particles.addParticle(pos, glm::vec3(jitter(generator), jitter(generator), jitter(generator)));
+	}
+	forces.addGravity(Gravity(glm::vec3(0.0f, -9.8f, 0.0f)), all);
+	for (unsigned int i = 0; i < n * n; i++)
+	{
+		const unsigned int col = i % n;
+		const unsigned int row = i / n;
+		if (col + 1 < n)
+			forces.addSpring(i, i + 1, 500.0f, 2.0f, 1.0f);
+		if (row + 1 < n)
+			forces.addSpring(i, i + n, 500.0f, 2.0f, 1.0f);
+		if (col + 1 < n && row + 1 < n)
+		{
+			forces.addHooke(i, i + n + 1, 50.0f, 1.0f, std::sqrt(2.0f));
+			forces.addDrag(i, i + 1, i + n, glm::vec3(1.0f, 0.0f, 0.5f), 1.0f, 1.2f);
+		}
+	}
+
+	JobSystem &jobs = getJobSystem();
+	const unsigned int previousThreads = jobs.getThreadCount();
+	const SimdLevel previousLevel = getSimdLevel();
+	jobs.setThreadCount(threads);
+	setSimdLevel(level);
+	particles.clearForces();
+	forces.accumulate(particles);
+	jobs.setThreadCount(previousThreads);
+	setSimdLevel(previousLevel);
+	return particles.getForces();
+}
+
+// the colored scatter and the vector kernels promise the same forces, bit
+// for bit, for any thread count and on every vector path
+static bool checkForces()
+{
+	const vector<glm::vec3> reference = evaluateForces(1, SIMD_SCALAR);
+	bool ok = true;
+	for (SimdLevel level : { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2 })
+	{
+		for (unsigned int threads : { 1u, 4u })
+		{
+			ok = ok && evaluateForces(threads, level) == reference;
+		}
+	}
+	return ok;
+}
+
+// positions of a gas scene after a few steps on the given number of threads,
+// the thread count is put back afterwards
+static vector<glm::vec3> runGas(unsigned int size, unsigned int steps, unsigned int threads)
+{
+	JobSystem &jobs = getJobSystem();
+	const unsigned int previous = jobs.getThreadCount();
+	jobs.setThreadCount(threads);
+	Scene *scene = createScene("gas", size);
+	for (unsigned int i = 0; i < steps; i++)
+	{
+		scene->step(0.01f);
+	}
+	vector<glm::vec3> positions = dynamic_cast<GasScene<SemiImplicitEuler> *>(scene)->getParticles().getPositions();
+	delete scene;
+	jobs.setThreadCount(previous);
+	return positions;
+}
+
+// the grid's chunked passes must give the gas the same motion on one
+// thread as on several, at sizes of more than one chunk of particles
+static bool checkGridThreads()
+{
+	bool ok = true;
+	for (unsigned int size : { 20000u, 40000u })
+	{
+		ok = ok && runGas(size, 20, 1) == runGas(size, 20, 4);
+	}
+	return ok;
+}
+
+// run every check, one CSV row each. Returns true if all of them passed
+static bool runChecks(ofstream &out)
+{
+	const pair<const char *, bool (*)()> checks[] =
+	{
+		{ "sweep_and_prune", checkSweepAndPrune },
+		{ "gjk", checkGjk },
+		{ "box_collision", checkBoxCollision },
+		{ "stack", checkStack },
+		{ "contact_cache", checkContactCache },
+		{ "continuous_collision", checkContinuousCollision },
+		{ "sleeping", checkSleeping },
+		{ "distance_field", checkDistanceField },
+		{ "distance_field_file", checkDistanceFieldFile },
+		{ "forces", checkForces },
+		{ "grid_threads", checkGridThreads },
+	};
+
+	string header = "check,result";
+	cout << header << endl;
+	if (out.is_open())
+		out << header << endl;
+
+	bool passed = true;
+	for (const auto &check : checks)
+	{
+		bool ok = check.second();
+		string row = string(check.first) + "," + (ok ? "pass" : "fail");
+		cout << row << endl;
+		if (out.is_open())
+			out << row << endl;
+		passed = passed && ok;
+	}
+	return passed;
+}
+
+int main(int argc, char *argv[])
+{
+	string onlyScene;
+	unsigned int onlySize = 0;
+	unsigned int steps = 200;
+	unsigned int warmup = 20;
+	float dt = 0.01f;
+	string integrator = "euler";
+	float tolerance = 1.0e-3f;
+	Broadphase broadphase = BROADPHASE_TREE;
+	unsigned int iterations = 10;
+	bool sleeping = true;
+	string outFile;
+	bool jobBenchmark = false;
+	bool checks = false;
+
+	// parse arguments
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "-scene") == 0 && hasValue)
+			onlyScene = argv[++i];
+		else if (strcmp(argv[i], "-size") == 0 && hasValue)
+			onlySize = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-steps") == 0 && hasValue)
+			steps = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-warmup") == 0 && hasValue)
+			warmup = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-dt") == 0 && hasValue)
+			dt = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "-integrator") == 0 && hasValue)
+			integrator = argv[++i];
+		else if (strcmp(argv[i], "-tolerance") == 0 && hasValue)
+			tolerance = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "-simd") == 0 && hasValue)
+		{
+			SimdLevel level;
+			if (!parseSimdLevel(argv[++i], level))
+			{
+				printUsage();
+				return EXIT_FAILURE;
+			}
+			setSimdLevel(level);
+		}
+		else if (strcmp(argv[i], "-broadphase") == 0 && hasValue)
+		{
+			if (!parseBroadphase(argv[++i], broadphase))
+			{
+				printUsage();
+				return EXIT_FAILURE;
+			}
+		}
+		else if (strcmp(argv[i], "-iterations") == 0 && hasValue)
+			iterations = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-nosleep") == 0)
+			sleeping = false;
+		else if (strcmp(argv[i], "-threads") == 0 && hasValue)
+			getJobSystem().setThreadCount((unsigned int)atoi(argv[++i]));
+		else if (strcmp(argv[i], "-jobs") == 0)
+			jobBenchmark = true;
+		else if (strcmp(argv[i], "-check") == 0)
+			checks = true;
+		else if (strcmp(argv[i], "-out") == 0 && hasValue)
+			outFile = argv[++i];
+		else
+		{
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (steps == 0 || dt <= 0.0f || tolerance <= 0.0f)
+	{
+		cerr << "steps, time step and tolerance must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+
+	ofstream out;
+	if (!outFile.empty())
+	{
+		out.open(outFile.c_str());
+		if (!out.is_open())
+		{
+			cerr << "unable to open " << outFile << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (jobBenchmark)
+	{
+		runJobBenchmark(out);
+		return EXIT_SUCCESS;
+	}
+	if (checks)
+		return runChecks(out) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	// CSV header
+	string header = "scene,integrator,size,steps,ns_per_step,steps_per_s";
+	for (int p = 0; p < PHASE_COUNT; p++)
+	{
+		header += string(",") + PhaseTimer::getPhaseName((StepPhase)p) + "_ns";
+	}
+	header += ",substeps,rejected,simd,threads,broadphase,iterations,sleeping";
+	cout << header << endl;
+	if (out.is_open())
+		out << header << endl;
+
+	map<string, vector<unsigned int>> sizes = defaultSizes();
+	for (const string &name : getSceneNames())
+	{
+		if (!onlyScene.empty() && name != onlyScene)
+			continue;
+
+		vector<unsigned int> runSizes = onlySize > 0 ? vector<unsigned int>{ onlySize } : sizes[name];
+		for (unsigned int size : runSizes)
+		{
+			// the box scenes have no choice of integrator
+			Scene *scene = createScene(name, size, name == "boxes" || name == "piles" ? "euler" : integrator);
+			if (scene == nullptr)
+			{
+				cerr << "unknown integrator, or size too small: " << integrator << ", " << size << endl;
+				return EXIT_FAILURE;
+			}
+			scene->setTolerance(tolerance);
+			scene->setBroadphase(broadphase);
+			scene->setSolverIterations(iterations);
+			scene->setSleeping(sleeping);
+
+			// let the scene settle, then time the measured steps only
+			for (unsigned int i = 0; i < warmup; i++)
+			{
+				scene->step(dt);
+			}
+			scene->getTimer().reset();
+			StepStats before = scene->getStepStats();
+
+			auto start = chrono::steady_clock::now();
+			for (unsigned int i = 0; i < steps; i++)
+			{
+				scene->step(dt);
+			}
+			double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			// one CSV row per run, phase times are per step
+			string row = name + "," + scene->getIntegratorName() + "," + to_string(scene->getSize()) + "," + to_string(steps) + ","
+				+ to_string(1.0e9 * wall / steps) + "," + to_string(steps / wall);
+			for (int p = 0; p < PHASE_COUNT; p++)
+			{
+				row += "," + to_string(1.0e9 * scene->getTimer().getSeconds((StepPhase)p) / steps);
+			}
+			const StepStats &after = scene->getStepStats();
+			row += "," + to_string(after.taken - before.taken) + "," + to_string(after.rejected - before.rejected);
+			row += string(",") + getSimdLevelName(getSimdLevel()) + "," + to_string(getJobSystem().getThreadCount());
+			row += string(",") + getBroadphaseName(broadphase) + "," + to_string(iterations) + "," + (sleeping ? "1" : "0");
+			cout << row << endl;
+			if (out.is_open())
+				out << row << endl;
+
+			delete scene;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <GL/glew.h>
 #include <glm/glm.hpp>
 #include "Mesh.h"
 #include "Force.h"
@@ -15,8 +14,8 @@ public:
 	 // mesh
 	Mesh &getMesh() { return m_mesh; }
 
-	Body::Body();
-	Body::~Body();
+	Body();
+	~Body();
 
 	// transform matrices
 	glm::mat4 getTranslate() const { return m_mesh.getTranslate(); }
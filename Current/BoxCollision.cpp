@@ -0,0 +1,340 @@
+#include <cfloat>
+#include <cmath>
+#include "BoxCollision.h"
+
+// an edge axis is taken over the best face axis only if it overlaps less
+// than this fraction of the face overlap, less an absolute margin (metres)
+static const float EDGE_RELATIVE_TOLERANCE = 0.95f;
+static const float EDGE_ABSOLUTE_TOLERANCE = 0.005f;
+// the two face axes of the boxes are treated alike within this margin
+static const float FACE_TOLERANCE = 0.001f;
+// cross products of nearly parallel edges are not tested
+static const float PARALLEL_EDGES = 1.0e-5f;
+// feature id of an edge-edge contact, below it the face contacts
+static const unsigned int EDGE_FEATURE = 1 << 16;
+
+// a vertex of the clipped incident face and the two lines it lies on:
+// edges 0 to 3 of the incident face, then the reference face's sides 4 to 7
+struct ClipVertex
+{
+	glm::vec3 position;
+	unsigned int in;	// line of the edge arriving at the vertex
+	unsigned int out;	// line of the edge leaving it
+};
+
+OrientedBox::OrientedBox(const glm::vec3 &halfExtents, const glm::mat4 &model)
+{
+	centre = glm::vec3(model[3]);
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec3 axis = glm::vec3(model[i]);
+		float length = glm::length(axis);
+		axes[i] = axis / length;
+		this->halfExtents[i] = halfExtents[i] * length;
+	}
+}
+
+glm::vec3 OrientedBox::getCorner(unsigned int k) const
+{
+	glm::vec3 corner = centre;
+	for (int i = 0; i < 3; i++)
+	{
+		corner += ((k >> i) & 1 ? halfExtents[i] : -halfExtents[i]) * axes[i];
+	}
+	return corner;
+}
+
+/*
+** REDUCTION
+*/
+
+// keep four: the deepest, the one furthest from it, then the furthest
+// on either side of the line between them so the area stays large
+void reduceContacts(const ContactPoint *points, unsigned int count, const glm::vec3 &n, ContactManifold &manifold)
+{
+	if (count <= ContactManifold::MAX_POINTS)
+	{
+		for (unsigned int k = 0; k < count; k++)
+		{
+			manifold.points[k] = points[k];
+		}
+		manifold.count = count;
+		return;
+	}
+
+	unsigned int keep[4] = { 0, 0, 0, 0 };
+	for (unsigned int k = 1; k < count; k++)
+	{
+		if (points[k].depth > points[keep[0]].depth)
+			keep[0] = k;
+	}
+	float furthest = -1.0f;
+	for (unsigned int k = 0; k < count; k++)
+	{
+		glm::vec3 d = points[k].position - points[keep[0]].position;
+		if (glm::dot(d, d) > furthest)
+		{
+			furthest = glm::dot(d, d);
+			keep[1] = k;
+		}
+	}
+	const glm::vec3 line = points[keep[1]].position - points[keep[0]].position;
+	float most = -FLT_MAX;
+	float least = FLT_MAX;
+	for (unsigned int k = 0; k < count; k++)
+	{
+		float area = glm::dot(glm::cross(line, points[k].position - points[keep[0]].position), n);
+		if (area > most)
+		{
+			most = area;
+			keep[2] = k;
+		}
+		if (area < least)
+		{
+			least = area;
+			keep[3] = k;
+		}
+	}
+	// with every point on one side of the line a pick can repeat, keep it once
+	manifold.count = 0;
+	for (unsigned int k = 0; k < 4; k++)
+	{
+		bool repeated = false;
+		for (unsigned int j = 0; j < k; j++)
+		{
+			repeated = repeated || keep[j] == keep[k];
+		}
+		if (!repeated)
+			manifold.points[manifold.count++] = points[keep[k]];
+	}
+}
+
+/*
+** FACE CONTACT
+*/
+
+// Sutherland-Hodgman: keep the part of the polygon with dot(p, normal) <= offset.
+// A new vertex lies on the clipped edge and on the plane, which is line
+// number plane, so every vertex is named by its two lines whatever the order
+static unsigned int clipPolygon(const ClipVertex *in, unsigned int count, const glm::vec3 &normal, float offset, unsigned int plane, ClipVertex *out)
+{
+	unsigned int written = 0;
+	for (unsigned int k = 0; k < count; k++)
+	{
+		const ClipVertex &p = in[k];
+		const ClipVertex &q = in[(k + 1) % count];
+		float dp = glm::dot(p.position, normal) - offset;
+		float dq = glm::dot(q.position, normal) - offset;
+		if (dp <= 0.0f)
+			out[written++] = p;
+		if (dp < 0.0f && dq > 0.0f)
+			out[written++] = ClipVertex{ p.position + (dp / (dp - dq)) * (q.position - p.position), p.out, plane };
+		else if (dp > 0.0f && dq < 0.0f)
+			out[written++] = ClipVertex{ p.position + (dp / (dp - dq)) * (q.position - p.position), plane, p.out };
+	}
+	return written;
+}
+
+// the incident box's face most opposed to the reference face is clipped to
+// the reference face's sides, n points from the reference box to the other.
+// feature names the reference face, the point ids add the incident face
+// and the two lines each point lies on
+static void faceContact(const OrientedBox &reference, int axis, const glm::vec3 &n, const OrientedBox &incident, unsigned int feature, ContactManifold &manifold)
+{
+	// incident face and its corners, in order around it
+	int best = 0;
+	float bestDot = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		float d = std::fabs(glm::dot(incident.axes[i], n));
+		if (d > bestDot)
+		{
+			best = i;
+			bestDot = d;
+		}
+	}
+	const glm::vec3 faceNormal = glm::dot(incident.axes[best], n) > 0.0f ? -incident.axes[best] : incident.axes[best];
+	const glm::vec3 faceCentre = incident.centre + incident.halfExtents[best] * faceNormal;
+	const glm::vec3 u = incident.halfExtents[(best + 1) % 3] * incident.axes[(best + 1) % 3];
+	const glm::vec3 v = incident.halfExtents[(best + 2) % 3] * incident.axes[(best + 2) % 3];
+
+	ClipVertex polygon[8] = {
+		ClipVertex{ faceCentre + u + v, 3, 0 },
+		ClipVertex{ faceCentre - u + v, 0, 1 },
+		ClipVertex{ faceCentre - u - v, 1, 2 },
+		ClipVertex{ faceCentre + u - v, 2, 3 }
+	};
+	ClipVertex clipped[8];
+	unsigned int count = 4;
+	feature = (feature << 3 | (best << 1) | (faceNormal == incident.axes[best] ? 0 : 1)) << 6;
+
+	// the four sides of the reference face
+	for (int side = 1; side < 3 && count > 0; side++)
+	{
+		const int j = (axis + side) % 3;
+		const glm::vec3 &sideNormal = reference.axes[j];
+		const float centre = glm::dot(reference.centre, sideNormal);
+		count = clipPolygon(polygon, count, sideNormal, centre + reference.halfExtents[j], 2 + 2 * side, clipped);
+		count = clipPolygon(clipped, count, -sideNormal, -centre + reference.halfExtents[j], 3 + 2 * side, polygon);
+	}
+
+	// points below the reference face, the depth is how far below
+	const float faceOffset = glm::dot(reference.centre, n) + reference.halfExtents[axis];
+	ContactPoint points[8];
+	unsigned int below = 0;
+	for (unsigned int k = 0; k < count; k++)
+	{
+		float separation = glm::dot(polygon[k].position, n) - faceOffset;
+		if (separation <= 0.0f)
+			points[below++] = ContactPoint{ polygon[k].position - 0.5f * separation * n, -separation, feature | polygon[k].in << 3 | polygon[k].out };
+	}
+
+	reduceContacts(points, below, n, manifold);
+}
+
+/*
+** EDGE CONTACT
+*/
+
+// closest points of the edge of a along axis i and the edge of b along
+// axis j that face each other across n (from a to b)
+static void edgeContact(const OrientedBox &a, int i, const OrientedBox &b, int j, const glm::vec3 &n, float depth, ContactManifold &manifold)
+{
+	glm::vec3 pa = a.centre;
+	glm::vec3 pb = b.centre;
+	for (int k = 0; k < 3; k++)
+	{
+		if (k != i)
+			pa += (glm::dot(a.axes[k], n) > 0.0f ? a.halfExtents[k] : -a.halfExtents[k]) * a.axes[k];
+		if (k != j)
+			pb += (glm::dot(b.axes[k], n) < 0.0f ? b.halfExtents[k] : -b.halfExtents[k]) * b.axes[k];
+	}
+
+	// closest points of the lines pa + s da and pb + t db, kept on the edges
+	const glm::vec3 da = a.axes[i];
+	const glm::vec3 db = b.axes[j];
+	const glm::vec3 r = pa - pb;
+	const float c = glm::dot(da, db);
+	const float denom = 1.0f - c * c;
+	float s = 0.0f;
+	float t = 0.0f;
+	if (denom > PARALLEL_EDGES)
+	{
+		s = (c * glm::dot(db, r) - glm::dot(da, r)) / denom;
+		t = (glm::dot(db, r) - c * glm::dot(da, r)) / denom;
+	}
+	s = glm::clamp(s, -a.halfExtents[i], a.halfExtents[i]);
+	t = glm::clamp(t, -b.halfExtents[j], b.halfExtents[j]);
+
+	manifold.points[0] = ContactPoint{ 0.5f * (pa + s * da + pb + t * db), depth, EDGE_FEATURE | i << 2 | j };
+	manifold.count = 1;
+}
+
+/*
+** SEPARATING AXIS TEST
+*/
+bool collideBoxes(const OrientedBox &a, const OrientedBox &b, ContactManifold &manifold)
+{
+	const glm::vec3 d = b.centre - a.centre;
+
+	// rotation from b to a and its absolute value, padded so parallel
+	// edges do not produce a zero axis that looks separating
+	glm::mat3 R;
+	glm::mat3 absR;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			R[i][j] = glm::dot(a.axes[i], b.axes[j]);
+			absR[i][j] = std::fabs(R[i][j]) + 1.0e-6f;
+		}
+	}
+
+	// face axes of a
+	float faceA = -FLT_MAX;
+	int axisA = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		float rb = b.halfExtents[0] * absR[i][0] + b.halfExtents[1] * absR[i][1] + b.halfExtents[2] * absR[i][2];
+		float separation = std::fabs(glm::dot(d, a.axes[i])) - (a.halfExtents[i] + rb);
+		if (separation > 0.0f)
+			return false;
+		if (separation > faceA)
+		{
+			faceA = separation;
+			axisA = i;
+		}
+	}
+
+	// face axes of b
+	float faceB = -FLT_MAX;
+	int axisB = 0;
+	for (int j = 0; j < 3; j++)
+	{
+		float ra = a.halfExtents[0] * absR[0][j] + a.halfExtents[1] * absR[1][j] + a.halfExtents[2] * absR[2][j];
+		float separation = std::fabs(glm::dot(d, b.axes[j])) - (ra + b.halfExtents[j]);
+		if (separation > 0.0f)
+			return false;
+		if (separation > faceB)
+		{
+			faceB = separation;
+			axisB = j;
+		}
+	}
+
+	// edge axes
+	float edge = -FLT_MAX;
+	int edgeA = 0;
+	int edgeB = 0;
+	glm::vec3 edgeAxis;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			glm::vec3 axis = glm::cross(a.axes[i], b.axes[j]);
+			float length = glm::length(axis);
+			if (length < PARALLEL_EDGES)
+				continue;
+			axis /= length;
+
+			float ra = 0.0f;
+			float rb = 0.0f;
+			for (int k = 0; k < 3; k++)
+			{
+				ra += a.halfExtents[k] * std::fabs(glm::dot(a.axes[k], axis));
+				rb += b.halfExtents[k] * std::fabs(glm::dot(b.axes[k], axis));
+			}
+			float separation = std::fabs(glm::dot(d, axis)) - (ra + rb);
+			if (separation > 0.0f)
+				return false;
+			if (separation > edge)
+			{
+				edge = separation;
+				edgeA = i;
+				edgeB = j;
+				edgeAxis = axis;
+			}
+		}
+	}
+
+	const float face = faceA > faceB ? faceA : faceB;
+	if (edge > EDGE_RELATIVE_TOLERANCE * face + EDGE_ABSOLUTE_TOLERANCE)
+	{
+		manifold.normal = glm::dot(d, edgeAxis) < 0.0f ? -edgeAxis : edgeAxis;
+		edgeContact(a, edgeA, b, edgeB, manifold.normal, -edge, manifold);
+	}
+	else if (faceB > faceA + FACE_TOLERANCE)
+	{
+		// b's face is the reference, its normal points from b to a
+		glm::vec3 n = glm::dot(d, b.axes[axisB]) > 0.0f ? -b.axes[axisB] : b.axes[axisB];
+		faceContact(b, axisB, n, a, 4 | axisB, manifold);
+		manifold.normal = -n;
+	}
+	else
+	{
+		glm::vec3 n = glm::dot(d, a.axes[axisA]) < 0.0f ? -a.axes[axisA] : a.axes[axisA];
+		faceContact(a, axisA, n, b, axisA, manifold);
+		manifold.normal = n;
+	}
+	return manifold.count > 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "Contact.h"
+
+// a box in the world: centre, unit axes and the half extent along each
+struct OrientedBox
+{
+	glm::vec3 centre;
+	glm::mat3 axes;			// columns are the box's unit axes
+	glm::vec3 halfExtents;
+
+	OrientedBox() {}
+	// the box of half extents halfExtents in model space, placed by a model
+	// matrix without shear. Its scale goes into the half extents
+	OrientedBox(const glm::vec3 &halfExtents, const glm::mat4 &model);
+
+	glm::vec3 getCorner(unsigned int k) const;	// k from 0 to 7, bit i picks the sign along axis i
+};
+
+/*
+** BOX-BOX COLLISION
+** Separating axis test of two oriented boxes over their 15 candidate
+** axes: the three face normals of each and the nine cross products of an
+** edge of each. If none separates them, the axis of least overlap is the
+** contact normal. For a face axis the face of the other box most facing
+** it is clipped to the sides of the reference face and the points left
+** below the reference face are the contacts, at most four are kept. For
+** an edge axis the contact is the closest point of the two edges. Face
+** axes are preferred unless an edge axis is clearly better, which keeps
+** resting boxes on a steady four point manifold.
+*/
+
+// false if the boxes are apart, otherwise the manifold with its normal from a to b
+bool collideBoxes(const OrientedBox &a, const OrientedBox &b, ContactManifold &manifold);
+
+// copy count points sharing the normal into the manifold, keeping the four
+// that cover the widest area when there are more
+void reduceContacts(const ContactPoint *points, unsigned int count, const glm::vec3 &normal, ContactManifold &manifold);
@@ -0,0 +1,712 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include "ClothCollider.h"
+#include "JobSystem.h"
+#include "NormalConeKernel.h"
+
+// triangles, or several patches together, whose normals stay within this
+// angle (radians) of one axis are flat enough not to fold over
+static const float FLAT_SPREAD = 1.4f;
+// a patch is taken as flat if its normals stay within this angle of its axis
+static const float PATCH_SPREAD = 0.7f;
+// cosines of the angles above, the last the widest two flat patches' axes may
+// be apart and still fit FLAT_SPREAD together
+static const float PATCH_COSINE = std::cos(PATCH_SPREAD);
+static const float CLOTH_COSINE = std::cos(FLAT_SPREAD - PATCH_SPREAD);
+static const float PAIR_COSINE = std::cos(2.0f * (FLAT_SPREAD - PATCH_SPREAD));
+// patches, and particles or edges looked up, per parallel chunk
+static const unsigned int PATCH_GRAIN = 8;
+static const unsigned int QUERY_GRAIN = 512;
+// cells a triangle may cover on average before the cells are made wider
+static const unsigned int MAX_TRIANGLE_CELLS = 27;
+// contacts kept per particle, or per edge against other edges, the nearest
+static const unsigned int MAX_CONTACTS = 4;
+
+ClothCollider::ClothCollider()
+{
+	m_thickness = 0.1f;
+	m_activeTriangles = 0;
+	m_mark = 0;
+	m_cellSize = 1.0f;
+}
+
+ClothCollider::~ClothCollider()
+{
+}
+
+void ClothCollider::setTriangles(const std::vector<glm::uvec3> &triangles)
+{
+	m_triangles = triangles;
+	m_edges.clear();
+	m_triangleEdges.resize(triangles.size());
+
+	// each edge once, however many triangles share it
+	std::map<std::pair<unsigned int, unsigned int>, unsigned int> edges;
+	for (unsigned int t = 0; t < triangles.size(); t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = triangles[t][k];
+			unsigned int b = triangles[t][(k + 1) % 3];
+			auto key = std::make_pair(std::min(a, b), std::max(a, b));
+			auto it = edges.find(key);
+			if (it == edges.end())
+			{
+				it = edges.insert(std::make_pair(key, (unsigned int)m_edges.size())).first;
+				m_edges.push_back(glm::uvec2(key.first, key.second));
+			}
+			m_triangleEdges[t][k] = it->second;
+		}
+	}
+
+	// the particles of each patch, each once, for its bounds
+	m_patchParticleStarts.assign(1, 0);
+	m_patchParticles.clear();
+	for (unsigned int first = 0; first < triangles.size(); first += PATCH_TRIANGLES)
+	{
+		std::vector<unsigned int> particles;
+		for (unsigned int t = first; t < std::min(first + PATCH_TRIANGLES, (unsigned int)triangles.size()); t++)
+		{
+			particles.insert(particles.end(), { triangles[t].x, triangles[t].y, triangles[t].z });
+		}
+		std::sort(particles.begin(), particles.end());
+		particles.erase(std::unique(particles.begin(), particles.end()), particles.end());
+		m_patchParticles.insert(m_patchParticles.end(), particles.begin(), particles.end());
+		m_patchParticleStarts.push_back((unsigned int)m_patchParticles.size());
+	}
+
+	// the patches sharing a particle with each, found through the patches
+	// of every particle
+	const unsigned int patches = (unsigned int)m_patchParticleStarts.size() - 1;
+	std::vector<std::pair<unsigned int, unsigned int>> particlePatches;
+	for (unsigned int p = 0; p < patches; p++)
+	{
+		for (unsigned int k = m_patchParticleStarts[p]; k < m_patchParticleStarts[p + 1]; k++)
+		{
+			particlePatches.push_back(std::make_pair(m_patchParticles[k], p));
+		}
+	}
+	std::sort(particlePatches.begin(), particlePatches.end());
+	std::vector<std::vector<unsigned int>> neighbours(patches);
+	for (size_t a = 0; a < particlePatches.size(); a++)
+	{
+		for (size_t b = a + 1; b < particlePatches.size() && particlePatches[b].first == particlePatches[a].first; b++)
+		{
+			neighbours[particlePatches[a].second].push_back(particlePatches[b].second);
+			neighbours[particlePatches[b].second].push_back(particlePatches[a].second);
+		}
+	}
+	m_patchNeighbourStarts.assign(1, 0);
+	m_patchNeighbours.clear();
+	for (std::vector<unsigned int> &list : neighbours)
+	{
+		std::sort(list.begin(), list.end());
+		list.erase(std::unique(list.begin(), list.end()), list.end());
+		m_patchNeighbours.insert(m_patchNeighbours.end(), list.begin(), list.end());
+		m_patchNeighbourStarts.push_back((unsigned int)m_patchNeighbours.size());
+	}
+
+	m_normals.resize(triangles.size());
+	m_triangleBounds.resize(triangles.size());
+	m_triangleCells.resize(triangles.size());
+	m_edgeMarks.assign(m_edges.size(), 0);
+	m_edgeTriangles.resize(m_edges.size());
+	m_patches.resize((triangles.size() + PATCH_TRIANGLES - 1) / PATCH_TRIANGLES);
+	for (Patch &patch : m_patches)
+	{
+		patch.axis = glm::vec3(0.0f);
+	}
+	m_patchBent.resize(m_patches.size());
+	m_patchActive.resize(m_patches.size());
+	m_mark = 0;
+}
+
+void ClothCollider::detect(const ParticleSystem &ps, const std::vector<glm::vec3> &starts)
+{
+	m_contacts.clear();
+	m_activeTriangles = 0;
+	if (m_triangles.empty())
+		return;
+
+	const glm::vec3 *pos = ps.getPositions().data();
+	const glm::vec3 *start = starts.data();
+	findFlat(pos);
+	findActive(pos, start);
+	if (m_activePatches.empty())
+		return;
+
+	// particles and edges of the active patches, each once. The marks save
+	// clearing a flag per particle every step
+	if (m_particleMarks.size() != ps.size())
+		m_particleMarks.assign(ps.size(), 0);
+	if (++m_mark == 0)
+	{
+		std::fill(m_particleMarks.begin(), m_particleMarks.end(), 0);
+		std::fill(m_edgeMarks.begin(), m_edgeMarks.end(), 0);
+		m_mark = 1;
+	}
+	m_activeParticles.clear();
+	m_activeEdges.clear();
+	for (unsigned int p : m_activePatches)
+	{
+		const unsigned int end = std::min((p + 1) * PATCH_TRIANGLES, (unsigned int)m_triangles.size());
+		for (unsigned int t = p * PATCH_TRIANGLES; t < end; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned int i = m_triangles[t][k];
+				if (m_particleMarks[i] != m_mark)
+				{
+					m_particleMarks[i] = m_mark;
+					m_activeParticles.push_back(i);
+				}
+				const unsigned int e = m_triangleEdges[t][k];
+				if (m_edgeMarks[e] != m_mark)
+				{
+					m_edgeMarks[e] = m_mark;
+					m_edgeTriangles[e] = t;
+					m_activeEdges.push_back(e);
+				}
+			}
+			m_activeTriangles++;
+		}
+	}
+
+	buildHash(pos, start);
+
+	JobSystem &jobs = getJobSystem();
+	auto merge = [this](unsigned int count)
+	{
+		const unsigned int chunks = (count + QUERY_GRAIN - 1) / QUERY_GRAIN;
+		for (unsigned int c = 0; c < chunks; c++)
+		{
+			m_contacts.insert(m_contacts.end(), m_chunkContacts[c].begin(), m_chunkContacts[c].end());
+		}
+	};
+	const unsigned int particles = (unsigned int)m_activeParticles.size();
+	const unsigned int edges = (unsigned int)m_activeEdges.size();
+	const unsigned int chunks = (std::max(particles, edges) + QUERY_GRAIN - 1) / QUERY_GRAIN;
+	if (m_chunkContacts.size() < chunks)
+		m_chunkContacts.resize(chunks);
+
+	// particles against the triangles around their path
+	jobs.parallelFor(0, particles, QUERY_GRAIN, [&](unsigned int begin, unsigned int end)
+	{
+		std::vector<ClothContact> &found = m_chunkContacts[begin / QUERY_GRAIN];
+		found.clear();
+		for (unsigned int k = begin; k < end; k++)
+		{
+			const unsigned int i = m_activeParticles[k];
+			const size_t first = found.size();
+			findTriangles(Aabb(glm::min(start[i], pos[i]), glm::max(start[i], pos[i])), [&](unsigned int t)
+			{
+				const glm::uvec3 &tri = m_triangles[t];
+				ClothContact contact;
+				if (tri.x != i && tri.y != i && tri.z != i && testParticle(pos, start, i, t, contact))
+					found.push_back(contact);
+			});
+			keepNearest(pos, first, found);
+		}
+	});
+	merge(particles);
+
+	// edges against the edges of the triangles around their path, each pair
+	// from its lower edge, through the triangle the higher one is found by
+	jobs.parallelFor(0, edges, QUERY_GRAIN, [&](unsigned int begin, unsigned int end)
+	{
+		std::vector<ClothContact> &found = m_chunkContacts[begin / QUERY_GRAIN];
+		found.clear();
+		for (unsigned int k = begin; k < end; k++)
+		{
+			const unsigned int e = m_activeEdges[k];
+			const glm::uvec2 &edge = m_edges[e];
+			const Aabb box(glm::min(glm::min(start[edge.x], pos[edge.x]), glm::min(start[edge.y], pos[edge.y])), glm::max(glm::max(start[edge.x], pos[edge.x]), glm::max(start[edge.y], pos[edge.y])));
+			const size_t first = found.size();
+			findTriangles(box, [&](unsigned int t)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					const unsigned int f = m_triangleEdges[t][j];
+					if (f <= e || m_edgeTriangles[f] != t)
+						continue;
+					const glm::uvec2 &other = m_edges[f];
+					if (other.x == edge.x || other.x == edge.y || other.y == edge.x || other.y == edge.y)
+						continue;
+					ClothContact contact;
+					if (testEdges(pos, start, e, f, contact))
+						found.push_back(contact);
+				}
+			});
+			keepNearest(pos, first, found);
+		}
+	});
+	merge(edges);
+}
+
+/*
+** CULLING
+*/
+
+// patches whose normals all stay within PATCH_SPREAD of the patch's mean
+// normal of the step before, which saves a second pass over them
+void ClothCollider::findFlat(const glm::vec3 *pos)
+{
+	getJobSystem().parallelFor(0, (unsigned int)m_patches.size(), PATCH_GRAIN, [=](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int p = begin; p < end; p++)
+		{
+			Patch &patch = m_patches[p];
+			const unsigned int first = p * PATCH_TRIANGLES;
+			const unsigned int last = std::min(first + PATCH_TRIANGLES, (unsigned int)m_triangles.size());
+			glm::vec3 axis = patch.axis;
+			if (axis == glm::vec3(0.0f))
+			{
+				const glm::uvec3 &tri = m_triangles[first];
+				axis = glm::cross(pos[tri.y] - pos[tri.x], pos[tri.z] - pos[tri.x]);
+			}
+
+			glm::vec3 sum;
+			m_patchBent[p] = !testNormalCone(m_triangles.data(), first, last, pos, axis, PATCH_COSINE, sum);
+			const float length = glm::length(sum);
+			patch.axis = length > 0.0f ? sum / length : glm::vec3(0.0f);
+		}
+	});
+}
+
+// bent patches, and overlapping pairs of flat ones unless they are
+// neighbours on the cloth with axes close enough. Two flat patches that are
+// not joined may lie in layers facing the same way, as where cloth heaps up,
+// and are always tested. The pairs are skipped altogether while every axis
+// stays close enough to the mean of them all, otherwise found by sweeping the
+// patches' bounds along the longest axis of the cloth
+void ClothCollider::findActive(const glm::vec3 *pos, const glm::vec3 *start)
+{
+	const unsigned int n = (unsigned int)m_patches.size();
+	glm::vec3 sum = glm::vec3(0.0f);
+	for (unsigned int p = 0; p < n; p++)
+	{
+		sum += m_patches[p].axis;
+	}
+	bool flat = true;
+	const float length = glm::length(sum);
+	for (unsigned int p = 0; p < n && flat; p++)
+	{
+		flat = !m_patchBent[p] && glm::dot(m_patches[p].axis, sum) > CLOTH_COSINE * length;
+	}
+
+	m_activePatches.clear();
+	if (flat)
+		return;
+	m_patchActive = m_patchBent;
+
+	getJobSystem().parallelFor(0, n, PATCH_GRAIN, [=](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int p = begin; p < end; p++)
+		{
+			glm::vec3 lower = pos[m_patchParticles[m_patchParticleStarts[p]]];
+			glm::vec3 upper = lower;
+			for (unsigned int k = m_patchParticleStarts[p]; k < m_patchParticleStarts[p + 1]; k++)
+			{
+				const unsigned int i = m_patchParticles[k];
+				lower = glm::min(lower, glm::min(start[i], pos[i]));
+				upper = glm::max(upper, glm::max(start[i], pos[i]));
+			}
+			m_patches[p].bounds = Aabb(lower, upper).fattened(m_thickness);
+		}
+	});
+
+	Aabb all = m_patches[0].bounds;
+	for (unsigned int p = 0; p < n; p++)
+	{
+		all = Aabb::merge(all, m_patches[p].bounds);
+	}
+	const glm::vec3 extent = all.getExtent();
+	const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+	m_patchOrder.resize(n);
+	for (unsigned int p = 0; p < n; p++)
+	{
+		m_patchOrder[p] = p;
+	}
+	std::sort(m_patchOrder.begin(), m_patchOrder.end(), [this, axis](unsigned int a, unsigned int b)
+	{
+		const float la = m_patches[a].bounds.lower[axis];
+		const float lb = m_patches[b].bounds.lower[axis];
+		return la < lb || (la == lb && a < b);
+	});
+
+	for (unsigned int i = 0; i < n; i++)
+	{
+		const unsigned int p = m_patchOrder[i];
+		const Patch &a = m_patches[p];
+		for (unsigned int j = i + 1; j < n && m_patches[m_patchOrder[j]].bounds.lower[axis] <= a.bounds.upper[axis]; j++)
+		{
+			// two joined flat patches fit in one cone about the axis halfway
+			// between theirs if their axes are close enough. A bent patch
+			// brings in the patches it overlaps, but not theirs in turn
+			const unsigned int q = m_patchOrder[j];
+			const Patch &b = m_patches[q];
+			if ((m_patchActive[p] && m_patchActive[q]) || (!m_patchBent[p] && !m_patchBent[q] && glm::dot(a.axis, b.axis) > PAIR_COSINE && areNeighbours(p, q)))
+				continue;
+			if (a.bounds.overlaps(b.bounds))
+			{
+				m_patchActive[p] = 1;
+				m_patchActive[q] = 1;
+			}
+		}
+	}
+
+	for (unsigned int p = 0; p < n; p++)
+	{
+		if (m_patchActive[p])
+			m_activePatches.push_back(p);
+	}
+}
+
+bool ClothCollider::areNeighbours(unsigned int p, unsigned int q) const
+{
+	const unsigned int *first = m_patchNeighbours.data() + m_patchNeighbourStarts[p];
+	const unsigned int *last = m_patchNeighbours.data() + m_patchNeighbourStarts[p + 1];
+	return std::binary_search(first, last, q);
+}
+
+/*
+** SPATIAL HASH
+*/
+
+unsigned int ClothCollider::getBucket(const glm::ivec3 &cell) const
+{
+	const unsigned int h = ((unsigned int)cell.x * 73856093u) ^ ((unsigned int)cell.y * 19349663u) ^ ((unsigned int)cell.z * 83492791u);
+	return h & ((unsigned int)m_bucketStarts.size() - 2);
+}
+
+// the active triangles in every cell their bounds cover, counting sorted by
+// bucket. The buckets are a power of two, at least twice the entries
+void ClothCollider::buildHash(const glm::vec3 *pos, const glm::vec3 *start)
+{
+	getJobSystem().parallelFor(0, (unsigned int)m_activePatches.size(), PATCH_GRAIN, [=](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int a = begin; a < end; a++)
+		{
+			const unsigned int p = m_activePatches[a];
+			const unsigned int last = std::min((p + 1) * PATCH_TRIANGLES, (unsigned int)m_triangles.size());
+			for (unsigned int t = p * PATCH_TRIANGLES; t < last; t++)
+			{
+				const glm::uvec3 &tri = m_triangles[t];
+				glm::vec3 lower = pos[tri.x];
+				glm::vec3 upper = pos[tri.x];
+				for (int k = 0; k < 3; k++)
+				{
+					lower = glm::min(lower, glm::min(start[tri[k]], pos[tri[k]]));
+					upper = glm::max(upper, glm::max(start[tri[k]], pos[tri[k]]));
+				}
+				m_triangleBounds[t] = Aabb(lower, upper).fattened(m_thickness);
+				const glm::vec3 n = glm::cross(pos[tri.y] - pos[tri.x], pos[tri.z] - pos[tri.x]);
+				const float length = glm::length(n);
+				m_normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+			}
+		}
+	});
+
+	// cells as wide as the average edge, wider if the triangles have been
+	// stretched across too many of them
+	float edges = 0.0f;
+	for (unsigned int e : m_activeEdges)
+	{
+		edges += glm::length(pos[m_edges[e].y] - pos[m_edges[e].x]);
+	}
+	m_cellSize = std::max(edges / (float)m_activeEdges.size(), m_thickness);
+
+	unsigned int entries = 0;
+	for (;;)
+	{
+		entries = 0;
+		for (unsigned int p : m_activePatches)
+		{
+			const unsigned int last = std::min((p + 1) * PATCH_TRIANGLES, (unsigned int)m_triangles.size());
+			for (unsigned int t = p * PATCH_TRIANGLES; t < last; t++)
+			{
+				const glm::ivec3 lower = getCell(m_triangleBounds[t].lower);
+				const glm::ivec3 cells = getCell(m_triangleBounds[t].upper) - lower + 1;
+				m_triangleCells[t] = lower;
+				entries += (unsigned int)(cells.x * cells.y * cells.z);
+			}
+		}
+		if (entries <= MAX_TRIANGLE_CELLS * m_activeTriangles)
+			break;
+		m_cellSize *= 2.0f;
+	}
+
+	unsigned int buckets = 1;
+	while (buckets < 2 * entries)
+	{
+		buckets *= 2;
+	}
+	m_bucketStarts.assign(buckets + 1, 0);
+
+	// count per bucket, prefix sum, then place. Each start is the cursor of
+	// its bucket while placing, ending up at the start of the next
+	auto forEachEntry = [this](const std::function<void(unsigned int, const glm::ivec3 &)> &entry)
+	{
+		for (unsigned int p : m_activePatches)
+		{
+			const unsigned int last = std::min((p + 1) * PATCH_TRIANGLES, (unsigned int)m_triangles.size());
+			for (unsigned int t = p * PATCH_TRIANGLES; t < last; t++)
+			{
+				const glm::ivec3 lower = m_triangleCells[t];
+				const glm::ivec3 upper = getCell(m_triangleBounds[t].upper);
+				for (int z = lower.z; z <= upper.z; z++)
+				{
+					for (int y = lower.y; y <= upper.y; y++)
+					{
+						for (int x = lower.x; x <= upper.x; x++)
+						{
+							entry(t, glm::ivec3(x, y, z));
+						}
+					}
+				}
+			}
+		}
+	};
+	forEachEntry([this](unsigned int, const glm::ivec3 &cell)
+	{
+		m_bucketStarts[getBucket(cell) + 1]++;
+	});
+	for (unsigned int b = 0; b < buckets; b++)
+	{
+		m_bucketStarts[b + 1] += m_bucketStarts[b];
+	}
+	m_entries.resize(entries);
+	forEachEntry([this](unsigned int t, const glm::ivec3 &cell)
+	{
+		m_entries[m_bucketStarts[getBucket(cell)]++] = HashEntry{ t, cell };
+	});
+	for (unsigned int b = buckets; b > 0; b--)
+	{
+		m_bucketStarts[b] = m_bucketStarts[b - 1];
+	}
+	m_bucketStarts[0] = 0;
+}
+
+// a triangle covering several cells the box covers is reported from the
+// lowest cell both cover, and entries of other cells sharing the bucket are
+// passed over
+template <class Found>
+void ClothCollider::findTriangles(const Aabb &box, const Found &found) const
+{
+	const glm::ivec3 lower = getCell(box.lower);
+	const glm::ivec3 upper = getCell(box.upper);
+	for (int z = lower.z; z <= upper.z; z++)
+	{
+		for (int y = lower.y; y <= upper.y; y++)
+		{
+			for (int x = lower.x; x <= upper.x; x++)
+			{
+				const glm::ivec3 cell = glm::ivec3(x, y, z);
+				const unsigned int bucket = getBucket(cell);
+				for (unsigned int k = m_bucketStarts[bucket]; k < m_bucketStarts[bucket + 1]; k++)
+				{
+					const HashEntry &entry = m_entries[k];
+					if (entry.cell != cell || glm::max(lower, m_triangleCells[entry.triangle]) != cell)
+						continue;
+					if (box.overlaps(m_triangleBounds[entry.triangle]))
+						found(entry.triangle);
+				}
+			}
+		}
+	}
+}
+
+/*
+** NARROWPHASE
+*/
+
+// barycentric coordinates of p projected onto the triangle abc, false if
+// it is outside or the triangle has no area
+static bool barycentric(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, glm::vec3 &uvw)
+{
+	const glm::vec3 ab = b - a;
+	const glm::vec3 ac = c - a;
+	const glm::vec3 ap = p - a;
+	const float d00 = glm::dot(ab, ab);
+	const float d01 = glm::dot(ab, ac);
+	const float d11 = glm::dot(ac, ac);
+	const float d20 = glm::dot(ap, ab);
+	const float d21 = glm::dot(ap, ac);
+	const float denom = d00 * d11 - d01 * d01;
+	if (denom <= 0.0f)
+		return false;
+	uvw.y = (d11 * d20 - d01 * d21) / denom;
+	uvw.z = (d00 * d21 - d01 * d20) / denom;
+	uvw.x = 1.0f - uvw.y - uvw.z;
+	return uvw.x >= 0.0f && uvw.y >= 0.0f && uvw.z >= 0.0f;
+}
+
+// the particle over the inside of the triangle and closer to its plane than
+// the thickness, or one that went through the triangle during the step. The
+// particle and corners are taken to move in straight lines, so it went
+// through if it changed side and the point where it crossed the plane is
+// inside the triangle there
+bool ClothCollider::testParticle(const glm::vec3 *pos, const glm::vec3 *start, unsigned int i, unsigned int t, ClothContact &contact) const
+{
+	const glm::uvec3 &tri = m_triangles[t];
+	const glm::vec3 &n = m_normals[t];
+	if (n == glm::vec3(0.0f))
+		return false;
+	const float distance = glm::dot(n, pos[i] - pos[tri.x]);
+
+	// distance at the start of the step, against the normal at the start
+	// turned to agree with n
+	glm::vec3 n0 = glm::cross(start[tri.y] - start[tri.x], start[tri.z] - start[tri.x]);
+	const float length0 = glm::length(n0);
+	const float distance0 = length0 > 0.0f ? glm::dot(n0, start[i] - start[tri.x]) / length0 * (glm::dot(n0, n) >= 0.0f ? 1.0f : -1.0f) : 0.0f;
+
+	glm::vec3 uvw;
+	float side = distance >= 0.0f ? 1.0f : -1.0f;
+	bool crossed = false;
+	if (distance0 * distance < 0.0f)
+	{
+		const float s = distance0 / (distance0 - distance);
+		auto at = [=](unsigned int j) { return start[j] + s * (pos[j] - start[j]); };
+		crossed = barycentric(at(i), at(tri.x), at(tri.y), at(tri.z), uvw);
+	}
+	if (crossed)
+		side = -side;
+	else if (std::fabs(distance) >= m_thickness || !barycentric(pos[i], pos[tri.x], pos[tri.y], pos[tri.z], uvw))
+		return false;
+
+	contact.particles[0] = i;
+	contact.particles[1] = tri.x;
+	contact.particles[2] = tri.y;
+	contact.particles[3] = tri.z;
+	contact.weights[0] = 1.0f;
+	contact.weights[1] = -uvw.x;
+	contact.weights[2] = -uvw.y;
+	contact.weights[3] = -uvw.z;
+	contact.normal = side * n;
+	return true;
+}
+
+// closest points of the two edges, both inside their edge, closer than the
+// thickness, pushed apart towards the side they were on at the start of the
+// step. Parallel edges are left to the particle tests
+bool ClothCollider::testEdges(const glm::vec3 *pos, const glm::vec3 *start, unsigned int e, unsigned int f, ClothContact &contact) const
+{
+	const glm::uvec2 &edgeA = m_edges[e];
+	const glm::uvec2 &edgeB = m_edges[f];
+	const glm::vec3 da = pos[edgeA.y] - pos[edgeA.x];
+	const glm::vec3 db = pos[edgeB.y] - pos[edgeB.x];
+	const glm::vec3 r = pos[edgeA.x] - pos[edgeB.x];
+	const float aa = glm::dot(da, da);
+	const float bb = glm::dot(db, db);
+	const float ab = glm::dot(da, db);
+	const float denom = aa * bb - ab * ab;
+	if (denom <= 1.0e-6f * aa * bb)
+		return false;
+
+	const float s = (ab * glm::dot(db, r) - bb * glm::dot(da, r)) / denom;
+	const float t = (ab * s + glm::dot(db, r)) / bb;
+	if (s <= 0.0f || s >= 1.0f || t <= 0.0f || t >= 1.0f)
+		return false;
+
+	const glm::vec3 d = r + s * da - t * db;
+	const float distance = glm::length(d);
+	if (distance >= m_thickness)
+		return false;
+
+	// the same points at the start of the step give the side
+	const glm::vec3 d0 = (1.0f - s) * start[edgeA.x] + s * start[edgeA.y] - (1.0f - t) * start[edgeB.x] - t * start[edgeB.y];
+	glm::vec3 n = distance > 0.0f ? d / distance : glm::cross(da, db) / std::sqrt(denom);
+	if (glm::dot(n, d0) < 0.0f)
+		n = -n;
+
+	contact.particles[0] = edgeA.x;
+	contact.particles[1] = edgeA.y;
+	contact.particles[2] = edgeB.x;
+	contact.particles[3] = edgeB.y;
+	contact.weights[0] = 1.0f - s;
+	contact.weights[1] = s;
+	contact.weights[2] = t - 1.0f;
+	contact.weights[3] = -t;
+	contact.normal = n;
+	return true;
+}
+
+// how far apart the contact's points are along its normal, negative once
+// they have passed each other
+static float getGap(const ClothContact &contact, const glm::vec3 *pos)
+{
+	glm::vec3 x = glm::vec3(0.0f);
+	for (int k = 0; k < 4; k++)
+	{
+		x += contact.weights[k] * pos[contact.particles[k]];
+	}
+	return glm::dot(contact.normal, x);
+}
+
+// of the contacts of one particle or edge, from first to the end of found,
+// only the MAX_CONTACTS nearest stay. In a heap of cloth a particle is within
+// the thickness of many layers, pushing it off the nearest is enough and
+// keeps the cost per particle bounded
+void ClothCollider::keepNearest(const glm::vec3 *pos, size_t first, std::vector<ClothContact> &found) const
+{
+	if (found.size() - first <= MAX_CONTACTS)
+		return;
+	std::stable_sort(found.begin() + first, found.end(), [pos](const ClothContact &a, const ClothContact &b)
+	{
+		return getGap(a, pos) < getGap(b, pos);
+	});
+	found.resize(first + MAX_CONTACTS);
+}
+
+/*
+** RESPONSE
+*/
+
+// each contact is moved out to the thickness, shared by inverse mass and
+// weight, then its approach along the normal is removed (no bounce). Earlier
+// contacts may already have separated it
+void ClothCollider::respond(ParticleSystem &ps)
+{
+	std::vector<glm::vec3> &pos = ps.getPositions();
+	std::vector<glm::vec3> &vel = ps.getVelocities();
+	const std::vector<float> &invMass = ps.getInvMasses();
+
+	for (const ClothContact &contact : m_contacts)
+	{
+		float w = 0.0f;
+		glm::vec3 x = glm::vec3(0.0f);
+		glm::vec3 v = glm::vec3(0.0f);
+		for (int k = 0; k < 4; k++)
+		{
+			const unsigned int i = contact.particles[k];
+			w += contact.weights[k] * contact.weights[k] * invMass[i];
+			x += contact.weights[k] * pos[i];
+			v += contact.weights[k] * vel[i];
+		}
+		if (w <= 0.0f)
+			continue;
+
+		const float gap = glm::dot(contact.normal, x);
+		if (gap < m_thickness)
+		{
+			const glm::vec3 correction = (m_thickness - gap) / w * contact.normal;
+			for (int k = 0; k < 4; k++)
+			{
+				pos[contact.particles[k]] += contact.weights[k] * invMass[contact.particles[k]] * correction;
+			}
+		}
+
+		const float vn = glm::dot(contact.normal, v);
+		if (vn < 0.0f)
+		{
+			const glm::vec3 impulse = -vn / w * contact.normal;
+			for (int k = 0; k < 4; k++)
+			{
+				vel[contact.particles[k]] += contact.weights[k] * invMass[contact.particles[k]] * impulse;
+			}
+		}
+	}
+}
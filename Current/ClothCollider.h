@@ -0,0 +1,138 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Aabb.h"
+#include "ParticleSystem.h"
+
+// a particle too close to a triangle, or an edge too close to an edge. The
+// weighted sum of the four positions, along the normal, is how far apart
+// they are
+struct ClothContact
+{
+	unsigned int particles[4];	// the particle then the triangle's corners, or the two edges' ends
+	float weights[4];			// 1 then minus the barycentric coordinates, or the points on the edges
+	glm::vec3 normal;			// unit, towards the side the particle (first edge) was on before the step
+};
+
+/*
+** CLOTH COLLIDER CLASS
+** Self-collision of a cloth given as triangles between particles: a
+** particle may not come closer than the thickness to a triangle it is not
+** a corner of, nor an edge to an edge it shares no particle with.
+** The triangles are taken in patches of PATCH_TRIANGLES consecutive ones.
+** A patch whose normals all lie in a cone well inside a half space cannot
+** fold onto itself, nor can two neighbouring patches whose cones together
+** stay that narrow, so the flat parts of the cloth are never tested, and a
+** cloth that is flat as a whole costs one pass over its triangles. The
+** triangles of the other patches go into a spatial hash of their bounds
+** over the step, rebuilt every step with cells as wide as their average
+** edge, and the particles and edges of those patches look up the
+** triangles around their own path. A particle that went through a
+** triangle during the step is pushed back to the side it started on, as
+** is an edge closer than the thickness to another. Each particle and edge
+** keeps only its few nearest contacts, so a heap of folded cloth costs
+** about as much per particle as a single fold. Contacts are found in
+** parallel, in an order that does not depend on the number of threads,
+** and resolved one after another like ParticleCollider's.
+*/
+class ClothCollider
+{
+public:
+	// triangles per patch, consecutive triangles should be close on the cloth
+	static const unsigned int PATCH_TRIANGLES = 128;
+
+	ClothCollider();
+	~ClothCollider();
+
+	/*
+	** GET AND SET METHODS
+	*/
+	float getThickness() const { return m_thickness; }
+	unsigned int getTriangleCount() const { return (unsigned int)m_triangles.size(); }
+	// triangles of the patches that may fold, in the last detect()
+	unsigned int getActiveTriangleCount() const { return m_activeTriangles; }
+	// width of the hash cells in the last detect()
+	float getCellSize() const { return m_cellSize; }
+	// found by the last detect(), particle contacts first then edge contacts
+	const std::vector<ClothContact> &getContacts() const { return m_contacts; }
+
+	void setThickness(float thickness) { m_thickness = thickness; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// the cloth's triangles as particle indices, also finds their edges
+	void setTriangles(const std::vector<glm::uvec3> &triangles);
+	// contacts at the end of a step that started with the particles at start
+	void detect(const ParticleSystem &ps, const std::vector<glm::vec3> &start);
+	// push the contacts found by detect() apart and stop them approaching
+	void respond(ParticleSystem &ps);
+
+private:
+	// triangle put in the hash for one of the cells its bounds cover
+	struct HashEntry
+	{
+		unsigned int triangle;
+		glm::ivec3 cell;
+	};
+
+	// bounds and mean normal of a patch
+	struct Patch
+	{
+		Aabb bounds;		// over the step, only kept while some patches are not flat
+		glm::vec3 axis;		// unit, mean normal of its triangles weighed by area
+	};
+
+	void findFlat(const glm::vec3 *pos);
+	void findActive(const glm::vec3 *pos, const glm::vec3 *start);
+	// whether patches p and q share a particle
+	bool areNeighbours(unsigned int p, unsigned int q) const;
+	void buildHash(const glm::vec3 *pos, const glm::vec3 *start);
+	glm::ivec3 getCell(const glm::vec3 &p) const { return glm::ivec3(glm::floor(p / m_cellSize)); }
+	unsigned int getBucket(const glm::ivec3 &cell) const;
+	// call found(triangle) once for each triangle in the hash whose bounds
+	// overlap box
+	template <class Found>
+	void findTriangles(const Aabb &box, const Found &found) const;
+	bool testParticle(const glm::vec3 *pos, const glm::vec3 *start, unsigned int i, unsigned int t, ClothContact &contact) const;
+	bool testEdges(const glm::vec3 *pos, const glm::vec3 *start, unsigned int e, unsigned int f, ClothContact &contact) const;
+	void keepNearest(const glm::vec3 *pos, size_t first, std::vector<ClothContact> &found) const;
+
+	float m_thickness;
+	std::vector<glm::uvec3> m_triangles;
+	std::vector<glm::uvec2> m_edges;
+	std::vector<glm::uvec3> m_triangleEdges;	// per triangle, its edge from each corner to the next
+	std::vector<unsigned int> m_patchParticleStarts;	// particles of each patch, as offsets into m_patchParticles
+	std::vector<unsigned int> m_patchParticles;
+	std::vector<unsigned int> m_patchNeighbourStarts;	// patches sharing a particle with each, as offsets into m_patchNeighbours
+	std::vector<unsigned int> m_patchNeighbours;
+
+	// patches this step
+	std::vector<Patch> m_patches;
+	std::vector<unsigned char> m_patchBent;		// 1 if the patch's normals do not fit its cone
+	std::vector<unsigned char> m_patchActive;	// 1 if the patch is bent or may fold onto another
+	std::vector<unsigned int> m_patchOrder;		// patches by the lower end of their bounds
+	std::vector<unsigned int> m_activePatches;
+	unsigned int m_activeTriangles;
+
+	// particles and edges of the active patches, and for each edge the
+	// first active triangle it belongs to, which is the one it is found through
+	std::vector<unsigned int> m_particleMarks;	// per particle, the last detect() it was active in
+	std::vector<unsigned int> m_edgeMarks;
+	std::vector<unsigned int> m_edgeTriangles;
+	std::vector<unsigned int> m_activeParticles;
+	std::vector<unsigned int> m_activeEdges;
+	unsigned int m_mark;
+
+	// hash of the active triangles' bounds
+	float m_cellSize;
+	std::vector<Aabb> m_triangleBounds;			// per triangle, over the step and fattened by the thickness
+	std::vector<glm::ivec3> m_triangleCells;	// per triangle, the lowest cell its bounds cover
+	std::vector<glm::vec3> m_normals;			// per active triangle, unit, at the end of the step
+	std::vector<unsigned int> m_bucketStarts;	// entries of each bucket, as offsets into m_entries
+	std::vector<HashEntry> m_entries;
+
+	std::vector<ClothContact> m_contacts;
+	std::vector<std::vector<ClothContact>> m_chunkContacts;	// contacts found by each chunk
+};
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include "CollisionHull.h"
+#include "Simd.h"
+
+CollisionHull::CollisionHull()
+{
+	m_count = 0;
+	m_centre = glm::vec3(0.0f);
+}
+
+void CollisionHull::build(const std::vector<glm::vec3> &points)
+{
+	std::vector<glm::vec3> unique = points;
+	std::sort(unique.begin(), unique.end(), [](const glm::vec3 &a, const glm::vec3 &b)
+	{
+		if (a.x != b.x)
+			return a.x < b.x;
+		if (a.y != b.y)
+			return a.y < b.y;
+		return a.z < b.z;
+	});
+	unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+	m_count = (unsigned int)unique.size();
+	unsigned int padded = (m_count + PADDING - 1) / PADDING * PADDING;
+	m_x.resize(padded);
+	m_y.resize(padded);
+	m_z.resize(padded);
+	m_centre = glm::vec3(0.0f);
+	for (unsigned int i = 0; i < padded; i++)
+	{
+		const glm::vec3 &p = unique[std::min(i, m_count - 1)];
+		m_x[i] = p.x;
+		m_y[i] = p.y;
+		m_z[i] = p.z;
+		if (i < m_count)
+			m_centre += p;
+	}
+	if (m_count > 0)
+		m_centre /= (float)m_count;
+}
+
+glm::vec3 CollisionHull::support(const glm::vec3 &dir) const
+{
+	unsigned int best = 0;
+	float bestDistance = m_x[0] * dir.x + m_y[0] * dir.y + m_z[0] * dir.z;
+	for (unsigned int i = 1; i < m_count; i++)
+	{
+		float distance = m_x[i] * dir.x + m_y[i] * dir.y + m_z[i] * dir.z;
+		if (distance > bestDistance)
+		{
+			best = i;
+			bestDistance = distance;
+		}
+	}
+	return getPoint(best);
+}
+
+void CollisionHull::transform(const glm::mat4 &model, float *x, float *y, float *z) const
+{
+	transformPoints(model, m_x.data(), m_y.data(), m_z.data(), getPaddedSize(), x, y, z);
+}
+
+/*
+** DISPATCH
+*/
+void transformPoints(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz)
+{
+	switch (getSimdLevel())
+	{
+	case SIMD_AVX2:
+		transformPointsAVX2(model, x, y, z, count, wx, wy, wz);
+		break;
+	case SIMD_SSE41:
+		transformPointsSSE41(model, x, y, z, count, wx, wy, wz);
+		break;
+	default:
+		transformPointsScalar(model, x, y, z, count, wx, wy, wz);
+		break;
+	}
+}
+
+/*
+** SCALAR
+*/
+
+// w = M p + t, summed column by column in the same order as the vector paths
+void transformPointsScalar(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		wx[i] = model[0][0] * x[i] + model[1][0] * y[i] + model[2][0] * z[i] + model[3][0];
+		wy[i] = model[0][1] * x[i] + model[1][1] * y[i] + model[2][1] * z[i] + model[3][1];
+		wz[i] = model[0][2] * x[i] + model[1][2] * y[i] + model[2][2] * z[i] + model[3][2];
+	}
+}
+
+#if SIMD_X86
+
+/*
+** SSE4.1, 4 points at a time
+*/
+SIMD_TARGET_SSE41
+void transformPointsSSE41(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz)
+{
+	const __m128 m00 = _mm_set1_ps(model[0][0]), m01 = _mm_set1_ps(model[0][1]), m02 = _mm_set1_ps(model[0][2]);
+	const __m128 m10 = _mm_set1_ps(model[1][0]), m11 = _mm_set1_ps(model[1][1]), m12 = _mm_set1_ps(model[1][2]);
+	const __m128 m20 = _mm_set1_ps(model[2][0]), m21 = _mm_set1_ps(model[2][1]), m22 = _mm_set1_ps(model[2][2]);
+	const __m128 m30 = _mm_set1_ps(model[3][0]), m31 = _mm_set1_ps(model[3][1]), m32 = _mm_set1_ps(model[3][2]);
+
+	unsigned int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 px = _mm_loadu_ps(x + i);
+		const __m128 py = _mm_loadu_ps(y + i);
+		const __m128 pz = _mm_loadu_ps(z + i);
+		_mm_storeu_ps(wx + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, px), _mm_mul_ps(m10, py)), _mm_mul_ps(m20, pz)), m30));
+		_mm_storeu_ps(wy + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, px), _mm_mul_ps(m11, py)), _mm_mul_ps(m21, pz)), m31));
+		_mm_storeu_ps(wz + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, px), _mm_mul_ps(m12, py)), _mm_mul_ps(m22, pz)), m32));
+	}
+
+	transformPointsScalar(model, x + i, y + i, z + i, count - i, wx + i, wy + i, wz + i);
+}
+
+/*
+** AVX2, 8 points at a time
+*/
+SIMD_TARGET_AVX2
+void transformPointsAVX2(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz)
+{
+	const __m256 m00 = _mm256_set1_ps(model[0][0]), m01 = _mm256_set1_ps(model[0][1]), m02 = _mm256_set1_ps(model[0][2]);
+	const __m256 m10 = _mm256_set1_ps(model[1][0]), m11 = _mm256_set1_ps(model[1][1]), m12 = _mm256_set1_ps(model[1][2]);
+	const __m256 m20 = _mm256_set1_ps(model[2][0]), m21 = _mm256_set1_ps(model[2][1]), m22 = _mm256_set1_ps(model[2][2]);
+	const __m256 m30 = _mm256_set1_ps(model[3][0]), m31 = _mm256_set1_ps(model[3][1]), m32 = _mm256_set1_ps(model[3][2]);
+
+	// separate multiplies and adds, not FMA, so the result matches the other paths
+	unsigned int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 px = _mm256_loadu_ps(x + i);
+		const __m256 py = _mm256_loadu_ps(y + i);
+		const __m256 pz = _mm256_loadu_ps(z + i);
+		_mm256_storeu_ps(wx + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, px), _mm256_mul_ps(m10, py)), _mm256_mul_ps(m20, pz)), m30));
+		_mm256_storeu_ps(wy + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m01, px), _mm256_mul_ps(m11, py)), _mm256_mul_ps(m21, pz)), m31));
+		_mm256_storeu_ps(wz + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m02, px), _mm256_mul_ps(m12, py)), _mm256_mul_ps(m22, pz)), m32));
+	}
+
+	// the compiler leaves the upper halves dirty on the tail call, and the
+	// SSE code after it would pay a transition on every call
+	_mm256_zeroupper();
+	transformPointsScalar(model, x + i, y + i, z + i, count - i, wx + i, wy + i, wz + i);
+}
+
+#else
+
+// no x86 vector units, the dispatcher never selects these
+void transformPointsSSE41(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz)
+{
+	transformPointsScalar(model, x, y, z, count, wx, wy, wz);
+}
+
+void transformPointsAVX2(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz)
+{
+	transformPointsScalar(model, x, y, z, count, wx, wy, wz);
+}
+
+#endif // SIMD_X86
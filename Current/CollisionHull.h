@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+/*
+** COLLISION HULL CLASS
+** The unique points of a mesh kept for collision tests, built once when a
+** body gets its mesh. Points are stored as separate x, y and z arrays
+** padded to a multiple of 8 with copies of the last point, so transform()
+** can run 4 or 8 points per instruction with no remainder, and the padding
+** never changes a support point or the lowest point.
+*/
+class CollisionHull
+{
+public:
+	// points per vector of the widest kernel, the arrays are padded to a multiple of it
+	static const unsigned int PADDING = 8;
+
+	CollisionHull();
+
+	/*
+	** GET METHODS
+	*/
+	unsigned int size() const { return m_count; }
+	// size of the arrays, size() rounded up to the padding
+	unsigned int getPaddedSize() const { return (unsigned int)m_x.size(); }
+	const float *getX() const { return m_x.data(); }
+	const float *getY() const { return m_y.data(); }
+	const float *getZ() const { return m_z.data(); }
+	glm::vec3 getPoint(unsigned int i) const { return glm::vec3(m_x[i], m_y[i], m_z[i]); }
+	glm::vec3 getCentre() const { return m_centre; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// keep the unique points, sorting brings the copies of a point together
+	void build(const std::vector<glm::vec3> &points);
+	// point furthest along dir, model space
+	glm::vec3 support(const glm::vec3 &dir) const;
+	// the points through the model matrix, x, y and z hold getPaddedSize() floats
+	void transform(const glm::mat4 &model, float *x, float *y, float *z) const;
+
+private:
+	std::vector<float> m_x;
+	std::vector<float> m_y;
+	std::vector<float> m_z;
+	unsigned int m_count;	// points before the padding
+	glm::vec3 m_centre;		// average of the points
+};
+
+// world position of count points (a multiple of 4 for the SSE4.1 path and 8
+// for the AVX2 path) given as x, y and z arrays, picked by getSimdLevel()
+void transformPoints(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz);
+
+// the individual paths, transformPoints() picks one of these
+void transformPointsScalar(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz);
+void transformPointsSSE41(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz);
+void transformPointsAVX2(const glm::mat4 &model, const float *x, const float *y, const float *z, unsigned int count, float *wx, float *wy, float *wz);
@@ -0,0 +1,45 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// one point of contact between two shapes
+struct ContactPoint
+{
+	glm::vec3 position;		// world space, halfway between the two surfaces
+	float depth;			// overlap along the normal, 0 when just touching
+	unsigned int id;		// features of the shapes that made the point, the same from step to step
+	float normalImpulse = 0.0f;						// solved impulses, kept to warm start the next step
+	glm::vec3 tangentImpulse = glm::vec3(0.0f);		// world space
+};
+
+/*
+** CONTACT MANIFOLD
+** The points where two shapes touch, all sharing one normal that points
+** from the first shape to the second. A face resting on a face needs up
+** to four points to hold it still, an edge or a vertex needs one or two.
+*/
+struct ContactManifold
+{
+	static const unsigned int MAX_POINTS = 4;
+
+	glm::vec3 normal;
+	ContactPoint points[MAX_POINTS];
+	unsigned int count = 0;
+
+	float getMaxDepth() const
+	{
+		float depth = 0.0f;
+		for (unsigned int k = 0; k < count; k++)
+		{
+			depth = points[k].depth > depth ? points[k].depth : depth;
+		}
+		return depth;
+	}
+};
+
+// two bodies in contact, the manifold normal points from a to b
+struct BodyContact
+{
+	unsigned int a;
+	unsigned int b;
+	ContactManifold manifold;
+};
@@ -0,0 +1,138 @@
+#include <cmath>
+#include "ContactCache.h"
+
+// a pair is tested again once b has moved this far (metres) against a, or
+// turned this much (about this many radians) against it
+static const float STILL_DISTANCE = 1.0e-3f;
+static const float STILL_ROTATION = 1.0e-3f;
+// a point whose id is new takes the impulses of an old point this close (metres)
+static const float MATCH_DISTANCE = 0.05f;
+
+ContactCache::ContactCache()
+{
+	m_step = 0;
+}
+
+void ContactCache::endStep()
+{
+	for (auto it = m_pairs.begin(); it != m_pairs.end();)
+	{
+		if (it->second.step != m_step)
+			it = m_pairs.erase(it);
+		else
+			++it;
+	}
+}
+
+CachedPair &ContactCache::touch(unsigned int a, unsigned int b)
+{
+	CachedPair &entry = m_pairs[getKey(a, b)];
+	entry.step = m_step;
+	return entry;
+}
+
+CachedPair *ContactCache::find(unsigned int a, unsigned int b)
+{
+	auto it = m_pairs.find(getKey(a, b));
+	return it == m_pairs.end() ? nullptr : &it->second;
+}
+
+/*
+** REUSE
+*/
+bool ContactCache::isStill(const CachedPair &entry, const glm::mat3 &rotationA, const glm::vec3 &positionA, const glm::mat3 &rotationB, const glm::vec3 &positionB)
+{
+	if (!entry.found)
+		return false;
+
+	const glm::mat3 toA = glm::transpose(rotationA);
+	const glm::vec3 offset = toA * (positionB - positionA);
+	const glm::vec3 moved = offset - entry.offset;
+	if (glm::dot(moved, moved) > STILL_DISTANCE * STILL_DISTANCE)
+		return false;
+
+	const glm::mat3 rotation = toA * rotationB;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			if (std::fabs(rotation[i][j] - entry.rotation[i][j]) > STILL_ROTATION)
+				return false;
+		}
+	}
+	return true;
+}
+
+void ContactCache::storeFound(CachedPair &entry, const ContactManifold &manifold, const glm::mat3 &rotationA, const glm::vec3 &positionA, const glm::mat3 &rotationB, const glm::vec3 &positionB)
+{
+	const glm::mat3 toA = glm::transpose(rotationA);
+	entry.offset = toA * (positionB - positionA);
+	entry.rotation = toA * rotationB;
+	entry.local = manifold;
+	entry.local.normal = toA * manifold.normal;
+	for (unsigned int k = 0; k < manifold.count; k++)
+	{
+		entry.local.points[k].position = toA * (manifold.points[k].position - positionA);
+	}
+	entry.found = true;
+}
+
+void ContactCache::placeFound(const CachedPair &entry, const glm::mat3 &rotationA, const glm::vec3 &positionA, ContactManifold &manifold)
+{
+	manifold = entry.local;
+	manifold.normal = rotationA * entry.local.normal;
+	for (unsigned int k = 0; k < manifold.count; k++)
+	{
+		manifold.points[k].position = positionA + rotationA * entry.local.points[k].position;
+	}
+}
+
+// by id first. A corner lying on a side of the face it is clipped to can
+// come out as the corner one step and as a clipped point the next, so a
+// point with no id in common takes the nearest unclaimed old point
+void ContactCache::matchImpulses(const ContactManifold &old, ContactManifold &manifold)
+{
+	bool claimed[ContactManifold::MAX_POINTS] = { false, false, false, false };
+	bool matched[ContactManifold::MAX_POINTS] = { false, false, false, false };
+	for (unsigned int k = 0; k < manifold.count; k++)
+	{
+		ContactPoint &point = manifold.points[k];
+		point.normalImpulse = 0.0f;
+		point.tangentImpulse = glm::vec3(0.0f);
+		for (unsigned int j = 0; j < old.count; j++)
+		{
+			if (!claimed[j] && old.points[j].id == point.id)
+			{
+				point.normalImpulse = old.points[j].normalImpulse;
+				point.tangentImpulse = old.points[j].tangentImpulse;
+				claimed[j] = true;
+				matched[k] = true;
+				break;
+			}
+		}
+	}
+
+	for (unsigned int k = 0; k < manifold.count; k++)
+	{
+		if (matched[k])
+			continue;
+		ContactPoint &point = manifold.points[k];
+		float nearest = MATCH_DISTANCE * MATCH_DISTANCE;
+		unsigned int best = old.count;
+		for (unsigned int j = 0; j < old.count; j++)
+		{
+			glm::vec3 d = old.points[j].position - point.position;
+			if (!claimed[j] && glm::dot(d, d) < nearest)
+			{
+				nearest = glm::dot(d, d);
+				best = j;
+			}
+		}
+		if (best < old.count)
+		{
+			point.normalImpulse = old.points[best].normalImpulse;
+			point.tangentImpulse = old.points[best].tangentImpulse;
+			claimed[best] = true;
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "Contact.h"
+#include "Gjk.h"
+
+// what the cache remembers of a pair of bodies from the steps before
+struct CachedPair
+{
+	GjkCache gjk;				// final simplex of the last GJK run
+	ContactManifold manifold;	// as solved last step, with its impulses, count 0 if apart
+	ContactManifold local;		// the manifold when it was found, in the frame of body a
+	glm::mat3 rotation;			// rotation of b in the frame of a when it was found
+	glm::vec3 offset;			// position of b in the frame of a when it was found
+	bool found = false;			// local, rotation and offset are set
+	unsigned int step = 0;		// last step the pair was touched
+};
+
+/*
+** CONTACT CACHE CLASS
+** Memory of contacts between steps, in a hash map from a pair of bodies to
+** what was found for it. A new manifold takes the impulses of the points of
+** the last one with the same feature ids, so the solver can start from
+** last step's answer, and a pair whose bodies have barely moved against
+** each other can take its last manifold instead of being tested again.
+** Pairs that are not touched in a step are dropped at its end.
+*/
+class ContactCache
+{
+public:
+	ContactCache();
+
+	unsigned int size() const { return (unsigned int)m_pairs.size(); }
+
+	// start a step, pairs not touched before endStep() are dropped
+	void beginStep() { m_step++; }
+	void endStep();
+
+	// the entry of a pair, added if it is new. Entries stay where they are
+	// until endStep(), so they can be filled in from other threads
+	CachedPair &touch(unsigned int a, unsigned int b);
+	// the entry of a pair, null if there is none
+	CachedPair *find(unsigned int a, unsigned int b);
+
+	// true if b has moved less than the tolerances against a since the
+	// entry's manifold was found, given the poses of a and b now
+	static bool isStill(const CachedPair &entry, const glm::mat3 &rotationA, const glm::vec3 &positionA, const glm::mat3 &rotationB, const glm::vec3 &positionB);
+	// remember a manifold found with the bodies at these poses
+	static void storeFound(CachedPair &entry, const ContactManifold &manifold, const glm::mat3 &rotationA, const glm::vec3 &positionA, const glm::mat3 &rotationB, const glm::vec3 &positionB);
+	// the stored manifold moved with body a to where it is now
+	static void placeFound(const CachedPair &entry, const glm::mat3 &rotationA, const glm::vec3 &positionA, ContactManifold &manifold);
+	// copy the impulses of old points to the new points with the same id
+	static void matchImpulses(const ContactManifold &old, ContactManifold &manifold);
+
+private:
+	static unsigned long long getKey(unsigned int a, unsigned int b) { return (unsigned long long)a << 32 | b; }
+
+	std::unordered_map<unsigned long long, CachedPair> m_pairs;
+	unsigned int m_step;
+};
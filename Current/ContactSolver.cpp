@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/gtx/matrix_operation.hpp>
+#include "glm/ext.hpp"
+#include "ContactSolver.h"
+#include "JobSystem.h"
+
+// closing speed (m/s) below which a contact does not bounce, so resting
+// bodies are not kicked back up by their own weight
+static const float BOUNCE_THRESHOLD = 0.5f;
+// fraction of the overlap the split impulses remove per step, and the
+// overlap (metres) they leave so touching points stay in contact
+static const float BAUMGARTE = 0.2f;
+static const float SLOP = 0.005f;
+// bodies and points per job when loading and storing them
+static const unsigned int BODY_GRAIN = 64;
+static const unsigned int POINT_GRAIN = 256;
+// islands smaller than this many points are solved together in one job
+static const unsigned int BATCH_POINTS = 64;
+
+ContactSolver::ContactSolver()
+{
+	m_velocityIterations = 10;
+	m_positionIterations = 4;
+	m_warmStarting = true;
+	m_friction = 0.5f;
+	m_staticSlot = 0;
+}
+
+void ContactSolver::solve(const std::vector<RigidBody*> &bodies, std::vector<BodyContact> &contacts, const std::vector<unsigned int> &bodyIslands, unsigned int islandCount, float cor, float dt)
+{
+	loadBodies(bodies);
+	buildPoints(contacts, bodyIslands, islandCount, cor);
+	buildBatches();
+
+	getJobSystem().parallelFor(0, getBatchCount(), 1, [this, dt](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int j = m_batchStarts[begin]; j < m_batchStarts[end]; j++)
+		{
+			solveIsland(m_islandOrder[j], dt);
+		}
+	});
+
+	storeBodies(bodies, dt);
+	storeImpulses(contacts);
+}
+
+// the whole solve of one island, over its own range of points
+void ContactSolver::solveIsland(unsigned int island, float dt)
+{
+	const unsigned int begin = m_islandPoints[island];
+	const unsigned int end = m_islandPoints[island + 1];
+	if (m_warmStarting)
+		warmStart(begin, end);
+
+	for (unsigned int i = 0; i < m_velocityIterations; i++)
+	{
+		solveVelocities(begin, end);
+	}
+	for (unsigned int i = 0; i < m_positionIterations; i++)
+	{
+		solvePositions(begin, end, dt);
+	}
+}
+
+/*
+** SETUP
+*/
+
+// velocities and mass properties of every body, the ground is a slot of zero inverse mass
+void ContactSolver::loadBodies(const std::vector<RigidBody*> &bodies)
+{
+	const unsigned int n = (unsigned int)bodies.size();
+	m_staticSlot = n;
+	m_velocities.resize(n + 1);
+	m_angVels.resize(n + 1);
+	m_pseudoVelocities.assign(n + 1, glm::vec3(0.0f));
+	m_pseudoAngVels.assign(n + 1, glm::vec3(0.0f));
+	m_positions.resize(n + 1);
+	m_invMasses.resize(n + 1);
+	m_invInertias.resize(n + 1);
+
+	getJobSystem().parallelFor(0, n, BODY_GRAIN, [this, &bodies](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			RigidBody *rb = bodies[i];
+			m_velocities[i] = rb->getVel();
+			m_angVels[i] = rb->getAngVel();
+			m_positions[i] = rb->getPos();
+			m_invMasses[i] = 1.0f / rb->getMass();
+			m_invInertias[i] = rb->getInvInertia();
+		}
+	});
+	m_velocities[n] = glm::vec3(0.0f);
+	m_angVels[n] = glm::vec3(0.0f);
+	m_positions[n] = glm::vec3(0.0f);
+	m_invMasses[n] = 0.0f;
+	m_invInertias[n] = glm::mat3(0.0f);
+}
+
+// a point per manifold point, the points of each island together and in
+// the order of their contacts. The island of a contact is that of b, which
+// is never the ground
+void ContactSolver::buildPoints(const std::vector<BodyContact> &contacts, const std::vector<unsigned int> &bodyIslands, unsigned int islandCount, float cor)
+{
+	const unsigned int n = (unsigned int)contacts.size();
+	m_islandPoints.assign(islandCount + 1, 0);
+	for (const BodyContact &contact : contacts)
+	{
+		m_islandPoints[bodyIslands[contact.b] + 1] += contact.manifold.count;
+	}
+	for (unsigned int k = 0; k < islandCount; k++)
+	{
+		m_islandPoints[k + 1] += m_islandPoints[k];
+	}
+
+	// each start is the cursor of its island while placing, ending up at
+	// the start of the next
+	m_contactPoints.resize(n);
+	for (unsigned int c = 0; c < n; c++)
+	{
+		unsigned int &cursor = m_islandPoints[bodyIslands[contacts[c].b]];
+		m_contactPoints[c] = cursor;
+		cursor += contacts[c].manifold.count;
+	}
+	for (unsigned int k = islandCount; k > 0; k--)
+	{
+		m_islandPoints[k] = m_islandPoints[k - 1];
+	}
+	m_islandPoints[0] = 0;
+
+	m_points.resize(m_islandPoints[islandCount]);
+	getJobSystem().parallelFor(0, n, POINT_GRAIN, [this, &contacts, cor](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int c = begin; c < end; c++)
+		{
+			for (unsigned int k = 0; k < contacts[c].manifold.count; k++)
+			{
+				buildPoint(contacts[c], c, k, cor, m_points[m_contactPoints[c] + k]);
+			}
+		}
+	});
+}
+
+// point k of a contact, with its effective masses, its bounce, and the
+// impulses it was given
+void ContactSolver::buildPoint(const BodyContact &contact, unsigned int c, unsigned int k, float cor, SolverPoint &p) const
+{
+	const glm::vec3 n = contact.manifold.normal;
+
+	// two tangents from the normal alone, so they are the same every step
+	glm::vec3 t0 = std::fabs(n.x) >= 0.57735f ? glm::vec3(n.y, -n.x, 0.0f) : glm::vec3(0.0f, n.z, -n.y);
+	t0 = glm::normalize(t0);
+	const glm::vec3 t1 = glm::cross(n, t0);
+
+	const ContactPoint &point = contact.manifold.points[k];
+	p.a = getSlot(contact.a);
+	p.b = getSlot(contact.b);
+	p.normal = n;
+	p.tangents[0] = t0;
+	p.tangents[1] = t1;
+	p.depth = point.depth;
+	p.ra = point.position - m_positions[p.a];
+	p.rb = point.position - m_positions[p.b];
+	p.contact = c;
+	p.point = k;
+
+	// 1 / (1/ma + 1/mb + angular terms) along each direction
+	const float invMass = m_invMasses[p.a] + m_invMasses[p.b];
+	const glm::vec3 dirs[3] = { n, t0, t1 };
+	float masses[3];
+	for (int d = 0; d < 3; d++)
+	{
+		glm::vec3 raxd = glm::cross(p.ra, dirs[d]);
+		glm::vec3 rbxd = glm::cross(p.rb, dirs[d]);
+		float effective = invMass + glm::dot(raxd, m_invInertias[p.a] * raxd) + glm::dot(rbxd, m_invInertias[p.b] * rbxd);
+		masses[d] = effective > 0.0f ? 1.0f / effective : 0.0f;
+	}
+	p.normalMass = masses[0];
+	p.tangentMass[0] = masses[1];
+	p.tangentMass[1] = masses[2];
+
+	// closing speed before any impulse decides the bounce
+	glm::vec3 dv = m_velocities[p.b] + glm::cross(m_angVels[p.b], p.rb) - m_velocities[p.a] - glm::cross(m_angVels[p.a], p.ra);
+	float vn = glm::dot(dv, n);
+	p.bounce = vn < -BOUNCE_THRESHOLD ? -cor * vn : 0.0f;
+
+	// the tangents turn with the normal, the friction impulse is kept in world space
+	p.normalImpulse = m_warmStarting ? point.normalImpulse : 0.0f;
+	p.tangentImpulse[0] = m_warmStarting ? glm::dot(point.tangentImpulse, t0) : 0.0f;
+	p.tangentImpulse[1] = m_warmStarting ? glm::dot(point.tangentImpulse, t1) : 0.0f;
+	p.pseudoImpulse = 0.0f;
+}
+
+// islands by size so the largest start first and the workers end together,
+// each large one a job of its own and the small ones gathered up to
+// BATCH_POINTS points a job
+void ContactSolver::buildBatches()
+{
+	const unsigned int islands = m_islandPoints.empty() ? 0 : (unsigned int)m_islandPoints.size() - 1;
+	m_islandOrder.clear();
+	for (unsigned int k = 0; k < islands; k++)
+	{
+		if (m_islandPoints[k + 1] > m_islandPoints[k])
+			m_islandOrder.push_back(k);
+	}
+	std::stable_sort(m_islandOrder.begin(), m_islandOrder.end(), [this](unsigned int x, unsigned int y)
+	{
+		return m_islandPoints[x + 1] - m_islandPoints[x] > m_islandPoints[y + 1] - m_islandPoints[y];
+	});
+
+	m_batchStarts.clear();
+	unsigned int points = BATCH_POINTS;
+	for (unsigned int j = 0; j < m_islandOrder.size(); j++)
+	{
+		if (points >= BATCH_POINTS)
+		{
+			m_batchStarts.push_back(j);
+			points = 0;
+		}
+		points += m_islandPoints[m_islandOrder[j] + 1] - m_islandPoints[m_islandOrder[j]];
+	}
+	m_batchStarts.push_back((unsigned int)m_islandOrder.size());
+}
+
+// apply the impulses carried over from the last step
+void ContactSolver::warmStart(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++)
+	{
+		const SolverPoint &p = m_points[i];
+		applyImpulse(p, p.normalImpulse * p.normal + p.tangentImpulse[0] * p.tangents[0] + p.tangentImpulse[1] * p.tangents[1]);
+	}
+}
+
+/*
+** ITERATIONS
+*/
+
+// impulse on b at the point, the opposite on a. The ground slot is shared
+// by every island and never moves, so it is left alone
+void ContactSolver::applyImpulse(const SolverPoint &p, const glm::vec3 &impulse)
+{
+	if (p.a != m_staticSlot)
+	{
+		m_velocities[p.a] -= m_invMasses[p.a] * impulse;
+		m_angVels[p.a] -= m_invInertias[p.a] * glm::cross(p.ra, impulse);
+	}
+	if (p.b != m_staticSlot)
+	{
+		m_velocities[p.b] += m_invMasses[p.b] * impulse;
+		m_angVels[p.b] += m_invInertias[p.b] * glm::cross(p.rb, impulse);
+	}
+}
+
+// friction first so the normal impulse, which limits it, has the last word
+void ContactSolver::solveVelocities(unsigned int begin, unsigned int end)
+{
+	for (unsigned int i = begin; i < end; i++)
+	{
+		SolverPoint &p = m_points[i];
+		// relative velocity of the point, b relative to a
+		glm::vec3 dv = m_velocities[p.b] + glm::cross(m_angVels[p.b], p.rb) - m_velocities[p.a] - glm::cross(m_angVels[p.a], p.ra);
+		const float limit = m_friction * p.normalImpulse;
+		for (int k = 0; k < 2; k++)
+		{
+			float lambda = -p.tangentMass[k] * glm::dot(dv, p.tangents[k]);
+			float total = glm::clamp(p.tangentImpulse[k] + lambda, -limit, limit);
+			lambda = total - p.tangentImpulse[k];
+			p.tangentImpulse[k] = total;
+			applyImpulse(p, lambda * p.tangents[k]);
+		}
+
+		dv = m_velocities[p.b] + glm::cross(m_angVels[p.b], p.rb) - m_velocities[p.a] - glm::cross(m_angVels[p.a], p.ra);
+		float lambda = -p.normalMass * (glm::dot(dv, p.normal) - p.bounce);
+		float total = glm::max(p.normalImpulse + lambda, 0.0f);
+		lambda = total - p.normalImpulse;
+		p.normalImpulse = total;
+		applyImpulse(p, lambda * p.normal);
+	}
+}
+
+// pseudo velocities that take a fraction of the overlap away this step
+void ContactSolver::solvePositions(unsigned int begin, unsigned int end, float dt)
+{
+	for (unsigned int i = begin; i < end; i++)
+	{
+		SolverPoint &p = m_points[i];
+		glm::vec3 dv = m_pseudoVelocities[p.b] + glm::cross(m_pseudoAngVels[p.b], p.rb) - m_pseudoVelocities[p.a] - glm::cross(m_pseudoAngVels[p.a], p.ra);
+		float target = BAUMGARTE * glm::max(p.depth - SLOP, 0.0f) / dt;
+		float lambda = -p.normalMass * (glm::dot(dv, p.normal) - target);
+		float total = glm::max(p.pseudoImpulse + lambda, 0.0f);
+		lambda = total - p.pseudoImpulse;
+		p.pseudoImpulse = total;
+
+		const glm::vec3 impulse = lambda * p.normal;
+		if (p.a != m_staticSlot)
+		{
+			m_pseudoVelocities[p.a] -= m_invMasses[p.a] * impulse;
+			m_pseudoAngVels[p.a] -= m_invInertias[p.a] * glm::cross(p.ra, impulse);
+		}
+		if (p.b != m_staticSlot)
+		{
+			m_pseudoVelocities[p.b] += m_invMasses[p.b] * impulse;
+			m_pseudoAngVels[p.b] += m_invInertias[p.b] * glm::cross(p.rb, impulse);
+		}
+	}
+}
+
+/*
+** RESULTS
+*/
+
+// new velocities, and the pseudo velocities applied to the positions for one step
+void ContactSolver::storeBodies(const std::vector<RigidBody*> &bodies, float dt)
+{
+	getJobSystem().parallelFor(0, (unsigned int)bodies.size(), BODY_GRAIN, [this, &bodies, dt](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			RigidBody *rb = bodies[i];
+			rb->setVel(m_velocities[i]);
+			rb->setAngVel(m_angVels[i]);
+
+			if (m_pseudoVelocities[i] != glm::vec3(0.0f))
+				rb->translate(dt * m_pseudoVelocities[i]);
+			if (m_pseudoAngVels[i] != glm::vec3(0.0f))
+			{
+				glm::mat3 R = glm::mat3(rb->getRotate());
+				R += dt * glm::matrixCross3(m_pseudoAngVels[i]) * R;
+				rb->setRotate(glm::mat4(glm::orthonormalize(R)));
+			}
+		}
+	});
+}
+
+// the solved impulses back on the contact points, for the next step
+void ContactSolver::storeImpulses(std::vector<BodyContact> &contacts)
+{
+	getJobSystem().parallelFor(0, (unsigned int)m_points.size(), POINT_GRAIN, [this, &contacts](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			const SolverPoint &p = m_points[i];
+			ContactPoint &point = contacts[p.contact].manifold.points[p.point];
+			point.normalImpulse = p.normalImpulse;
+			point.tangentImpulse = p.tangentImpulse[0] * p.tangents[0] + p.tangentImpulse[1] * p.tangents[1];
+		}
+	});
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Contact.h"
+#include "RigidBody.h"
+
+/*
+** CONTACT SOLVER CLASS
+** Sequential impulses over every point of every manifold at once. Each
+** iteration visits the points in turn and applies the impulse that stops
+** the point approaching along the normal and sliding along the surface,
+** clamping the total impulse of the point rather than each increment, so
+** later points can undo what earlier ones overdid. Overlap is removed by
+** split impulses: a separate pseudo velocity pushes the bodies apart and
+** moves them, without adding energy to their real velocity. The impulses
+** of the last step are applied up front, so a resting stack starts each
+** step close to its solution and settles
+** in a few iterations. Those impulses come in and go back out on the
+** contact points, a ContactCache carries them from step to step.
+** Islands share no moving body, so each is solved on its own: the largest
+** go to the workers one at a time and the small ones in batches. Within
+** an island the points are visited in the order of the contacts, so the
+** result is the same whatever the number of threads.
+*/
+class ContactSolver
+{
+public:
+	// body index of the static ground in a BodyContact, it never moves
+	static const unsigned int STATIC_BODY = 0xffffffff;
+	// island of a body that takes no part in the solve
+	static const unsigned int NO_ISLAND = 0xffffffff;
+
+	ContactSolver();
+
+	/*
+	** GET AND SET METHODS
+	*/
+	unsigned int getVelocityIterations() const { return m_velocityIterations; }
+	unsigned int getPositionIterations() const { return m_positionIterations; }
+	bool getWarmStarting() const { return m_warmStarting; }
+	float getFriction() const { return m_friction; }
+	// points solved in the last solve()
+	unsigned int getPointCount() const { return (unsigned int)m_points.size(); }
+	// jobs the islands of the last solve() were split into
+	unsigned int getBatchCount() const { return m_batchStarts.empty() ? 0 : (unsigned int)m_batchStarts.size() - 1; }
+
+	void setVelocityIterations(unsigned int iterations) { m_velocityIterations = iterations; }
+	void setPositionIterations(unsigned int iterations) { m_positionIterations = iterations; }
+	void setWarmStarting(bool warmStarting) { m_warmStarting = warmStarting; }
+	void setFriction(float friction) { m_friction = friction; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// normals from a to b, a may be STATIC_BODY, the points' impulses are
+	// the warm start and are replaced by the solved ones. Updates the
+	// velocities of the bodies and moves them apart. bodyIslands gives the
+	// island, below islandCount, of every body in a contact
+	void solve(const std::vector<RigidBody*> &bodies, std::vector<BodyContact> &contacts, const std::vector<unsigned int> &bodyIslands, unsigned int islandCount, float cor, float dt);
+
+private:
+	// one point of a manifold, bodies are slots in the arrays below
+	struct SolverPoint
+	{
+		unsigned int a;
+		unsigned int b;
+		glm::vec3 normal;
+		glm::vec3 tangents[2];
+		glm::vec3 ra;				// from the centre of a to the point
+		glm::vec3 rb;
+		float normalMass;			// 1 / effective mass along the normal
+		float tangentMass[2];
+		float bounce;				// normal velocity restitution asks for
+		float depth;
+		float normalImpulse;		// totals over the step
+		float tangentImpulse[2];
+		float pseudoImpulse;
+		unsigned int contact;		// index of the contact it came from
+		unsigned int point;			// and of the point in its manifold
+	};
+
+	void loadBodies(const std::vector<RigidBody*> &bodies);
+	void buildPoints(const std::vector<BodyContact> &contacts, const std::vector<unsigned int> &bodyIslands, unsigned int islandCount, float cor);
+	void buildPoint(const BodyContact &contact, unsigned int c, unsigned int k, float cor, SolverPoint &p) const;
+	void buildBatches();
+	void solveIsland(unsigned int island, float dt);
+	void warmStart(unsigned int begin, unsigned int end);
+	void solveVelocities(unsigned int begin, unsigned int end);
+	void solvePositions(unsigned int begin, unsigned int end, float dt);
+	void storeBodies(const std::vector<RigidBody*> &bodies, float dt);
+	void storeImpulses(std::vector<BodyContact> &contacts);
+	unsigned int getSlot(unsigned int body) const { return body == STATIC_BODY ? m_staticSlot : body; }
+	void applyImpulse(const SolverPoint &point, const glm::vec3 &impulse);
+
+	unsigned int m_velocityIterations;
+	unsigned int m_positionIterations;
+	bool m_warmStarting;
+	float m_friction;		// coefficient of friction of every contact
+
+	// per body, the static ground in the last slot
+	std::vector<glm::vec3> m_velocities;
+	std::vector<glm::vec3> m_angVels;
+	std::vector<glm::vec3> m_pseudoVelocities;
+	std::vector<glm::vec3> m_pseudoAngVels;
+	std::vector<glm::vec3> m_positions;
+	std::vector<float> m_invMasses;
+	std::vector<glm::mat3> m_invInertias;	// world space
+	unsigned int m_staticSlot;
+
+	std::vector<SolverPoint> m_points;			// grouped by island
+	std::vector<unsigned int> m_contactPoints;	// per contact, its first point
+	std::vector<unsigned int> m_islandPoints;	// per island, its first point, and the end
+	std::vector<unsigned int> m_islandOrder;	// islands with points, most points first
+	std::vector<unsigned int> m_batchStarts;	// batches of m_islandOrder, one job each
+};
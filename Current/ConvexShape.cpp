@@ -0,0 +1,29 @@
+#include "ConvexShape.h"
+
+/*
+** SUPPORT FUNCTIONS
+*/
+glm::vec3 SphereShape::support(const glm::vec3 &dir) const
+{
+	float length = glm::length(dir);
+	if (length <= 0.0f)
+		return glm::vec3(m_radius, 0.0f, 0.0f);
+	return (m_radius / length) * dir;
+}
+
+glm::vec3 BoxShape::support(const glm::vec3 &dir) const
+{
+	return glm::vec3(dir.x < 0.0f ? -m_halfExtents.x : m_halfExtents.x,
+		dir.y < 0.0f ? -m_halfExtents.y : m_halfExtents.y,
+		dir.z < 0.0f ? -m_halfExtents.z : m_halfExtents.z);
+}
+
+// the end of the segment along dir, pushed out by the radius
+glm::vec3 CapsuleShape::support(const glm::vec3 &dir) const
+{
+	glm::vec3 end = glm::vec3(0.0f, dir.y < 0.0f ? -m_halfHeight : m_halfHeight, 0.0f);
+	float length = glm::length(dir);
+	if (length <= 0.0f)
+		return end;
+	return end + (m_radius / length) * dir;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "CollisionHull.h"
+
+enum ShapeType
+{
+	SHAPE_SPHERE,
+	SHAPE_BOX,
+	SHAPE_CAPSULE,
+	SHAPE_HULL
+};
+
+/*
+** CONVEX SHAPE CLASS
+** A convex collision shape in model space, described by its support
+** function: the point of the shape furthest along a direction. This is
+** all GJK and EPA need, so any pair of shapes can be tested the same way.
+** Shapes are placed in the world by the model matrix of their body, scale
+** included, so one unit shape can be shared by many bodies.
+*/
+class ConvexShape
+{
+public:
+	ConvexShape(ShapeType type) { m_type = type; }
+	virtual ~ConvexShape() {}
+
+	ShapeType getType() const { return m_type; }
+
+	// point of the shape furthest along dir (model space, dir need not be unit length)
+	virtual glm::vec3 support(const glm::vec3 &dir) const = 0;
+	// some point inside the shape
+	virtual glm::vec3 getCentre() const { return glm::vec3(0.0f); }
+
+private:
+	ShapeType m_type;
+};
+
+/*
+** SPHERE SHAPE
+*/
+class SphereShape : public ConvexShape
+{
+public:
+	SphereShape(float radius) : ConvexShape(SHAPE_SPHERE) { m_radius = radius; }
+
+	float getRadius() const { return m_radius; }
+	glm::vec3 support(const glm::vec3 &dir) const;
+
+private:
+	float m_radius;
+};
+
+/*
+** BOX SHAPE
+** Centred on the origin, the unit cube mesh is a box of half extents 1.
+*/
+class BoxShape : public ConvexShape
+{
+public:
+	BoxShape(const glm::vec3 &halfExtents) : ConvexShape(SHAPE_BOX) { m_halfExtents = halfExtents; }
+
+	glm::vec3 getHalfExtents() const { return m_halfExtents; }
+	glm::vec3 support(const glm::vec3 &dir) const;
+
+private:
+	glm::vec3 m_halfExtents;
+};
+
+/*
+** CAPSULE SHAPE
+** The points within radius of the segment from -halfHeight to halfHeight on y.
+*/
+class CapsuleShape : public ConvexShape
+{
+public:
+	CapsuleShape(float radius, float halfHeight) : ConvexShape(SHAPE_CAPSULE) { m_radius = radius; m_halfHeight = halfHeight; }
+
+	float getRadius() const { return m_radius; }
+	float getHalfHeight() const { return m_halfHeight; }
+	glm::vec3 support(const glm::vec3 &dir) const;
+
+private:
+	float m_radius;
+	float m_halfHeight;
+};
+
+/*
+** HULL SHAPE
+** Convex hull of a set of points, for instance the vertices of a mesh,
+** kept as a CollisionHull so it can be moved to the world in one batch.
+*/
+class HullShape : public ConvexShape
+{
+public:
+	HullShape() : ConvexShape(SHAPE_HULL) {}
+	HullShape(const std::vector<glm::vec3> &points) : ConvexShape(SHAPE_HULL) { m_hull.build(points); }
+
+	const CollisionHull &getHull() const { return m_hull; }
+	void setPoints(const std::vector<glm::vec3> &points) { m_hull.build(points); }
+	glm::vec3 support(const glm::vec3 &dir) const { return m_hull.support(dir); }
+	glm::vec3 getCentre() const { return m_hull.getCentre(); }
+
+private:
+	CollisionHull m_hull;
+};
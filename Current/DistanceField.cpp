@@ -0,0 +1,500 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include "DistanceField.h"
+#include "JobSystem.h"
+
+// the class constants bound to references, as by std::vector::assign()
+const unsigned int DistanceField::BRICK_CELLS;
+const unsigned int DistanceField::BRICK_SAMPLES;
+const unsigned int DistanceField::EMPTY_BRICK;
+
+// first word of a saved field, and its version, raised when the layout or
+// what a bake gives changes so older cached fields are baked again
+static const uint32_t FIELD_MAGIC = 0x31464453;	// "SDF1"
+static const uint32_t FIELD_VERSION = 2;
+static const unsigned int BRICK_SIZE = DistanceField::BRICK_SAMPLES * DistanceField::BRICK_SAMPLES * DistanceField::BRICK_SAMPLES;
+
+// nearest feature of a triangle to a point, each with its own pseudo-normal
+enum TriangleFeature
+{
+	FEATURE_CORNER_A,
+	FEATURE_CORNER_B,
+	FEATURE_CORNER_C,
+	FEATURE_EDGE_AB,
+	FEATURE_EDGE_BC,
+	FEATURE_EDGE_CA,
+	FEATURE_FACE,
+	FEATURE_COUNT
+};
+
+DistanceField::DistanceField()
+{
+	m_cellSize = 1.0f;
+	m_band = 0.0f;
+	m_hash = 0;
+	m_origin = glm::vec3(0.0f);
+	m_brickCounts = glm::uvec3(0);
+}
+
+DistanceField::~DistanceField()
+{
+}
+
+/*
+** HASH
+*/
+
+// FNV-1a over the bytes of value
+template <class T>
+static void hashBytes(uint64_t &hash, const T &value)
+{
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+	for (size_t k = 0; k < sizeof(T); k++)
+	{
+		hash = (hash ^ bytes[k]) * 0x100000001B3ull;
+	}
+}
+
+// the mesh's unique vertices where its model matrix puts them
+static std::vector<glm::vec3> getWorldVertices(const Mesh &mesh)
+{
+	const glm::mat4 model = mesh.getModel();
+	std::vector<glm::vec3> world;
+	world.reserve(mesh.getVertices().size());
+	for (const Vertex &vertex : mesh.getVertices())
+	{
+		world.push_back(glm::vec3(model * glm::vec4(vertex.getCoord(), 1.0f)));
+	}
+	return world;
+}
+
+uint64_t DistanceField::hashMesh(const Mesh &mesh, float cellSize, float band)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hashBytes(hash, FIELD_VERSION);
+	hashBytes(hash, cellSize);
+	hashBytes(hash, band);
+	for (const glm::vec3 &v : getWorldVertices(mesh))
+	{
+		hashBytes(hash, v);
+	}
+	for (const glm::uvec3 &t : mesh.getTriangles())
+	{
+		hashBytes(hash, t);
+	}
+	return hash;
+}
+
+/*
+** BAKE
+*/
+
+// closest point to p on triangle abc and the feature it lies on, by the
+// Voronoi regions of the corners and edges (Ericson, Real-Time Collision
+// Detection 5.1.5)
+static glm::vec3 closestOnTriangle(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, int &feature)
+{
+	const glm::vec3 ab = b - a;
+	const glm::vec3 ac = c - a;
+	const glm::vec3 ap = p - a;
+	const float d1 = glm::dot(ab, ap);
+	const float d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		feature = FEATURE_CORNER_A;
+		return a;
+	}
+
+	const glm::vec3 bp = p - b;
+	const float d3 = glm::dot(ab, bp);
+	const float d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		feature = FEATURE_CORNER_B;
+		return b;
+	}
+
+	const float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		feature = FEATURE_EDGE_AB;
+		return a + d1 / (d1 - d3) * ab;
+	}
+
+	const glm::vec3 cp = p - c;
+	const float d5 = glm::dot(ab, cp);
+	const float d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		feature = FEATURE_CORNER_C;
+		return c;
+	}
+
+	const float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		feature = FEATURE_EDGE_CA;
+		return a + d2 / (d2 - d6) * ac;
+	}
+
+	const float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+	{
+		feature = FEATURE_EDGE_BC;
+		return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+	}
+
+	feature = FEATURE_FACE;
+	const float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// true if triangle abc has too little area, against its longest edge, for
+// a face normal or a closest point on it to mean anything. Its edges and
+// corners are those of its neighbours, which stand in for it
+static bool isDegenerate(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+	const float longest = std::max(std::max(glm::dot(b - a, b - a), glm::dot(c - b, c - b)), glm::dot(a - c, a - c));
+	const glm::vec3 normal = glm::cross(b - a, c - a);
+	return !(glm::dot(normal, normal) > 1.0e-12f * longest * longest);
+}
+
+// pseudo-normals of every feature of every triangle: the face normal, the
+// sum of the two faces' normals at an edge and the sum of the faces'
+// normals weighed by their angle at a corner (Baerentzen and Aanaes). Only
+// their direction is used. Degenerate triangles add nothing to their
+// neighbours' and get none of their own
+static std::vector<glm::vec3> getPseudoNormals(const std::vector<glm::vec3> &pos, const std::vector<glm::uvec3> &triangles)
+{
+	std::vector<glm::vec3> faces(triangles.size(), glm::vec3(0.0f));
+	std::vector<glm::vec3> corners(pos.size(), glm::vec3(0.0f));
+	std::map<std::pair<unsigned int, unsigned int>, glm::vec3> edges;
+	for (unsigned int t = 0; t < triangles.size(); t++)
+	{
+		const glm::uvec3 &tri = triangles[t];
+		if (isDegenerate(pos[tri.x], pos[tri.y], pos[tri.z]))
+			continue;
+		faces[t] = glm::normalize(glm::cross(pos[tri.y] - pos[tri.x], pos[tri.z] - pos[tri.x]));
+		for (int k = 0; k < 3; k++)
+		{
+			const glm::vec3 &corner = pos[tri[k]];
+			const glm::vec3 e1 = glm::normalize(pos[tri[(k + 1) % 3]] - corner);
+			const glm::vec3 e2 = glm::normalize(pos[tri[(k + 2) % 3]] - corner);
+			corners[tri[k]] += std::acos(glm::clamp(glm::dot(e1, e2), -1.0f, 1.0f)) * faces[t];
+			edges[std::make_pair(std::min(tri[k], tri[(k + 1) % 3]), std::max(tri[k], tri[(k + 1) % 3]))] += faces[t];
+		}
+	}
+
+	std::vector<glm::vec3> normals(FEATURE_COUNT * triangles.size());
+	for (unsigned int t = 0; t < triangles.size(); t++)
+	{
+		const glm::uvec3 &tri = triangles[t];
+		glm::vec3 *n = &normals[FEATURE_COUNT * t];
+		for (int k = 0; k < 3; k++)
+		{
+			n[FEATURE_CORNER_A + k] = corners[tri[k]];
+			n[FEATURE_EDGE_AB + k] = edges[std::make_pair(std::min(tri[k], tri[(k + 1) % 3]), std::max(tri[k], tri[(k + 1) % 3]))];
+		}
+		n[FEATURE_FACE] = faces[t];
+	}
+	return normals;
+}
+
+void DistanceField::bake(const Mesh &mesh, float cellSize, float band)
+{
+	m_cellSize = cellSize;
+	m_band = band;
+	m_hash = hashMesh(mesh, cellSize, band);
+	m_bricks.clear();
+	m_samples.clear();
+	m_brickCounts = glm::uvec3(0);
+
+	const std::vector<glm::vec3> pos = getWorldVertices(mesh);
+	const std::vector<glm::uvec3> &triangles = mesh.getTriangles();
+	if (triangles.empty())
+		return;
+
+	// the grid covers the mesh and its band, with a cell to spare
+	glm::vec3 lower = pos[0];
+	glm::vec3 upper = pos[0];
+	for (const glm::vec3 &p : pos)
+	{
+		lower = glm::min(lower, p);
+		upper = glm::max(upper, p);
+	}
+	const float margin = band + cellSize;
+	m_origin = lower - margin;
+	const glm::uvec3 cells = glm::uvec3(glm::ceil((upper - lower + 2.0f * margin) / cellSize));
+	m_brickCounts = (cells + (BRICK_CELLS - 1)) / BRICK_CELLS;
+	const unsigned int bricks = m_brickCounts.x * m_brickCounts.y * m_brickCounts.z;
+
+	// each triangle goes to the bricks whose samples its box, grown by the
+	// band, reaches. A brick's samples run over cells [7b, 7b + 7], so
+	// it is reached if 7b <= upper and 7b + 7 >= lower in cells
+	auto forBricks = [&](const glm::uvec3 &tri, const std::function<void(unsigned int)> &visit)
+	{
+		const glm::vec3 low = (glm::min(glm::min(pos[tri.x], pos[tri.y]), pos[tri.z]) - band - m_origin) / (cellSize * BRICK_CELLS);
+		const glm::vec3 high = (glm::max(glm::max(pos[tri.x], pos[tri.y]), pos[tri.z]) + band - m_origin) / (cellSize * BRICK_CELLS);
+		const glm::ivec3 first = glm::max(glm::ivec3(glm::ceil(low - 1.0f)), glm::ivec3(0));
+		const glm::ivec3 last = glm::min(glm::ivec3(glm::floor(high)), glm::ivec3(m_brickCounts) - 1);
+		for (int z = first.z; z <= last.z; z++)
+			for (int y = first.y; y <= last.y; y++)
+				for (int x = first.x; x <= last.x; x++)
+					visit((z * m_brickCounts.y + y) * m_brickCounts.x + x);
+	};
+
+	// triangles of each brick, as offsets into brickTriangles. Degenerate
+	// ones are left out, their neighbours' edges cover where they are
+	std::vector<bool> degenerate(triangles.size());
+	for (unsigned int t = 0; t < triangles.size(); t++)
+	{
+		degenerate[t] = isDegenerate(pos[triangles[t].x], pos[triangles[t].y], pos[triangles[t].z]);
+	}
+	std::vector<unsigned int> brickStarts(bricks + 1, 0);
+	for (unsigned int t = 0; t < triangles.size(); t++)
+	{
+		if (!degenerate[t])
+			forBricks(triangles[t], [&](unsigned int b) { brickStarts[b + 1]++; });
+	}
+	for (unsigned int b = 0; b < bricks; b++)
+	{
+		brickStarts[b + 1] += brickStarts[b];
+	}
+	std::vector<unsigned int> brickTriangles(brickStarts[bricks]);
+	std::vector<unsigned int> fill(brickStarts.begin(), brickStarts.end() - 1);
+	for (unsigned int t = 0; t < triangles.size(); t++)
+	{
+		if (!degenerate[t])
+			forBricks(triangles[t], [&](unsigned int b) { brickTriangles[fill[b]++] = t; });
+	}
+
+	// only the bricks some triangle reaches keep samples
+	std::vector<unsigned int> stored;
+	m_bricks.assign(bricks, EMPTY_BRICK);
+	for (unsigned int b = 0; b < bricks; b++)
+	{
+		if (brickStarts[b + 1] > brickStarts[b])
+		{
+			m_bricks[b] = (unsigned int)stored.size();
+			stored.push_back(b);
+		}
+	}
+	m_samples.resize(stored.size() * BRICK_SIZE);
+
+	// every sample from the nearest of its brick's triangles, clamped to
+	// the band. Those further than the band may have a nearer triangle
+	// elsewhere, but sample() does not use them
+	const std::vector<glm::vec3> normals = getPseudoNormals(pos, triangles);
+	getJobSystem().parallelFor(0, (unsigned int)stored.size(), 1, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int s = begin; s < end; s++)
+		{
+			const unsigned int b = stored[s];
+			const glm::uvec3 brick(b % m_brickCounts.x, (b / m_brickCounts.x) % m_brickCounts.y, b / (m_brickCounts.x * m_brickCounts.y));
+			float *samples = &m_samples[s * BRICK_SIZE];
+			for (unsigned int k = 0; k < BRICK_SIZE; k++)
+			{
+				const glm::uvec3 local(k % BRICK_SAMPLES, (k / BRICK_SAMPLES) % BRICK_SAMPLES, k / (BRICK_SAMPLES * BRICK_SAMPLES));
+				const glm::vec3 p = m_origin + cellSize * glm::vec3(brick * BRICK_CELLS + local);
+
+				float nearest = -1.0f;
+				float sign = 1.0f;
+				for (unsigned int j = brickStarts[b]; j < brickStarts[b + 1]; j++)
+				{
+					const unsigned int t = brickTriangles[j];
+					const glm::uvec3 &tri = triangles[t];
+					int feature;
+					const glm::vec3 q = closestOnTriangle(p, pos[tri.x], pos[tri.y], pos[tri.z], feature);
+					const float d2 = glm::dot(p - q, p - q);
+					if (nearest < 0.0f || d2 < nearest)
+					{
+						nearest = d2;
+						sign = glm::dot(p - q, normals[FEATURE_COUNT * t + feature]) >= 0.0f ? 1.0f : -1.0f;
+					}
+				}
+				samples[k] = sign * std::min(std::sqrt(nearest), band);
+			}
+		}
+	});
+}
+
+/*
+** DISK CACHE
+*/
+bool DistanceField::bakeCached(const Mesh &mesh, float cellSize, float band, const std::string &directory)
+{
+	const uint64_t hash = hashMesh(mesh, cellSize, band);
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.sdf", (unsigned long long)hash);
+	const std::string fileName = directory + "/" + name;
+	if (load(fileName, hash))
+		return true;
+
+	// a field that cannot be cached still works, it is only baked again
+	// next time
+	bake(mesh, cellSize, band);
+	if (!save(fileName))
+	{
+		std::cerr << "Unable to save distance field: " << fileName << std::endl;
+		std::remove(fileName.c_str());
+	}
+	return false;
+}
+
+bool DistanceField::save(const std::string &fileName) const
+{
+	std::ofstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	const uint32_t stored = getBrickCount();
+	file.write(reinterpret_cast<const char *>(&FIELD_MAGIC), sizeof(FIELD_MAGIC));
+	file.write(reinterpret_cast<const char *>(&FIELD_VERSION), sizeof(FIELD_VERSION));
+	file.write(reinterpret_cast<const char *>(&m_hash), sizeof(m_hash));
+	file.write(reinterpret_cast<const char *>(&m_cellSize), sizeof(m_cellSize));
+	file.write(reinterpret_cast<const char *>(&m_band), sizeof(m_band));
+	file.write(reinterpret_cast<const char *>(&m_origin), sizeof(m_origin));
+	file.write(reinterpret_cast<const char *>(&m_brickCounts), sizeof(m_brickCounts));
+	file.write(reinterpret_cast<const char *>(&stored), sizeof(stored));
+	file.write(reinterpret_cast<const char *>(m_bricks.data()), m_bricks.size() * sizeof(unsigned int));
+	file.write(reinterpret_cast<const char *>(m_samples.data()), m_samples.size() * sizeof(float));
+	file.close();
+	return !file.fail();
+}
+
+bool DistanceField::load(const std::string &fileName, uint64_t hash)
+{
+	std::ifstream file(fileName.c_str(), std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	uint32_t magic = 0, version = 0, stored = 0;
+	uint64_t fileHash = 0;
+	float cellSize, band;
+	glm::vec3 origin;
+	glm::uvec3 brickCounts;
+	file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char *>(&version), sizeof(version));
+	file.read(reinterpret_cast<char *>(&fileHash), sizeof(fileHash));
+	if (!file.good() || magic != FIELD_MAGIC || version != FIELD_VERSION || fileHash != hash)
+		return false;
+	file.read(reinterpret_cast<char *>(&cellSize), sizeof(cellSize));
+	file.read(reinterpret_cast<char *>(&band), sizeof(band));
+	file.read(reinterpret_cast<char *>(&origin), sizeof(origin));
+	file.read(reinterpret_cast<char *>(&brickCounts), sizeof(brickCounts));
+	file.read(reinterpret_cast<char *>(&stored), sizeof(stored));
+	if (!file.good() || !(cellSize > 0.0f) || !(band >= 0.0f))
+		return false;
+
+	// a truncated or corrupt file is rejected before anything is allocated
+	// from its header: the rest of it must be exactly the brick table and
+	// the samples the header gives the size of
+	const std::streamoff header = file.tellg();
+	file.seekg(0, std::ios::end);
+	const std::streamoff length = file.tellg();
+	file.seekg(header);
+	const uint64_t gridBricks = (uint64_t)brickCounts.x * brickCounts.y * brickCounts.z;
+	const uint64_t expected = gridBricks * sizeof(unsigned int) + (uint64_t)stored * BRICK_SIZE * sizeof(float);
+	if (header < 0 || length < header || gridBricks > EMPTY_BRICK || (uint64_t)(length - header) != expected)
+		return false;
+
+	std::vector<unsigned int> bricks((size_t)gridBricks);
+	std::vector<float> samples((size_t)stored * BRICK_SIZE);
+	file.read(reinterpret_cast<char *>(bricks.data()), bricks.size() * sizeof(unsigned int));
+	file.read(reinterpret_cast<char *>(samples.data()), samples.size() * sizeof(float));
+	if (!file.good())
+		return false;
+
+	// every brick table entry must be empty or one of the stored bricks
+	for (unsigned int index : bricks)
+	{
+		if (index != EMPTY_BRICK && index >= stored)
+			return false;
+	}
+
+	m_hash = hash;
+	m_cellSize = cellSize;
+	m_band = band;
+	m_origin = origin;
+	m_brickCounts = brickCounts;
+	m_bricks.swap(bricks);
+	m_samples.swap(samples);
+	return true;
+}
+
+/*
+** LOOKUP
+*/
+bool DistanceField::sample(const glm::vec3 &p, float &distance, glm::vec3 &gradient) const
+{
+	const glm::vec3 g = (p - m_origin) / m_cellSize;
+	const glm::vec3 floored = glm::floor(g);
+
+	// off the grid, compared as floats so that a point far away or not a
+	// number at all is turned away before it is converted to a cell
+	const glm::vec3 cells = glm::vec3(m_brickCounts * BRICK_CELLS);
+	if (!(floored.x >= 0.0f && floored.y >= 0.0f && floored.z >= 0.0f && floored.x < cells.x && floored.y < cells.y && floored.z < cells.z))
+		return false;
+	const glm::uvec3 cell(floored);
+	const glm::uvec3 brick = cell / BRICK_CELLS;
+	const unsigned int index = m_bricks[(brick.z * m_brickCounts.y + brick.y) * m_brickCounts.x + brick.x];
+	if (index == EMPTY_BRICK)
+		return false;
+
+	// the cell's 8 corners, then blended along x, y and z
+	const glm::uvec3 local = cell - brick * BRICK_CELLS;
+	const float *s = &m_samples[index * BRICK_SIZE + (local.z * BRICK_SAMPLES + local.y) * BRICK_SAMPLES + local.x];
+	const unsigned int dy = BRICK_SAMPLES;
+	const unsigned int dz = BRICK_SAMPLES * BRICK_SAMPLES;
+	const float c000 = s[0], c100 = s[1], c010 = s[dy], c110 = s[dy + 1];
+	const float c001 = s[dz], c101 = s[dz + 1], c011 = s[dz + dy], c111 = s[dz + dy + 1];
+	const glm::vec3 f = g - floored;
+
+	const float c00 = c000 + f.x * (c100 - c000);
+	const float c10 = c010 + f.x * (c110 - c010);
+	const float c01 = c001 + f.x * (c101 - c001);
+	const float c11 = c011 + f.x * (c111 - c011);
+	const float c0 = c00 + f.y * (c10 - c00);
+	const float c1 = c01 + f.y * (c11 - c01);
+	distance = c0 + f.z * (c1 - c0);
+	if (std::fabs(distance) >= m_band)
+		return false;
+
+	// derivatives of the same blend
+	const float dx0 = (c100 - c000) + f.y * ((c110 - c010) - (c100 - c000));
+	const float dx1 = (c101 - c001) + f.y * ((c111 - c011) - (c101 - c001));
+	gradient.x = dx0 + f.z * (dx1 - dx0);
+	gradient.y = (c10 - c00) + f.z * ((c11 - c01) - (c10 - c00));
+	gradient.z = c1 - c0;
+	gradient /= m_cellSize;
+	return true;
+}
+
+void DistanceField::collide(float thickness, float friction, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel) const
+{
+	for (unsigned int i = begin; i < end; i++)
+	{
+		float distance;
+		glm::vec3 gradient;
+		if (!sample(pos[i], distance, gradient) || distance >= thickness)
+			continue;
+		const float length = glm::length(gradient);
+		if (length <= 0.0f)
+			continue;
+
+		const glm::vec3 normal = gradient / length;
+		pos[i] += (thickness - distance) * normal;
+		const float vn = glm::dot(vel[i], normal);
+		if (vn < 0.0f)
+		{
+			const glm::vec3 tangent = vel[i] - vn * normal;
+			const float slide = glm::length(tangent);
+			vel[i] = slide > 0.0f ? tangent * (1.0f - std::min(1.0f, -friction * vn / slide)) : glm::vec3(0.0f);
+		}
+	}
+}
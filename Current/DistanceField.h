@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+/*
+** DISTANCE FIELD CLASS
+** Signed distance to the surface of a static mesh, such as one loaded from
+** an OBJ file, sampled on a grid in world space and kept only in a narrow
+** band around the surface. The grid is cut into bricks of BRICK_CELLS
+** cells a side, and only the bricks within the band of some triangle hold
+** samples, BRICK_SAMPLES a side so that the 8 corners of any cell lie in
+** the same brick. A lookup is one index into the brick table and a
+** trilinear blend of 8 samples from one small block of memory, whatever
+** the mesh, with the gradient taken from the same blend.
+** The sign comes from the pseudo-normal of the nearest feature (face,
+** edge or corner), weighed by angle at the corners, which is exact for
+** closed meshes. Outside the band a lookup only says the surface is far.
+** Baking costs a pass per sample over the triangles near its brick, so
+** baked fields can be saved to disk and found again by a hash of the mesh
+** where it is and of the bake settings.
+*/
+class DistanceField
+{
+public:
+	// cells per brick side, and samples per brick side
+	static const unsigned int BRICK_CELLS = 7;
+	static const unsigned int BRICK_SAMPLES = BRICK_CELLS + 1;
+
+	DistanceField();
+	~DistanceField();
+
+	/*
+	** GET AND SET METHODS
+	*/
+	float getCellSize() const { return m_cellSize; }
+	float getBand() const { return m_band; }
+	uint64_t getHash() const { return m_hash; }
+	unsigned int getBrickCount() const { return (unsigned int)(m_samples.size() / (BRICK_SAMPLES * BRICK_SAMPLES * BRICK_SAMPLES)); }
+	// bricks of the whole grid, most of them empty
+	unsigned int getGridBrickCount() const { return (unsigned int)m_bricks.size(); }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// hash of the mesh's triangles where its model matrix puts them, and of
+	// the bake settings, which names the field's cache file
+	static uint64_t hashMesh(const Mesh &mesh, float cellSize, float band);
+
+	// sample the distance to the mesh in world space, cells of cellSize, out
+	// to band from the surface
+	void bake(const Mesh &mesh, float cellSize, float band);
+	// the field from directory if it was baked there before for this mesh
+	// and settings, otherwise bake it and save it there. Returns true if it
+	// was found on disk. A field that cannot be saved is reported on
+	// std::cerr and used all the same
+	bool bakeCached(const Mesh &mesh, float cellSize, float band, const std::string &directory);
+	// false if the file could not be written in full
+	bool save(const std::string &fileName) const;
+	// false if the file is missing, not a field, not the one hash names, or
+	// truncated or corrupt, and the field is then left as it was
+	bool load(const std::string &fileName, uint64_t hash);
+
+	// distance and gradient (towards the outside, near unit length) at p,
+	// false if p is outside the band
+	bool sample(const glm::vec3 &p, float &distance, glm::vec3 &gradient) const;
+
+	// particles [begin, end) closer than thickness to the surface, or behind
+	// it within the band, pushed out along the gradient, the velocity going
+	// in removed and the velocity along it cut by Coulomb friction
+	void collide(float thickness, float friction, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel) const;
+
+private:
+	// brick table entry of the bricks with no samples
+	static const unsigned int EMPTY_BRICK = 0xFFFFFFFF;
+
+	float m_cellSize;
+	float m_band;
+	uint64_t m_hash;
+	glm::vec3 m_origin;			// corner of the grid, sample (0, 0, 0)
+	glm::uvec3 m_brickCounts;	// bricks along each axis
+	std::vector<unsigned int> m_bricks;	// per brick, x fastest, its first sample / BRICK_SAMPLES^3 or EMPTY_BRICK
+	std::vector<float> m_samples;		// BRICK_SAMPLES^3 per stored brick, x fastest
+};
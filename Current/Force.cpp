@@ -49,8 +49,10 @@ glm::vec3 Hooke::apply(float mass, const glm::vec3 &pos, const glm::vec3 &vel)
 	// Transform distances and velocities from 3D to 1D fsd = ?ks(l0-l)?kd(v1?v2)
 	//get distance between 2 points (p2-p1 pos)
 	float length = glm::length(getParticle2()->getPos() - getParticle1()->getPos());
+	if (length <= 0.0f)
+		return glm::vec3(0.0f);
 	//Compute 1d velocities e = V / |v|
-	glm::vec3 e = (getParticle2()->getPos() - getParticle1()->getPos()) / 1;
+	glm::vec3 e = (getParticle2()->getPos() - getParticle1()->getPos()) / length;
 	//Get v1 and v2 (dot procut of e and the velocity)
 	float v1 = glm::dot(e, vel);
 	float v2 = glm::dot(e, getParticle2()->getVel());
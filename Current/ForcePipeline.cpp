@@ -0,0 +1,186 @@
+#include "ForcePipeline.h"
+#include "JobSystem.h"
+
+// particles or elements per parallel chunk
+static const unsigned int GRAVITY_GRAIN = 8192;
+static const unsigned int DRAG_GRAIN = 2048;
+
+ForcePipeline::ForcePipeline()
+{
+	m_dragColored = false;
+}
+
+ForcePipeline::~ForcePipeline()
+{
+}
+
+/*
+** REGISTRATION
+*/
+void ForcePipeline::addGravity(const Gravity &gravity, const std::vector<unsigned int> &particles)
+{
+	GravityBatch batch;
+	batch.gravity = gravity.getGravity();
+	batch.particles = particles;
+	m_gravity.push_back(batch);
+}
+
+void ForcePipeline::addHooke(unsigned int a, unsigned int b, float ks, float kd, float rest)
+{
+	m_hookeA.push_back(a);
+	m_hookeB.push_back(b);
+	m_hookeKs.push_back(ks);
+	m_hookeKd.push_back(kd);
+	m_hookeRest.push_back(rest);
+}
+
+void ForcePipeline::addDrag(unsigned int a, unsigned int b, unsigned int c, const glm::vec3 &wind, float coEff, float dens)
+{
+	m_dragA.push_back(a);
+	m_dragB.push_back(b);
+	m_dragC.push_back(c);
+	m_dragWind.push_back(wind);
+	m_dragCoEff.push_back(coEff);
+	m_dragDens.push_back(dens);
+	m_dragColored = false;
+}
+
+void ForcePipeline::clear()
+{
+	m_gravity.clear();
+	m_springs.clear();
+
+	m_hookeA.clear();
+	m_hookeB.clear();
+	m_hookeKs.clear();
+	m_hookeKd.clear();
+	m_hookeRest.clear();
+
+	m_dragA.clear();
+	m_dragB.clear();
+	m_dragC.clear();
+	m_dragWind.clear();
+	m_dragCoEff.clear();
+	m_dragDens.clear();
+	m_dragColoring.clear();
+	m_dragColored = false;
+}
+
+/*
+** EVALUATION
+*/
+void ForcePipeline::accumulate(ParticleSystem &ps) const
+{
+	accumulate(ps, ps.getPositions().data(), ps.getVelocities().data(), ps.getForces().data());
+}
+
+void ForcePipeline::accumulate(const ParticleSystem &ps, const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *force) const
+{
+	accumulateGravity(ps, force);
+	m_springs.accumulate(pos, vel, force);
+	accumulateHooke(pos, vel, force);
+	accumulateDrag(pos, vel, force);
+}
+
+// F = m * g, fixed particles have no mass to weigh. A batch lists each
+// particle once, so its particles are split between threads freely
+void ForcePipeline::accumulateGravity(const ParticleSystem &ps, glm::vec3 *force) const
+{
+	const float *invMass = ps.getInvMasses().data();
+
+	for (const GravityBatch &batch : m_gravity)
+	{
+		const unsigned int *particles = batch.particles.data();
+		const glm::vec3 gravity = batch.gravity;
+		getJobSystem().parallelFor(0, (unsigned int)batch.particles.size(), GRAVITY_GRAIN, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int k = begin; k < end; k++)
+			{
+				unsigned int i = particles[k];
+				if (invMass[i] > 0.0f)
+				{
+					force[i] += gravity / invMass[i];
+				}
+			}
+		});
+	}
+}
+
+// fsd = -ks * (l0 - l) - kd * (v1 - v2) along the unit vector from a to b
+void ForcePipeline::accumulateHooke(const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *force) const
+{
+	const unsigned int n = getHookeCount();
+
+	for (unsigned int s = 0; s < n; s++)
+	{
+		unsigned int a = m_hookeA[s];
+		unsigned int b = m_hookeB[s];
+
+		glm::vec3 d = pos[b] - pos[a];
+		float length = glm::length(d);
+		if (length <= 0.0f)
+			continue;
+		glm::vec3 e = d / length;
+
+		// 1D velocities along the spring
+		float v1 = glm::dot(e, vel[a]);
+		float v2 = glm::dot(e, vel[b]);
+
+		float fsd = -m_hookeKs[s] * (m_hookeRest[s] - length) - m_hookeKd[s] * (v1 - v2);
+		force[a] += fsd * e;
+	}
+}
+
+// f = -1/2 * rho * |v|^2 * cd * a * n, a third applied to each corner.
+// Triangles of one color share no corner and are evaluated in parallel
+void ForcePipeline::accumulateDrag(const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *force) const
+{
+	if (!m_dragColored)
+	{
+		const unsigned int *corners[3] = { m_dragA.data(), m_dragB.data(), m_dragC.data() };
+		colorElements(getDragCount(), 3, corners, m_dragColoring);
+		m_dragColored = true;
+	}
+
+	auto drag = [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int k = begin; k < end; k++)
+		{
+			unsigned int t = m_dragColoring.order[k];
+			unsigned int a = m_dragA[t];
+			unsigned int b = m_dragB[t];
+			unsigned int c = m_dragC[t];
+
+			// surface normal (b - a) x (c - a)
+			glm::vec3 cross = glm::cross(pos[b] - pos[a], pos[c] - pos[a]);
+			float crossLength = glm::length(cross);
+			if (crossLength <= 0.0f)
+				continue;
+			glm::vec3 normal = cross / crossLength;
+
+			// average velocity of the triangle relative to the wind
+			glm::vec3 v = (vel[a] + vel[b] + vel[c]) / 3.0f - m_dragWind[t];
+			float speed2 = glm::dot(v, v);
+			if (speed2 <= 0.0f)
+				continue;
+
+			// area exposed to the flow
+			float area = 0.5f * crossLength * glm::dot(v, normal) / glm::sqrt(speed2);
+
+			glm::vec3 f = -0.5f * m_dragDens[t] * speed2 * m_dragCoEff[t] * area * normal / 3.0f;
+			force[a] += f;
+			force[b] += f;
+			force[c] += f;
+		}
+	};
+
+	for (unsigned int color = 0; color < m_dragColoring.getColorCount(); color++)
+	{
+		unsigned int begin = m_dragColoring.colorStart[color];
+		unsigned int end = m_dragColoring.colorStart[color + 1];
+		if (ElementColoring::isShared(color))
+			drag(begin, end);
+		else
+			getJobSystem().parallelFor(begin, end, DRAG_GRAIN, drag);
+	}
+}
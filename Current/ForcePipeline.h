@@ -0,0 +1,93 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "Force.h"
+#include "GraphColoring.h"
+#include "ParticleSystem.h"
+#include "SpringNetwork.h"
+
+/*
+** FORCE PIPELINE CLASS
+** Each force type is registered once together with the particles (or
+** elements made of particles) it acts on, and is then evaluated as one
+** loop over all of them. There is no virtual call, no per-body force list
+** and no Body pointer to follow: every element is a handful of indices
+** into the ParticleSystem arrays plus its constants.
+** Gravity, springs and drag run on the job system. Elements that
+** share particles are colored and scattered one color at a time, so the
+** forces are the same whatever the number of threads.
+*/
+class ForcePipeline
+{
+public:
+	ForcePipeline();
+	~ForcePipeline();
+
+	/*
+	** REGISTRATION
+	*/
+
+	// gravity acting on a set of particles
+	void addGravity(const Gravity &gravity, const std::vector<unsigned int> &particles);
+	// spring between particles a and b, evaluated once and applied to both ends
+	unsigned int addSpring(unsigned int a, unsigned int b, float ks, float kd, float rest) { return m_springs.addSpring(a, b, ks, kd, rest); }
+	// spring from particle a to particle b, the force acts on a only (like Hooke)
+	void addHooke(unsigned int a, unsigned int b, float ks, float kd, float rest);
+	// aerodynamic drag on the triangle a, b, c, shared between its three particles
+	void addDrag(unsigned int a, unsigned int b, unsigned int c, const glm::vec3 &wind, float coEff, float dens);
+
+	// remove every registered force
+	void clear();
+
+	/*
+	** GET METHODS
+	*/
+	SpringNetwork &getSprings() { return m_springs; }
+	const SpringNetwork &getSprings() const { return m_springs; }
+	unsigned int getHookeCount() const { return (unsigned int)m_hookeA.size(); }
+	unsigned int getDragCount() const { return (unsigned int)m_dragA.size(); }
+
+	/*
+	** EVALUATION
+	*/
+
+	// add every registered force to the force accumulators of the system
+	void accumulate(ParticleSystem &ps) const;
+	// same, but evaluated on caller supplied positions and velocities
+	void accumulate(const ParticleSystem &ps, const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *force) const;
+
+private:
+	void accumulateGravity(const ParticleSystem &ps, glm::vec3 *force) const;
+	void accumulateHooke(const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *force) const;
+	void accumulateDrag(const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *force) const;
+
+	// gravity, one batch per registered gravity force
+	struct GravityBatch
+	{
+		glm::vec3 gravity;
+		std::vector<unsigned int> particles;
+	};
+	std::vector<GravityBatch> m_gravity;
+
+	// two sided springs, one entry per edge
+	SpringNetwork m_springs;
+
+	// hooke springs, one array per attribute
+	std::vector<unsigned int> m_hookeA;	// particle the force acts on
+	std::vector<unsigned int> m_hookeB;	// particle at the other end
+	std::vector<float> m_hookeKs;		// spring stiffness
+	std::vector<float> m_hookeKd;		// damping coefficient
+	std::vector<float> m_hookeRest;		// rest length
+
+	// drag triangles, one array per attribute
+	std::vector<unsigned int> m_dragA;
+	std::vector<unsigned int> m_dragB;
+	std::vector<unsigned int> m_dragC;
+	std::vector<glm::vec3> m_dragWind;	// velocity of the wind
+	std::vector<float> m_dragCoEff;		// drag coefficient
+	std::vector<float> m_dragDens;		// medium density
+
+	// drag triangles grouped into colors with no shared corner
+	mutable ElementColoring m_dragColoring;
+	mutable bool m_dragColored;
+};
@@ -0,0 +1,542 @@
+#include <cfloat>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include "Gjk.h"
+
+// iterations before giving up on a query that does not converge
+static const int GJK_MAX_ITERATIONS = 64;
+static const int EPA_MAX_ITERATIONS = 64;
+// squared distance below which the shapes are taken to touch
+static const float GJK_TOUCH_DISTANCE2 = 1.0e-10f;
+// GJK stops when a new support point improves the distance by less than this fraction
+static const float GJK_RELATIVE_TOLERANCE = 1.0e-6f;
+// a tetrahedron is flat when its fourth vertex is within this fraction of
+// its distance from the other three of their plane
+static const float GJK_FLAT_TOLERANCE = 1.0e-4f;
+// EPA stops when the boundary is within this of the nearest face (metres)
+static const float EPA_TOLERANCE = 1.0e-4f;
+
+/*
+** SIMPLEX
+*/
+
+// a point of A - B and the points of A and B it came from
+struct SupportPoint
+{
+	glm::vec3 w;			// a - b
+	glm::vec3 a;			// world space
+	glm::vec3 b;
+	glm::vec3 localA;		// model space, kept in the cache
+	glm::vec3 localB;
+};
+
+struct Simplex
+{
+	SupportPoint v[4];
+	float lambda[4];		// barycentric weights of the closest point
+	unsigned int count = 0;
+};
+
+static SupportPoint support(const PlacedShape &a, const PlacedShape &b, const glm::vec3 &dir, GjkResult &result)
+{
+	SupportPoint p;
+	p.localA = a.localSupport(dir);
+	p.localB = b.localSupport(-dir);
+	p.a = a.toWorld(p.localA);
+	p.b = b.toWorld(p.localB);
+	p.w = p.a - p.b;
+	result.supportCalls++;
+	return p;
+}
+
+// keep the vertices in keep (indices into s.v) with their weights
+static void reduce(Simplex &s, unsigned int count, const unsigned int *keep, const float *lambda)
+{
+	SupportPoint v[4];
+	for (unsigned int k = 0; k < count; k++)
+	{
+		v[k] = s.v[keep[k]];
+	}
+	for (unsigned int k = 0; k < count; k++)
+	{
+		s.v[k] = v[k];
+		s.lambda[k] = lambda[k];
+	}
+	s.count = count;
+}
+
+// closest point to the origin on the segment i-j of s, written to the
+// weights of the vertices it keeps, returns the squared distance
+static float closestOnSegment(const Simplex &s, unsigned int i, unsigned int j, unsigned int *keep, float *lambda, unsigned int &count)
+{
+	const glm::vec3 a = s.v[i].w;
+	const glm::vec3 ab = s.v[j].w - a;
+	float length2 = glm::dot(ab, ab);
+	float t = length2 > 0.0f ? -glm::dot(a, ab) / length2 : 0.0f;
+	if (t <= 0.0f)
+	{
+		keep[0] = i; lambda[0] = 1.0f; count = 1;
+		return glm::dot(a, a);
+	}
+	if (t >= 1.0f)
+	{
+		keep[0] = j; lambda[0] = 1.0f; count = 1;
+		return glm::dot(s.v[j].w, s.v[j].w);
+	}
+	keep[0] = i; keep[1] = j;
+	lambda[0] = 1.0f - t; lambda[1] = t;
+	count = 2;
+	glm::vec3 p = a + t * ab;
+	return glm::dot(p, p);
+}
+
+// closest point to the origin on the triangle i-j-k, by its Voronoi regions
+static float closestOnTriangle(const Simplex &s, unsigned int i, unsigned int j, unsigned int k, unsigned int *keep, float *lambda, unsigned int &count)
+{
+	const glm::vec3 a = s.v[i].w;
+	const glm::vec3 b = s.v[j].w;
+	const glm::vec3 c = s.v[k].w;
+	const glm::vec3 ab = b - a;
+	const glm::vec3 ac = c - a;
+
+	// vertex regions and edge regions, see Ericson, Real-Time Collision Detection 5.1.5
+	float d1 = -glm::dot(ab, a);
+	float d2 = -glm::dot(ac, a);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		keep[0] = i; lambda[0] = 1.0f; count = 1;
+		return glm::dot(a, a);
+	}
+	float d3 = -glm::dot(ab, b);
+	float d4 = -glm::dot(ac, b);
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		keep[0] = j; lambda[0] = 1.0f; count = 1;
+		return glm::dot(b, b);
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		return closestOnSegment(s, i, j, keep, lambda, count);
+	float d5 = -glm::dot(ab, c);
+	float d6 = -glm::dot(ac, c);
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		keep[0] = k; lambda[0] = 1.0f; count = 1;
+		return glm::dot(c, c);
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		return closestOnSegment(s, i, k, keep, lambda, count);
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+		return closestOnSegment(s, j, k, keep, lambda, count);
+
+	// face region, a flat triangle falls back to its best edge
+	float sum = va + vb + vc;
+	if (sum <= FLT_MIN)
+	{
+		unsigned int edgeKeep[2];
+		float edgeLambda[2];
+		unsigned int edgeCount;
+		float best = closestOnSegment(s, i, j, keep, lambda, count);
+		const unsigned int edges[2][2] = { { i, k }, { j, k } };
+		for (int e = 0; e < 2; e++)
+		{
+			float d = closestOnSegment(s, edges[e][0], edges[e][1], edgeKeep, edgeLambda, edgeCount);
+			if (d < best)
+			{
+				best = d;
+				count = edgeCount;
+				for (unsigned int m = 0; m < edgeCount; m++)
+				{
+					keep[m] = edgeKeep[m];
+					lambda[m] = edgeLambda[m];
+				}
+			}
+		}
+		return best;
+	}
+	float v = vb / sum;
+	float w = vc / sum;
+	keep[0] = i; keep[1] = j; keep[2] = k;
+	lambda[0] = 1.0f - v - w; lambda[1] = v; lambda[2] = w;
+	count = 3;
+	glm::vec3 p = a + v * ab + w * ac;
+	return glm::dot(p, p);
+}
+
+// reduce s to the smallest simplex holding its closest point to the origin.
+// Returns that point, a full tetrahedron means the origin is inside
+static glm::vec3 solveSimplex(Simplex &s)
+{
+	unsigned int keep[4];
+	float lambda[4];
+	unsigned int count = 0;
+
+	switch (s.count)
+	{
+	case 1:
+		s.lambda[0] = 1.0f;
+		break;
+	case 2:
+		closestOnSegment(s, 0, 1, keep, lambda, count);
+		reduce(s, count, keep, lambda);
+		break;
+	case 3:
+		closestOnTriangle(s, 0, 1, 2, keep, lambda, count);
+		reduce(s, count, keep, lambda);
+		break;
+	case 4:
+	{
+		// the closest of the faces that have the origin on their outer side.
+		// Which side the fourth vertex of a flat tetrahedron is on is down to
+		// rounding, so every face of one counts
+		static const unsigned int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+		float best = FLT_MAX;
+		for (int f = 0; f < 4; f++)
+		{
+			const glm::vec3 a = s.v[faces[f][0]].w;
+			glm::vec3 n = glm::cross(s.v[faces[f][1]].w - a, s.v[faces[f][2]].w - a);
+			const glm::vec3 ad = s.v[faces[f][3]].w - a;
+			const float height = glm::dot(ad, n);
+			if (std::fabs(height) > GJK_FLAT_TOLERANCE * glm::length(n) * glm::length(ad) && glm::dot(-a, n) * height > 0.0f)
+				continue;
+
+			unsigned int faceKeep[3];
+			float faceLambda[3];
+			unsigned int faceCount;
+			float d = closestOnTriangle(s, faces[f][0], faces[f][1], faces[f][2], faceKeep, faceLambda, faceCount);
+			if (d < best)
+			{
+				best = d;
+				count = faceCount;
+				for (unsigned int m = 0; m < faceCount; m++)
+				{
+					keep[m] = faceKeep[m];
+					lambda[m] = faceLambda[m];
+				}
+			}
+		}
+		if (best < FLT_MAX)
+			reduce(s, count, keep, lambda);
+		break;
+	}
+	}
+
+	glm::vec3 closest(0.0f);
+	if (s.count < 4)
+	{
+		for (unsigned int k = 0; k < s.count; k++)
+		{
+			closest += s.lambda[k] * s.v[k].w;
+		}
+	}
+	return closest;
+}
+
+/*
+** GJK
+*/
+
+// runs GJK and leaves the final simplex in s, the loop ends as soon as the
+// shapes are known to intersect
+static bool gjk(const PlacedShape &a, const PlacedShape &b, GjkCache *cache, Simplex &s, GjkResult &result)
+{
+	// start from the cached simplex moved to where the bodies are now
+	s.count = 0;
+	if (cache != nullptr)
+	{
+		for (unsigned int k = 0; k < cache->count; k++)
+		{
+			SupportPoint p;
+			p.localA = cache->localA[k];
+			p.localB = cache->localB[k];
+			p.a = a.toWorld(p.localA);
+			p.b = b.toWorld(p.localB);
+			p.w = p.a - p.b;
+
+			bool repeated = false;
+			for (unsigned int m = 0; m < s.count; m++)
+			{
+				repeated = repeated || s.v[m].w == p.w;
+			}
+			if (!repeated)
+				s.v[s.count++] = p;
+		}
+	}
+	if (s.count == 0)
+	{
+		glm::vec3 dir = b.toWorld(b.shape->getCentre()) - a.toWorld(a.shape->getCentre());
+		if (glm::dot(dir, dir) <= 0.0f)
+			dir = glm::vec3(1.0f, 0.0f, 0.0f);
+		s.v[0] = support(a, b, dir, result);
+		s.count = 1;
+	}
+
+	bool intersecting = false;
+	float lastDistance2 = FLT_MAX;
+	Simplex last;
+	for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++)
+	{
+		glm::vec3 v = solveSimplex(s);
+		float distance2 = glm::dot(v, v);
+		if (s.count == 4 || distance2 <= GJK_TOUCH_DISTANCE2)
+		{
+			intersecting = true;
+			break;
+		}
+		// rounding can stop the distance going down, the simplex before is the closer one
+		if (distance2 >= lastDistance2)
+		{
+			s = last;
+			break;
+		}
+		lastDistance2 = distance2;
+		last = s;
+
+		SupportPoint p = support(a, b, -v, result);
+		bool repeated = false;
+		for (unsigned int k = 0; k < s.count; k++)
+		{
+			repeated = repeated || s.v[k].w == p.w;
+		}
+		if (repeated || distance2 - glm::dot(v, p.w) <= GJK_RELATIVE_TOLERANCE * distance2)
+			break;
+		s.v[s.count++] = p;
+	}
+
+	// witness points from the weights of the closest point
+	result.intersecting = intersecting;
+	if (!intersecting)
+	{
+		result.pointA = glm::vec3(0.0f);
+		result.pointB = glm::vec3(0.0f);
+		for (unsigned int k = 0; k < s.count; k++)
+		{
+			result.pointA += s.lambda[k] * s.v[k].a;
+			result.pointB += s.lambda[k] * s.v[k].b;
+		}
+		glm::vec3 d = result.pointB - result.pointA;
+		result.distance = glm::length(d);
+		result.normal = result.distance > 0.0f ? d / result.distance : glm::vec3(0.0f, 1.0f, 0.0f);
+		result.depth = 0.0f;
+	}
+	else
+	{
+		result.distance = 0.0f;
+	}
+
+	if (cache != nullptr)
+	{
+		cache->count = s.count;
+		for (unsigned int k = 0; k < s.count; k++)
+		{
+			cache->localA[k] = s.v[k].localA;
+			cache->localB[k] = s.v[k].localB;
+		}
+	}
+	return intersecting;
+}
+
+bool computeDistance(const PlacedShape &a, const PlacedShape &b, GjkCache *cache, GjkResult &result)
+{
+	result.supportCalls = 0;
+	Simplex s;
+	return gjk(a, b, cache, s, result);
+}
+
+/*
+** EPA
+*/
+
+struct EpaFace
+{
+	unsigned int v[3];
+	glm::vec3 normal;		// unit, pointing away from the origin
+	float distance;			// of the plane from the origin
+};
+
+static bool makeFace(const std::vector<SupportPoint> &points, unsigned int i, unsigned int j, unsigned int k, EpaFace &face)
+{
+	face.v[0] = i; face.v[1] = j; face.v[2] = k;
+	glm::vec3 n = glm::cross(points[j].w - points[i].w, points[k].w - points[i].w);
+	float length = glm::length(n);
+	if (length <= FLT_MIN)
+		return false;
+	face.normal = n / length;
+	face.distance = glm::dot(face.normal, points[i].w);
+	return true;
+}
+
+// grow a simplex that touches or encloses the origin into a tetrahedron,
+// false if the shapes are too flat to make one
+static bool growToTetrahedron(const PlacedShape &a, const PlacedShape &b, Simplex &s, GjkResult &result)
+{
+	static const glm::vec3 axes[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+
+	// a second point along any axis
+	for (int k = 0; s.count == 1 && k < 6; k++)
+	{
+		SupportPoint p = support(a, b, k < 3 ? axes[k] : -axes[k - 3], result);
+		if (glm::length(p.w - s.v[0].w) > EPA_TOLERANCE)
+			s.v[s.count++] = p;
+	}
+	// a third point off the line, turning around it
+	if (s.count == 2)
+	{
+		glm::vec3 line = s.v[1].w - s.v[0].w;
+		glm::vec3 axis = std::fabs(line.x) < std::fabs(line.y) ? (std::fabs(line.x) < std::fabs(line.z) ? axes[0] : axes[2]) : (std::fabs(line.y) < std::fabs(line.z) ? axes[1] : axes[2]);
+		glm::vec3 u = glm::normalize(glm::cross(line, axis));
+		glm::vec3 v = glm::normalize(glm::cross(line, u));
+		for (int k = 0; s.count == 2 && k < 6; k++)
+		{
+			float angle = k * 3.14159265f / 3.0f;
+			SupportPoint p = support(a, b, std::cos(angle) * u + std::sin(angle) * v, result);
+			if (glm::length(glm::cross(p.w - s.v[0].w, line)) > EPA_TOLERANCE * glm::length(line))
+				s.v[s.count++] = p;
+		}
+	}
+	// a fourth point off the plane, on either side
+	if (s.count == 3)
+	{
+		glm::vec3 n = glm::cross(s.v[1].w - s.v[0].w, s.v[2].w - s.v[0].w);
+		for (int side = 0; s.count == 3 && side < 2; side++)
+		{
+			SupportPoint p = support(a, b, side == 0 ? n : -n, result);
+			if (std::fabs(glm::dot(p.w - s.v[0].w, n)) > EPA_TOLERANCE * glm::length(n))
+				s.v[s.count++] = p;
+		}
+	}
+	return s.count == 4;
+}
+
+// expand the tetrahedron around the origin until its nearest face is on
+// the boundary of A - B. Visible faces are removed and the hole is closed
+// with a fan of faces from the new point to the edges around it
+static void epa(const PlacedShape &a, const PlacedShape &b, Simplex &s, GjkResult &result)
+{
+	std::vector<SupportPoint> points(s.v, s.v + 4);
+	std::vector<EpaFace> faces;
+	std::vector<std::pair<unsigned int, unsigned int>> horizon;
+
+	// faces of the tetrahedron, wound so the normals point outwards
+	static const unsigned int tetrahedron[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+	for (int f = 0; f < 4; f++)
+	{
+		EpaFace face;
+		if (!makeFace(points, tetrahedron[f][0], tetrahedron[f][1], tetrahedron[f][2], face))
+			continue;
+		if (glm::dot(face.normal, points[tetrahedron[f][3]].w - points[tetrahedron[f][0]].w) > 0.0f)
+		{
+			makeFace(points, tetrahedron[f][0], tetrahedron[f][2], tetrahedron[f][1], face);
+		}
+		faces.push_back(face);
+	}
+
+	EpaFace nearest;
+	bool found = false;
+	for (int iteration = 0; iteration < EPA_MAX_ITERATIONS && !faces.empty(); iteration++)
+	{
+		unsigned int best = 0;
+		for (unsigned int f = 1; f < faces.size(); f++)
+		{
+			if (faces[f].distance < faces[best].distance)
+				best = f;
+		}
+		nearest = faces[best];
+		found = true;
+
+		SupportPoint p = support(a, b, nearest.normal, result);
+		if (glm::dot(p.w, nearest.normal) - nearest.distance < EPA_TOLERANCE)
+			break;
+
+		// remove the faces the new point sees, an edge shared by two of
+		// them is inside the hole, the others are its rim
+		const unsigned int added = (unsigned int)points.size();
+		points.push_back(p);
+		horizon.clear();
+		for (unsigned int f = 0; f < faces.size();)
+		{
+			if (glm::dot(faces[f].normal, p.w - points[faces[f].v[0]].w) <= 0.0f)
+			{
+				f++;
+				continue;
+			}
+			for (int e = 0; e < 3; e++)
+			{
+				std::pair<unsigned int, unsigned int> edge(faces[f].v[e], faces[f].v[(e + 1) % 3]);
+				bool shared = false;
+				for (unsigned int h = 0; h < horizon.size(); h++)
+				{
+					if (horizon[h].first == edge.second && horizon[h].second == edge.first)
+					{
+						horizon[h] = horizon.back();
+						horizon.pop_back();
+						shared = true;
+						break;
+					}
+				}
+				if (!shared)
+					horizon.push_back(edge);
+			}
+			faces[f] = faces.back();
+			faces.pop_back();
+		}
+
+		for (const std::pair<unsigned int, unsigned int> &edge : horizon)
+		{
+			EpaFace face;
+			if (makeFace(points, edge.first, edge.second, added, face))
+				faces.push_back(face);
+		}
+	}
+
+	if (!found)
+	{
+		result.depth = 0.0f;
+		result.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		result.pointA = s.v[0].a;
+		result.pointB = s.v[0].b;
+		return;
+	}
+
+	// weights of the origin's projection on the nearest face
+	const glm::vec3 p = nearest.distance * nearest.normal;
+	const SupportPoint &v0 = points[nearest.v[0]];
+	const SupportPoint &v1 = points[nearest.v[1]];
+	const SupportPoint &v2 = points[nearest.v[2]];
+	glm::vec3 n = glm::cross(v1.w - v0.w, v2.w - v0.w);
+	float area = glm::dot(n, n);
+	float l1 = area > 0.0f ? glm::dot(glm::cross(p - v0.w, v2.w - v0.w), n) / area : 0.0f;
+	float l2 = area > 0.0f ? glm::dot(glm::cross(v1.w - v0.w, p - v0.w), n) / area : 0.0f;
+	float l0 = 1.0f - l1 - l2;
+
+	result.depth = nearest.distance;
+	result.normal = nearest.normal;
+	result.pointA = l0 * v0.a + l1 * v1.a + l2 * v2.a;
+	result.pointB = l0 * v0.b + l1 * v1.b + l2 * v2.b;
+}
+
+bool computePenetration(const PlacedShape &a, const PlacedShape &b, GjkCache *cache, GjkResult &result)
+{
+	result.supportCalls = 0;
+	Simplex s;
+	if (!gjk(a, b, cache, s, result))
+		return false;
+
+	if (growToTetrahedron(a, b, s, result))
+	{
+		epa(a, b, s, result);
+	}
+	else
+	{
+		// flat shapes just touching, there is no depth to find
+		result.depth = 0.0f;
+		glm::vec3 d = b.toWorld(b.shape->getCentre()) - a.toWorld(a.shape->getCentre());
+		result.normal = glm::dot(d, d) > 0.0f ? glm::normalize(d) : glm::vec3(0.0f, 1.0f, 0.0f);
+		result.pointA = s.v[0].a;
+		result.pointB = s.v[0].b;
+	}
+	return true;
+}
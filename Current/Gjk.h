@@ -0,0 +1,55 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "ConvexShape.h"
+
+// a convex shape placed in the world by the model matrix of its body
+struct PlacedShape
+{
+	const ConvexShape *shape;
+	glm::mat3 basis;		// rotation and scale, the upper 3x3 of the model matrix
+	glm::vec3 origin;		// translation
+
+	PlacedShape(const ConvexShape *shape, const glm::mat4 &model)
+		: shape(shape), basis(glm::mat3(model)), origin(glm::vec3(model[3])) {}
+
+	// model space point of the shape furthest along the world direction dir
+	glm::vec3 localSupport(const glm::vec3 &dir) const { return shape->support(glm::transpose(basis) * dir); }
+	glm::vec3 toWorld(const glm::vec3 &local) const { return basis * local + origin; }
+};
+
+// the simplex GJK finished with, in the model space of each shape, so the
+// next query between the same two bodies can start from it after they move
+struct GjkCache
+{
+	glm::vec3 localA[4];
+	glm::vec3 localB[4];
+	unsigned int count = 0;
+};
+
+struct GjkResult
+{
+	bool intersecting = false;
+	float distance = 0.0f;		// between the shapes when apart
+	float depth = 0.0f;			// how far they overlap, found by EPA
+	glm::vec3 normal;			// unit, from A towards B: moving B by depth * normal separates them
+	glm::vec3 pointA;			// closest (or deepest) point of A, world space
+	glm::vec3 pointB;			// same for B
+	unsigned int supportCalls = 0;	// support points taken from the pair of shapes
+};
+
+/*
+** GJK AND EPA
+** GJK finds the point of the Minkowski difference A - B closest to the
+** origin by growing and shrinking a simplex of at most four support
+** points. The shapes intersect if the origin is enclosed, otherwise the
+** closest point gives the distance and the nearest points of A and B.
+** EPA then expands the final simplex into a polytope until the face
+** nearest the origin lies on the boundary of A - B, which gives the
+** penetration depth and normal. A few support calls replace any scan
+** of the vertices, and a cache passed in starts GJK from the last step.
+*/
+
+// distance between a and b, stopping as soon as they are known to intersect
+bool computeDistance(const PlacedShape &a, const PlacedShape &b, GjkCache *cache, GjkResult &result);
+// as computeDistance(), and the penetration depth and normal if they intersect
+bool computePenetration(const PlacedShape &a, const PlacedShape &b, GjkCache *cache, GjkResult &result);
@@ -0,0 +1,75 @@
+#include <cstdint>
+#include "GraphColoring.h"
+
+// every element takes the lowest color none of its particles uses yet,
+// a particle tracks the colors it is in with a 64 bit mask
+void colorElements(unsigned int count, unsigned int arity, const unsigned int *const *particles, ElementColoring &coloring)
+{
+	const unsigned int maxColors = ElementColoring::MAX_COLORS;
+
+	coloring.clear();
+	if (count == 0)
+		return;
+
+	// number of particles referenced
+	unsigned int particleCount = 0;
+	for (unsigned int k = 0; k < arity; k++)
+	{
+		for (unsigned int e = 0; e < count; e++)
+		{
+			if (particles[k][e] >= particleCount)
+				particleCount = particles[k][e] + 1;
+		}
+	}
+
+	std::vector<uint64_t> used(particleCount, 0);
+	std::vector<unsigned int> color(count);
+	std::vector<unsigned int> colorSize(maxColors + 1, 0);
+
+	for (unsigned int e = 0; e < count; e++)
+	{
+		uint64_t taken = 0;
+		for (unsigned int k = 0; k < arity; k++)
+		{
+			taken |= used[particles[k][e]];
+		}
+
+		unsigned int c = 0;
+		while (c < maxColors && (taken & ((uint64_t)1 << c)))
+		{
+			c++;
+		}
+
+		if (c < maxColors)
+		{
+			for (unsigned int k = 0; k < arity; k++)
+			{
+				used[particles[k][e]] |= (uint64_t)1 << c;
+			}
+		}
+		color[e] = c;
+		colorSize[c]++;
+	}
+
+	// drop the empty colors at the end, counting sort the elements by color
+	unsigned int colorCount = maxColors + 1;
+	while (colorSize[colorCount - 1] == 0)
+	{
+		colorCount--;
+	}
+
+	coloring.colorStart.resize(colorCount + 1);
+	coloring.colorStart[0] = 0;
+	for (unsigned int c = 0; c < colorCount; c++)
+	{
+		coloring.colorStart[c + 1] = coloring.colorStart[c] + colorSize[c];
+	}
+
+	std::vector<unsigned int> next(coloring.colorStart.begin(), coloring.colorStart.end() - 1);
+	coloring.order.resize(count);
+	for (unsigned int e = 0; e < count; e++)
+	{
+		coloring.order[next[color[e]]++] = e;
+	}
+}
+
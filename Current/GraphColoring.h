@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+
+/*
+** ELEMENT COLORING
+** Groups elements (springs, triangles, ...) that each touch a few particles
+** into colors so that no two elements of the same color share a particle.
+** The elements of one color can then scatter their forces in parallel
+** without atomics or locks, and processing the colors in a fixed order
+** gives the same sums whatever the number of threads.
+*/
+struct ElementColoring
+{
+	// colors tracked per particle, elements that find them all taken go to
+	// one extra color whose elements may share particles
+	static const unsigned int MAX_COLORS = 64;
+
+	std::vector<unsigned int> order;		// element indices, grouped by color
+	std::vector<unsigned int> colorStart;	// color c is order[colorStart[c]] to order[colorStart[c + 1]]
+
+	unsigned int getColorCount() const { return colorStart.empty() ? 0 : (unsigned int)colorStart.size() - 1; }
+	// true if the elements of color c have to be processed one at a time
+	static bool isShared(unsigned int c) { return c >= MAX_COLORS; }
+	void clear() { order.clear(); colorStart.clear(); }
+};
+
+// greedy coloring of count elements, particles[k][e] is the k-th particle of
+// element e, for k below arity. Elements keep their relative order within a color
+void colorElements(unsigned int count, unsigned int arity, const unsigned int *const *particles, ElementColoring &coloring);
@@ -0,0 +1,150 @@
+/*
+** HEADLESS SIMULATION DRIVER
+** Steps a scene as fast as the CPU allows with no window and no GL context.
+** Built by the headless project with HEADLESS defined, which keeps GLFW and
+** GLEW out of the build and stops Mesh from creating GL objects. The sources
+** it uses only need glm and threads. headless.vcxproj lists them, so on
+** Linux it builds from that list with e.g.
+**   g++ -O2 -std=c++14 -DHEADLESS -Iglm -o headless
+**       $(grep -o '[A-Za-z]*\.cpp' headless.vcxproj) -lpthread
+**
+** usage: headless [-scene name] [-size n] [-steps n | -time seconds] [-dt seconds] [-integrator name] [-tolerance metres] [-broadphase name] [-iterations n] [-nosleep] [-threads n]
+*/
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "JobSystem.h"
+#include "Scene.h"
+
+using namespace std;
+
+// print the command line options
+static void printUsage()
+{
+	cout << "usage: headless [-scene name] [-size n] [-steps n | -time seconds] [-dt seconds] [-integrator name] [-tolerance metres] [-broadphase name] [-iterations n] [-nosleep] [-threads n]" << endl;
+	cout << "  -scene  scene to run (cloth, drape, dome, chain, boxes, piles, cloud, gas) default boxes" << endl;
+	cout << "  -size   scene size (cloth side, particles, boxes, piles) default 1, drape and dome need 2" << endl;
+	cout << "  -steps  number of fixed steps to run          default 1000" << endl;
+	cout << "  -time   simulated time to reach (overrides -steps)" << endl;
+	cout << "  -dt     fixed time step                       default 0.01" << endl;
+	cout << "  -integrator  particle integrator (euler, verlet, rk4, adaptive-euler, adaptive-verlet, adaptive-rk4) default euler" << endl;
+	cout << "  -tolerance   error allowed per step by the adaptive integrators default 0.001" << endl;
+	cout << "  -broadphase  body pair search of the box scenes (tree, sap, brute) default tree" << endl;
+	cout << "  -iterations  contact solver iterations of the box scenes default 10" << endl;
+	cout << "  -nosleep     keep every body of the box scenes awake" << endl;
+	cout << "  -threads threads running the step, 0 for all  default 0" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	string sceneName = "boxes";
+	unsigned int size = 1;
+	unsigned long steps = 1000;
+	double targetTime = -1.0;
+	float dt = 0.01f;
+	string integrator = "euler";
+	float tolerance = 1.0e-3f;
+	unsigned int threads = 0;
+	Broadphase broadphase = BROADPHASE_TREE;
+	unsigned int iterations = 10;
+	bool sleeping = true;
+
+	// parse arguments
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "-scene") == 0 && hasValue)
+			sceneName = argv[++i];
+		else if (strcmp(argv[i], "-size") == 0 && hasValue)
+			size = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-steps") == 0 && hasValue)
+			steps = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-time") == 0 && hasValue)
+			targetTime = atof(argv[++i]);
+		else if (strcmp(argv[i], "-dt") == 0 && hasValue)
+			dt = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "-integrator") == 0 && hasValue)
+			integrator = argv[++i];
+		else if (strcmp(argv[i], "-tolerance") == 0 && hasValue)
+			tolerance = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "-broadphase") == 0 && hasValue)
+		{
+			if (!parseBroadphase(argv[++i], broadphase))
+			{
+				printUsage();
+				return EXIT_FAILURE;
+			}
+		}
+		else if (strcmp(argv[i], "-iterations") == 0 && hasValue)
+			iterations = (unsigned int)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-nosleep") == 0)
+			sleeping = false;
+		else if (strcmp(argv[i], "-threads") == 0 && hasValue)
+			threads = (unsigned int)atoi(argv[++i]);
+		else
+		{
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (dt <= 0.0f || tolerance <= 0.0f)
+	{
+		cerr << "time step and tolerance must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+
+	getJobSystem().setThreadCount(threads);
+
+	Scene *scene = createScene(sceneName, size, integrator);
+	if (scene == nullptr)
+	{
+		cerr << "unknown scene or integrator, or size too small: " << sceneName << ", " << integrator << ", " << size << endl;
+		printUsage();
+		return EXIT_FAILURE;
+	}
+	scene->setTolerance(tolerance);
+	scene->setBroadphase(broadphase);
+	scene->setSolverIterations(iterations);
+	scene->setSleeping(sleeping);
+
+	// run until the step count or the simulated time target is reached
+	unsigned long taken = 0;
+	auto start = chrono::steady_clock::now();
+	if (targetTime >= 0.0)
+	{
+		while (scene->getTime() < targetTime)
+		{
+			scene->step(dt);
+			taken++;
+		}
+	}
+	else
+	{
+		for (taken = 0; taken < steps; taken++)
+		{
+			scene->step(dt);
+		}
+	}
+	double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// report
+	cout << "scene:     " << scene->getName() << " (" << scene->getSize() << ")" << endl;
+	const StepStats &stats = scene->getStepStats();
+	cout << "integrator: " << scene->getIntegratorName() << endl;
+	cout << "substeps:  " << stats.taken << " taken, " << stats.rejected << " rejected, " << stats.failed << " failed" << endl;
+	cout << "substep:   " << stats.minStep << " to " << stats.maxStep << " s" << endl;
+	cout << "steps:     " << taken << endl;
+	cout << "sim time:  " << scene->getTime() << " s" << endl;
+	cout << "wall time: " << wall << " s" << endl;
+	if (wall > 0.0)
+	{
+		cout << "steps/s:   " << taken / wall << endl;
+	}
+
+	delete scene;
+
+	return EXIT_SUCCESS;
+}
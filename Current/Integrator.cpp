@@ -0,0 +1,178 @@
+#include "Integrator.h"
+#include "JobSystem.h"
+
+// particles per parallel chunk of the update loops
+static const unsigned int INTEGRATOR_GRAIN = 8192;
+
+/*
+** PARTICLE INTEGRATOR BASE CLASS
+*/
+void ParticleIntegrator::resize(unsigned int n)
+{
+	m_force.resize(n);
+	m_pos.resize(n);
+	m_vel.resize(n);
+	m_acc.resize(n);
+}
+
+// the time before the evaluation goes to integration, the evaluation to force
+void ParticleIntegrator::evaluate(const ParticleSystem &ps, const ForcePipeline &forces, const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *acc, PhaseTimer *timer)
+{
+	if (timer != nullptr)
+		timer->lap(PHASE_INTEGRATION);
+
+	glm::vec3 *force = m_force.data();
+	const float *invMass = ps.getInvMasses().data();
+	JobSystem &jobs = getJobSystem();
+
+	jobs.parallelFor(0, ps.size(), INTEGRATOR_GRAIN, [force](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			force[i] = glm::vec3(0.0f);
+		}
+	});
+	forces.accumulate(ps, pos, vel, force);
+	jobs.parallelFor(0, ps.size(), INTEGRATOR_GRAIN, [force, invMass, acc](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			acc[i] = force[i] * invMass[i];
+		}
+	});
+
+	if (timer != nullptr)
+		timer->lap(PHASE_FORCE);
+}
+
+/*
+** SEMI-IMPLICIT EULER
+*/
+void SemiImplicitEuler::step(ParticleSystem &ps, const ForcePipeline &forces, float dt, PhaseTimer *timer)
+{
+	resize(ps.size());
+	evaluate(ps, forces, ps.getPositions().data(), ps.getVelocities().data(), ps.getAccelerations().data(), timer);
+
+	ps.integrate(dt);
+
+	m_stats.accept(dt);
+	if (timer != nullptr)
+		timer->lap(PHASE_INTEGRATION);
+}
+
+/*
+** VELOCITY VERLET
+*/
+void VelocityVerlet::step(ParticleSystem &ps, const ForcePipeline &forces, float dt, PhaseTimer *timer)
+{
+	const unsigned int n = ps.size();
+	glm::vec3 *pos = ps.getPositions().data();
+	glm::vec3 *vel = ps.getVelocities().data();
+	glm::vec3 *acc = ps.getAccelerations().data();
+
+	// first step (or the particles changed), there is no kept acceleration
+	if (!m_primed || m_acc.size() != n)
+	{
+		resize(n);
+		evaluate(ps, forces, pos, vel, acc, timer);
+		m_primed = true;
+	}
+
+	// drift the positions and take the velocities to the half step
+	glm::vec3 *halfVel = m_vel.data();
+	getJobSystem().parallelFor(0, n, INTEGRATOR_GRAIN, [=](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			halfVel[i] = vel[i] + (0.5f * dt) * acc[i];
+			pos[i] += dt * halfVel[i];
+		}
+	});
+
+	// acceleration at the new positions, kept for the next step
+	evaluate(ps, forces, pos, halfVel, acc, timer);
+
+	getJobSystem().parallelFor(0, n, INTEGRATOR_GRAIN, [=](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			vel[i] = halfVel[i] + (0.5f * dt) * acc[i];
+		}
+	});
+
+	m_stats.accept(dt);
+	if (timer != nullptr)
+		timer->lap(PHASE_INTEGRATION);
+}
+
+/*
+** RUNGE-KUTTA 4
+*/
+
+// k1 at the start, k2 and k3 at the midpoint, k4 at the end. The stage
+// state is rebuilt from the start state each time and the weighted sums
+// (k1 + 2 k2 + 2 k3 + k4) are built up as the stages are evaluated
+void RungeKutta4::step(ParticleSystem &ps, const ForcePipeline &forces, float dt, PhaseTimer *timer)
+{
+	const unsigned int n = ps.size();
+	resize(n);
+	m_dx.resize(n);
+	m_dv.resize(n);
+
+	glm::vec3 *pos = ps.getPositions().data();
+	glm::vec3 *vel = ps.getVelocities().data();
+	glm::vec3 *stagePos = m_pos.data();
+	glm::vec3 *stageVel = m_vel.data();
+	glm::vec3 *stageAcc = m_acc.data();
+	glm::vec3 *dx = m_dx.data();
+	glm::vec3 *dv = m_dv.data();
+	JobSystem &jobs = getJobSystem();
+
+	// k1, its acceleration is also the one reported for the step
+	glm::vec3 *acc = ps.getAccelerations().data();
+	evaluate(ps, forces, pos, vel, acc, timer);
+	jobs.parallelFor(0, n, INTEGRATOR_GRAIN, [=](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			dx[i] = vel[i];
+			dv[i] = acc[i];
+			stagePos[i] = pos[i] + (0.5f * dt) * vel[i];
+			stageVel[i] = vel[i] + (0.5f * dt) * acc[i];
+		}
+	});
+
+	// k2 and k3 are weighted twice, k3 is taken at the midpoint and k4 at the end
+	const float stageStep[2] = { 0.5f * dt, dt };
+	for (int k = 0; k < 2; k++)
+	{
+		const float h = stageStep[k];
+		evaluate(ps, forces, stagePos, stageVel, stageAcc, timer);
+		jobs.parallelFor(0, n, INTEGRATOR_GRAIN, [=](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				glm::vec3 v = stageVel[i];
+				dx[i] += 2.0f * v;
+				dv[i] += 2.0f * stageAcc[i];
+				stagePos[i] = pos[i] + h * v;
+				stageVel[i] = vel[i] + h * stageAcc[i];
+			}
+		});
+	}
+
+	// k4, then the weighted average of the four slopes
+	evaluate(ps, forces, stagePos, stageVel, stageAcc, timer);
+	jobs.parallelFor(0, n, INTEGRATOR_GRAIN, [=](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			pos[i] += (dt / 6.0f) * (dx[i] + stageVel[i]);
+			vel[i] += (dt / 6.0f) * (dv[i] + stageAcc[i]);
+		}
+	});
+
+	m_stats.accept(dt);
+	if (timer != nullptr)
+		timer->lap(PHASE_INTEGRATION);
+}
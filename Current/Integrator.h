@@ -0,0 +1,287 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <limits>
+#include <string>
+#include <vector>
+#include "ForcePipeline.h"
+#include "ParticleSystem.h"
+#include "PhaseTimer.h"
+
+/*
+** PARTICLE INTEGRATORS
+** Each integrator advances the whole state of a ParticleSystem by one step.
+** Forces are never read from the system as it is: every evaluation passes
+** the positions and velocities of the stage to ForcePipeline::accumulate(),
+** so multi stage methods see the correct intermediate state.
+** The integrators share no virtual interface, a scene picks one as a
+** template argument. They all provide
+**   static const char *getName();
+**   static unsigned int getOrder();			order of accuracy
+**   static unsigned int getEvaluations();	force evaluations per step
+**   void step(ParticleSystem &ps, const ForcePipeline &forces, float dt, PhaseTimer *timer);
+** and time their force evaluations and updates into the timer if given.
+*/
+
+// steps an integrator has taken, an adaptive one splits each step() into several
+struct StepStats
+{
+	unsigned long taken = 0;	// accepted steps
+	unsigned long rejected = 0;	// steps thrown away for exceeding the tolerance
+	unsigned long failed = 0;	// steps that left the state non-finite even at the smallest size
+	float lastStep = 0.0f;		// size of the last accepted step
+	float minStep = 0.0f;		// smallest accepted step
+	float maxStep = 0.0f;		// largest accepted step
+
+	// count an accepted step of size h
+	void accept(float h)
+	{
+		minStep = taken == 0 ? h : std::min(minStep, h);
+		maxStep = taken == 0 ? h : std::max(maxStep, h);
+		lastStep = h;
+		taken++;
+	}
+};
+
+/*
+** PARTICLE INTEGRATOR BASE CLASS
+** Scratch arrays and the acceleration evaluation shared by the integrators.
+*/
+class ParticleIntegrator
+{
+public:
+	const StepStats &getStats() const { return m_stats; }
+	// error allowed per step by adaptive integrators, fixed step ones ignore it
+	void setTolerance(float tolerance) { m_tolerance = tolerance; }
+	float getTolerance() const { return m_tolerance; }
+
+protected:
+	// acc = F(pos, vel) / m for every particle, fixed particles get none
+	void evaluate(const ParticleSystem &ps, const ForcePipeline &forces, const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *acc, PhaseTimer *timer);
+	// make room for n particles in the scratch arrays
+	void resize(unsigned int n);
+
+	std::vector<glm::vec3> m_force;	// force accumulators of an evaluation
+	std::vector<glm::vec3> m_pos;	// positions of the stage being evaluated
+	std::vector<glm::vec3> m_vel;	// velocities of the stage being evaluated
+	std::vector<glm::vec3> m_acc;	// accelerations of the stage
+
+	StepStats m_stats;
+	float m_tolerance = 1.0e-3f;	// metres
+};
+
+/*
+** SEMI-IMPLICIT EULER
+** v += a dt, x += v dt. One evaluation per step, first order, stable for
+** springs as long as dt stays well below the period of the stiffest one.
+*/
+class SemiImplicitEuler : public ParticleIntegrator
+{
+public:
+	static const char *getName() { return "euler"; }
+	static unsigned int getOrder() { return 1; }
+	static unsigned int getEvaluations() { return 1; }
+
+	void step(ParticleSystem &ps, const ForcePipeline &forces, float dt, PhaseTimer *timer = nullptr);
+};
+
+/*
+** VELOCITY VERLET
+** x += v dt + a dt^2 / 2, then the new acceleration, then v += (a + a') dt / 2.
+** Second order and time reversible for position dependent forces, still one
+** evaluation per step since a' is kept for the next one. Damping forces are
+** evaluated with the half step velocity.
+*/
+class VelocityVerlet : public ParticleIntegrator
+{
+public:
+	static const char *getName() { return "verlet"; }
+	static unsigned int getOrder() { return 2; }
+	static unsigned int getEvaluations() { return 1; }
+
+	void step(ParticleSystem &ps, const ForcePipeline &forces, float dt, PhaseTimer *timer = nullptr);
+	// forget the kept acceleration, call after the state was changed by hand
+	void reset() { m_primed = false; }
+
+private:
+	bool m_primed = false;	// ps accelerations are those of the current state
+};
+
+/*
+** RUNGE-KUTTA 4
+** The classic fourth order method on the state (x, v) with derivative (v, a).
+** Four evaluations per step, which buys a much larger stable dt.
+*/
+class RungeKutta4 : public ParticleIntegrator
+{
+public:
+	static const char *getName() { return "rk4"; }
+	static unsigned int getOrder() { return 4; }
+	static unsigned int getEvaluations() { return 4; }
+
+	void step(ParticleSystem &ps, const ForcePipeline &forces, float dt, PhaseTimer *timer = nullptr);
+
+private:
+	std::vector<glm::vec3> m_dx;	// weighted sum of the stage velocities
+	std::vector<glm::vec3> m_dv;	// weighted sum of the stage accelerations
+};
+
+/*
+** ADAPTIVE INTEGRATOR
+** Step doubling around any of the integrators above. Each substep is taken
+** once with size h and again as two steps of h / 2 from the same state; the
+** difference between the two estimates the error of the pair of half steps.
+** Within the tolerance the half steps are kept and h is allowed to grow,
+** otherwise the state is restored and h is shrunk. step(dt) takes as many
+** substeps as it needs to cover dt, and h carries over to the next call,
+** so a calm system runs with a few large substeps and an impact with many
+** small ones. h never goes below a positive minimum, where the half steps
+** are kept whatever their error. A state that is no longer finite is a
+** failure: h is shrunk as far as it will go, and if that does not help the
+** state is restored and the rest of dt is given up, counted in the stats.
+*/
+template <class Base>
+class AdaptiveIntegrator : public ParticleIntegrator
+{
+public:
+	static std::string getName() { return std::string("adaptive-") + Base::getName(); }
+	static unsigned int getOrder() { return Base::getOrder(); }
+	// per attempted substep
+	static unsigned int getEvaluations() { return 3 * Base::getEvaluations(); }
+
+	void step(ParticleSystem &ps, const ForcePipeline &forces, float dt, PhaseTimer *timer = nullptr);
+
+	// bounds on the substep size. A minimum of 0 means a millionth of dt,
+	// a maximum of 0 means no bound
+	void setStepLimits(float minStep, float maxStep) { m_minStep = minStep; m_maxStep = maxStep; }
+
+private:
+	// copy the state of the system to or from the saved arrays
+	void save(const ParticleSystem &ps, std::vector<glm::vec3> &pos, std::vector<glm::vec3> &vel, std::vector<glm::vec3> &acc) const;
+	void restore(ParticleSystem &ps, const std::vector<glm::vec3> &pos, const std::vector<glm::vec3> &vel, const std::vector<glm::vec3> &acc) const;
+	// largest difference between the current state and the saved full step
+	float estimateError(const ParticleSystem &ps, float h) const;
+
+	Base m_full;	// takes the single step of h
+	Base m_half;	// takes the two steps of h / 2
+
+	std::vector<glm::vec3> m_startPos, m_startVel, m_startAcc;	// state at the start of the substep
+	std::vector<glm::vec3> m_fullPos, m_fullVel;				// state after the single step
+
+	float m_step = 0.0f;	// next substep size, 0 until the first step
+	float m_minStep = 0.0f;
+	float m_maxStep = 0.0f;
+};
+
+/*
+** ADAPTIVE METHODS
+*/
+template <class Base>
+void AdaptiveIntegrator<Base>::save(const ParticleSystem &ps, std::vector<glm::vec3> &pos, std::vector<glm::vec3> &vel, std::vector<glm::vec3> &acc) const
+{
+	pos = ps.getPositions();
+	vel = ps.getVelocities();
+	acc = ps.getAccelerations();
+}
+
+template <class Base>
+void AdaptiveIntegrator<Base>::restore(ParticleSystem &ps, const std::vector<glm::vec3> &pos, const std::vector<glm::vec3> &vel, const std::vector<glm::vec3> &acc) const
+{
+	ps.getPositions() = pos;
+	ps.getVelocities() = vel;
+	ps.getAccelerations() = acc;
+}
+
+// the half steps are 2^p times more accurate than the full step, so their
+// own error is the difference divided by 2^p - 1. Velocity differences are
+// turned into a distance by the step size
+template <class Base>
+float AdaptiveIntegrator<Base>::estimateError(const ParticleSystem &ps, float h) const
+{
+	const std::vector<glm::vec3> &pos = ps.getPositions();
+	const std::vector<glm::vec3> &vel = ps.getVelocities();
+
+	float error = 0.0f;
+	for (unsigned int i = 0; i < ps.size(); i++)
+	{
+		// std::max may drop a NaN, which has to reach step()
+		const float position = glm::length(pos[i] - m_fullPos[i]);
+		const float velocity = h * glm::length(vel[i] - m_fullVel[i]);
+		if (!std::isfinite(position) || !std::isfinite(velocity))
+			return std::numeric_limits<float>::infinity();
+		error = std::max(error, std::max(position, velocity));
+	}
+
+	return error / (float)((1u << getOrder()) - 1);
+}
+
+template <class Base>
+void AdaptiveIntegrator<Base>::step(ParticleSystem &ps, const ForcePipeline &forces, float dt, PhaseTimer *timer)
+{
+	// how far one attempt may change the step
+	const float safety = 0.9f;
+	const float minScale = 0.2f;
+	const float maxScale = 5.0f;
+
+	// the smallest substep, so that shrinking always ends
+	const float minStep = std::max(m_minStep, 1.0e-6f * dt);
+
+	if (m_step <= 0.0f)
+		m_step = dt;
+
+	float remaining = dt;
+	while (remaining > 0.0f)
+	{
+		// take the rest of the frame if it is (nearly) within reach
+		float h = m_step;
+		bool last = h >= remaining * (1.0f - 1.0e-4f);
+		if (last)
+			h = remaining;
+
+		save(ps, m_startPos, m_startVel, m_startAcc);
+
+		m_full.step(ps, forces, h, timer);
+		m_fullPos = ps.getPositions();
+		m_fullVel = ps.getVelocities();
+		restore(ps, m_startPos, m_startVel, m_startAcc);
+
+		m_half.step(ps, forces, 0.5f * h, timer);
+		m_half.step(ps, forces, 0.5f * h, timer);
+
+		// a NaN or infinite error is never accepted, however small h is
+		float ratio = estimateError(ps, h) / m_tolerance;
+		bool finite = std::isfinite(ratio);
+		bool accept = finite && (ratio <= 1.0f || h <= minStep);
+		if (accept)
+		{
+			m_stats.accept(h);
+			remaining = last ? 0.0f : remaining - h;
+		}
+		else
+		{
+			m_stats.rejected++;
+			restore(ps, m_startPos, m_startVel, m_startAcc);
+		}
+
+		// h * (tolerance / error)^(1 / (p + 1)) is the step that would just meet
+		// the tolerance, a step cut short at the end of the frame does not grow it
+		float scale = !finite ? minScale : (ratio > 0.0f ? safety * std::pow(ratio, -1.0f / (getOrder() + 1)) : maxScale);
+		scale = std::min(maxScale, std::max(minScale, scale));
+		if (!(accept && last && scale > 1.0f))
+			m_step = h * scale;
+		m_step = std::max(m_step, minStep);
+		if (m_maxStep > 0.0f)
+			m_step = std::min(m_step, m_maxStep);
+
+		if (timer != nullptr)
+			timer->lap(PHASE_INTEGRATION);
+
+		// not even the smallest step keeps the state finite
+		if (!finite && h <= minStep)
+		{
+			m_stats.failed++;
+			break;
+		}
+	}
+}
@@ -0,0 +1,268 @@
+#include "JobSystem.h"
+
+// the system and deque the current thread belongs to, if it is a worker
+static thread_local const JobSystem *s_owner = nullptr;
+static thread_local unsigned int s_queue = 0;
+
+JobSystem::JobSystem()
+{
+	m_queued = 0;
+	m_sleeping = 0;
+	m_quit = false;
+	start(0);
+}
+
+JobSystem::~JobSystem()
+{
+	stop();
+}
+
+JobSystem &getJobSystem()
+{
+	static JobSystem system;
+	return system;
+}
+
+/*
+** WORKERS
+*/
+void JobSystem::setThreadCount(unsigned int count)
+{
+	if (count == 0)
+	{
+		count = std::thread::hardware_concurrency();
+		if (count == 0)
+			count = 1;
+	}
+
+	stop();
+	start(count - 1);
+}
+
+void JobSystem::start(unsigned int workers)
+{
+	m_quit = false;
+	m_queues.clear();
+	for (unsigned int i = 0; i < workers + 1; i++)
+	{
+		m_queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+	}
+	for (unsigned int i = 0; i < workers; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::workerLoop, this, i + 1));
+	}
+}
+
+void JobSystem::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	for (std::thread &worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+void JobSystem::workerLoop(unsigned int queue)
+{
+	s_owner = this;
+	s_queue = queue;
+
+	for (;;)
+	{
+		Task task;
+		if (findTask(queue, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		// nothing to run or steal, sleep until a job is pushed. m_sleeping is
+		// raised before m_queued is checked, and push() raises m_queued before
+		// checking m_sleeping, so a push can not go unnoticed
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleeping++;
+		m_wake.wait(lock, [this] { return m_quit || m_queued.load() > 0; });
+		m_sleeping--;
+		if (m_quit)
+			return;
+	}
+}
+
+/*
+** JOBS
+*/
+unsigned int JobSystem::getQueueIndex() const
+{
+	return s_owner == this ? s_queue : 0;
+}
+
+void JobSystem::push(unsigned int queue, const Task &task)
+{
+	// counted before it is visible, so m_queued never drops below zero
+	m_queued++;
+	{
+		std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+		m_queues[queue]->tasks.push_back(task);
+	}
+
+	if (m_sleeping.load() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_wake.notify_one();
+	}
+}
+
+bool JobSystem::findTask(unsigned int queue, Task &task)
+{
+	if (m_queued.load() == 0)
+		return false;
+
+	// newest job of our own deque first, it is the most likely to be in cache
+	{
+		TaskQueue &own = *m_queues[queue];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			m_queued--;
+			return true;
+		}
+	}
+
+	// then the oldest job of the next deque that has one
+	const unsigned int count = (unsigned int)m_queues.size();
+	for (unsigned int i = 1; i < count; i++)
+	{
+		TaskQueue &victim = *m_queues[(queue + i) % count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			m_queued--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::runTask(Task &task)
+{
+	task.job();
+
+	JobCounter *counter = task.counter;
+	if (counter == nullptr)
+		return;
+
+	// the counter is only touched under its lock, wait() takes the lock once
+	// it reads zero, so the counter can not be destroyed while we hold it
+	std::vector<JobCounter::Continuation> ready;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		if (--counter->m_pending > 0)
+			return;
+
+		// last job of the counter, release the jobs that depend on it
+		ready.swap(counter->m_continuations);
+	}
+	for (const JobCounter::Continuation &next : ready)
+	{
+		push(getQueueIndex(), Task{ next.job, next.counter });
+	}
+}
+
+void JobSystem::submit(const std::function<void()> &job, JobCounter *counter)
+{
+	if (counter != nullptr)
+		counter->m_pending++;
+
+	push(getQueueIndex(), Task{ job, counter });
+}
+
+void JobSystem::submitAfter(JobCounter &dependency, const std::function<void()> &job, JobCounter *counter)
+{
+	if (counter != nullptr)
+		counter->m_pending++;
+
+	// the finishing job decrements and takes the continuations under the
+	// same lock, so a job added here is either taken by it or pushed now
+	{
+		std::lock_guard<std::mutex> lock(dependency.m_mutex);
+		if (dependency.m_pending.load() > 0)
+		{
+			dependency.m_continuations.push_back(JobCounter::Continuation{ job, counter });
+			return;
+		}
+	}
+
+	push(getQueueIndex(), Task{ job, counter });
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+	const unsigned int queue = getQueueIndex();
+
+	while (!counter.isDone())
+	{
+		Task task;
+		if (findTask(queue, task))
+			runTask(task);
+		else
+			std::this_thread::yield();
+	}
+
+	// the thread that finished the last job may still hold the lock
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+// one job per thread takes chunks from a shared cursor until the range is
+// used up, so uneven chunks balance out without a job per chunk
+void JobSystem::parallelFor(unsigned int begin, unsigned int end, unsigned int grain, const std::function<void(unsigned int, unsigned int)> &body)
+{
+	if (begin >= end)
+		return;
+	if (grain == 0)
+		grain = 1;
+
+	const unsigned int chunks = (end - begin + grain - 1) / grain;
+	const unsigned int jobs = chunks < getThreadCount() ? chunks : getThreadCount();
+	if (jobs <= 1)
+	{
+		// the same chunks in order, callers keep per chunk state by chunk index
+		for (unsigned int chunkBegin = begin; chunkBegin < end; chunkBegin += grain)
+		{
+			body(chunkBegin, end - chunkBegin > grain ? chunkBegin + grain : end);
+		}
+		return;
+	}
+
+	std::atomic<unsigned int> next(begin);
+	auto runChunks = [&]()
+	{
+		for (;;)
+		{
+			unsigned int chunkBegin = next.fetch_add(grain);
+			if (chunkBegin >= end)
+				break;
+			unsigned int chunkEnd = end - chunkBegin > grain ? chunkBegin + grain : end;
+			body(chunkBegin, chunkEnd);
+		}
+	};
+
+	JobCounter counter;
+	for (unsigned int i = 1; i < jobs; i++)
+	{
+		submit(runChunks, &counter);
+	}
+	runChunks();
+	wait(counter);
+}
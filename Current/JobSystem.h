@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+/*
+** JOB COUNTER CLASS
+** Counts the jobs submitted against it that have not finished yet. A thread
+** can wait for it to reach zero, and jobs can be submitted to start only
+** once it does, which is how dependencies between jobs are expressed.
+*/
+class JobCounter
+{
+public:
+	JobCounter() : m_pending(0) {}
+
+	// true once every job submitted against the counter has finished,
+	// use JobSystem::wait() before destroying it
+	bool isDone() const { return m_pending.load() == 0; }
+
+private:
+	friend class JobSystem;
+
+	struct Continuation
+	{
+		std::function<void()> job;
+		JobCounter *counter;
+	};
+
+	std::atomic<unsigned int> m_pending;
+	std::mutex m_mutex;
+	std::vector<Continuation> m_continuations;	// jobs waiting for the counter to reach zero
+};
+
+/*
+** JOB SYSTEM CLASS
+** A fixed set of worker threads, each with its own deque of jobs. A worker
+** takes jobs from the back of its own deque and, when that is empty, steals
+** from the front of the others. Threads outside the system submit to a
+** shared deque and run jobs themselves while they wait on a counter, so the
+** calling thread is always one of the threads doing the work.
+** Every parallel part of the step (forces, integration, collision, response)
+** goes through the one system returned by getJobSystem().
+*/
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+
+	/*
+	** GET AND SET METHODS
+	*/
+
+	// threads that run jobs, the workers plus the calling thread (1 = serial)
+	unsigned int getThreadCount() const { return (unsigned int)m_workers.size() + 1; }
+	// restart with count threads, 0 picks the number of hardware threads.
+	// Must not be called while jobs are running
+	void setThreadCount(unsigned int count);
+
+	/*
+	** JOBS
+	*/
+
+	// queue a job, counter (if any) is decremented when it has run
+	void submit(const std::function<void()> &job, JobCounter *counter = nullptr);
+	// queue a job once dependency reaches zero
+	void submitAfter(JobCounter &dependency, const std::function<void()> &job, JobCounter *counter = nullptr);
+	// run jobs on this thread until counter reaches zero
+	void wait(JobCounter &counter);
+
+	// run body over [begin, end) in chunks of grain indices, the last one
+	// shorter. body(chunkBegin, chunkEnd) is called once per chunk, on one
+	// thread too, so the k-th chunk always starts at begin + k * grain.
+	// Returns when all are done
+	void parallelFor(unsigned int begin, unsigned int end, unsigned int grain, const std::function<void(unsigned int, unsigned int)> &body);
+
+private:
+	struct Task
+	{
+		std::function<void()> job;
+		JobCounter *counter;
+	};
+
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void start(unsigned int workers);
+	void stop();
+	void workerLoop(unsigned int queue);
+
+	// deque of the calling thread, 0 for threads outside the system
+	unsigned int getQueueIndex() const;
+	void push(unsigned int queue, const Task &task);
+	// pop from our own deque, or steal from another
+	bool findTask(unsigned int queue, Task &task);
+	void runTask(Task &task);
+
+	std::vector<std::thread> m_workers;
+	std::vector<std::unique_ptr<TaskQueue>> m_queues;	// 0 is shared by outside threads, worker i uses i + 1
+
+	// sleeping when there is nothing to steal
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake;
+	std::atomic<unsigned int> m_queued;		// tasks sitting in a deque
+	std::atomic<unsigned int> m_sleeping;	// workers waiting on m_wake
+	bool m_quit;
+};
+
+// the job system shared by the whole simulation
+JobSystem &getJobSystem();
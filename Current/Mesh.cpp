@@ -1,5 +1,9 @@
 #include "Mesh.h"
-#include <errno.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <glm/gtc/constants.hpp>
 
 /*
 **	MESH 
@@ -31,8 +35,70 @@ Mesh::Mesh(const std::string& fileName)
 	initTransform();
 }
 
+// unit sphere of latitude rings and longitude segments, two triangles per
+// patch and one at the poles, with a position and normal per corner as
+// the renderer draws them. Every corner is computed from the same grid
+// point so the copies are equal and merge into one vertex
+static IndexedModel getSphereModel()
+{
+	const unsigned int rings = 24;
+	const unsigned int segments = 48;
+	const float pi = glm::pi<float>();
+
+	std::vector<glm::vec3> grid((rings + 1) * segments);
+	for (unsigned int r = 0; r <= rings; r++)
+	{
+		for (unsigned int s = 0; s < segments; s++)
+		{
+			const float polar = pi * r / rings;
+			const float azimuth = 2.0f * pi * s / segments;
+			glm::vec3 point(std::sin(polar) * std::cos(azimuth), std::cos(polar), std::sin(polar) * std::sin(azimuth));
+			// the poles are a single point
+			if (r == 0 || r == rings)
+				point = glm::vec3(0.0f, r == 0 ? 1.0f : -1.0f, 0.0f);
+			grid[r * segments + s] = point;
+		}
+	}
+
+	IndexedModel model;
+	auto corner = [&](unsigned int r, unsigned int s)
+	{
+		const glm::vec3 &point = grid[r * segments + s % segments];
+		model.indices.push_back((unsigned int)model.positions.size());
+		model.positions.push_back(point);
+		model.texCoords.push_back(glm::vec2((float)s / segments, (float)r / rings));
+		model.normals.push_back(point);
+	};
+	for (unsigned int r = 0; r < rings; r++)
+	{
+		for (unsigned int s = 0; s < segments; s++)
+		{
+			if (r > 0)
+			{
+				corner(r, s);
+				corner(r, s + 1);
+				corner(r + 1, s);
+			}
+			if (r + 1 < rings)
+			{
+				corner(r, s + 1);
+				corner(r + 1, s + 1);
+				corner(r + 1, s);
+			}
+		}
+	}
+	return model;
+}
+
 Mesh::Mesh(MeshType type)
 {
+	if (type == SPHERE)
+	{
+		InitMesh(getSphereModel());
+		initTransform();
+		return;
+	}
+
 	Vertex vertices[36];
 	glm::vec3 normals[36];
 
@@ -155,33 +221,20 @@ Mesh::Mesh(MeshType type)
 		m_numIndices = 36;
 
 		break;
+
+	case SPHERE:
+		// built from its model above
+		break;
 	}
 	
-	// generate vertex vector with no duplicates
-	//get all the vertices
-	m_vertices = std::vector<Vertex>(std::begin(vertices), std::end(vertices));
-	//set a bool
-	bool duplicateFound = false;
-	//for all vertices
-	for (int i = 0; i < m_vertices.size(); i++)
+	// generate vertex vector with no duplicates, only the vertices of this type
+	glm::vec3 coords[36];
+	for (unsigned int i = 0; i < m_numIndices; i++)
 	{
-		//counter for the next one
-		for (int j = i + 1; j < m_vertices.size(); j++)
-		{
-			//if the vertices are in the same place
-			if (m_vertices.at(i).getCoord() == m_vertices.at(i + 1).getCoord())
-			{
-				//there is a duplicate
-				duplicateFound = true;
-			}
-
-			//remove duplicates!
-			if (duplicateFound)
-			{
-				m_vertices.erase(m_vertices.begin() + i);
-			}
-		}
+		coords[i] = vertices[i].getCoord();
 	}
+	setUniqueVertices(coords, m_numIndices);
+	setTriangles(coords, normals, nullptr, m_numIndices);
 
 	//create mesh
 	initMesh(vertices, normals);
@@ -195,6 +248,64 @@ Mesh::~Mesh()
 {
 }
 
+// order of the unique vertices, by x then y then z
+static bool lessCoord(const glm::vec3 &a, const glm::vec3 &b)
+{
+	if (a.x != b.x)
+		return a.x < b.x;
+	if (a.y != b.y)
+		return a.y < b.y;
+	return a.z < b.z;
+}
+
+// keep one vertex per position, sorting brings the copies each triangle
+// made together so they can be dropped in one pass
+void Mesh::setUniqueVertices(const glm::vec3 *coords, unsigned int count)
+{
+	std::vector<glm::vec3> unique(coords, coords + count);
+	std::sort(unique.begin(), unique.end(), lessCoord);
+	unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+	m_vertices.clear();
+	m_vertices.reserve(unique.size());
+	for (const glm::vec3 &coord : unique)
+	{
+		m_vertices.push_back(Vertex(coord));
+	}
+}
+
+// each corner is found among the sorted unique vertices. The corners are not
+// always listed in the same turn (the cube's are not), so a triangle is
+// flipped when its winding disagrees with its corners' normals, and one
+// with no area is dropped
+void Mesh::setTriangles(const glm::vec3 *coords, const glm::vec3 *normals, const unsigned int *indices, unsigned int count)
+{
+	m_triangles.clear();
+	m_triangles.reserve(count / 3);
+	for (unsigned int t = 0; t + 3 <= count; t += 3)
+	{
+		unsigned int corner[3];
+		glm::uvec3 triangle;
+		for (int k = 0; k < 3; k++)
+		{
+			corner[k] = indices ? indices[t + k] : t + k;
+			glm::vec3 coord = coords[corner[k]];
+			triangle[k] = (unsigned int)(std::lower_bound(m_vertices.begin(), m_vertices.end(), coord, [](const Vertex &v, const glm::vec3 &c)
+			{
+				return lessCoord(v.getCoord(), c);
+			}) - m_vertices.begin());
+		}
+
+		glm::vec3 a = m_vertices[triangle.x].getCoord();
+		glm::vec3 n = glm::cross(m_vertices[triangle.y].getCoord() - a, m_vertices[triangle.z].getCoord() - a);
+		if (glm::dot(n, n) == 0.0f)
+			continue;
+		if (glm::dot(n, normals[corner[0]] + normals[corner[1]] + normals[corner[2]]) < 0.0f)
+			std::swap(triangle.y, triangle.z);
+		m_triangles.push_back(triangle);
+	}
+}
+
 
 /* 
 ** INIT METHODS 
@@ -210,6 +321,14 @@ void Mesh::initTransform() {
 // create mesh from vertices
 void Mesh::initMesh(Vertex* vertices, glm::vec3* normals) {
 
+#ifdef HEADLESS
+	// no GL context, nothing to upload
+	(void)vertices;
+	(void)normals;
+	m_vertexArrayObject = 0;
+	m_vertexBuffer = 0;
+	m_normalBuffer = 0;
+#else
 	glGenVertexArrays(1, &m_vertexArrayObject);
 	glBindVertexArray(m_vertexArrayObject);
 
@@ -234,6 +353,7 @@ void Mesh::initMesh(Vertex* vertices, glm::vec3* normals) {
 	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
 	glBindVertexArray(0);
+#endif // HEADLESS
 
 }
 
@@ -242,7 +362,19 @@ void Mesh::initMesh(Vertex* vertices, glm::vec3* normals) {
 void Mesh::InitMesh(const IndexedModel& model)
 {
 	m_numIndices = model.indices.size();
+	if (!model.positions.empty())
+	{
+		setUniqueVertices(&model.positions[0], (unsigned int)model.positions.size());
+		if (model.normals.size() == model.positions.size())
+			setTriangles(&model.positions[0], &model.normals[0], model.indices.data(), m_numIndices);
+	}
 
+#ifdef HEADLESS
+	// no GL context, nothing to upload
+	m_vertexArrayObject = 0;
+	m_vertexBuffer = 0;
+	m_normalBuffer = 0;
+#else
 	glGenVertexArrays(1, &m_vertexArrayObject);
 	glBindVertexArray(m_vertexArrayObject);
 
@@ -267,6 +399,7 @@ void Mesh::InitMesh(const IndexedModel& model)
 	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
 	glBindVertexArray(0);
+#endif // HEADLESS
 }
 
 // load .obj file
@@ -280,12 +413,9 @@ void Mesh::loadOBJ(const char * path,
 	std::vector< glm::vec2 > temp_uvs;
 	std::vector< glm::vec3 > temp_normals;
 
-	FILE * stream;
-	errno_t err;
-
-	err = fopen_s(&stream, path, "r");
+	FILE * stream = fopen(path, "r");
 
-	if (err != 0)
+	if (stream == NULL)
 	{
 		printf("The file was not opened\n");
 	}
@@ -301,23 +431,23 @@ void Mesh::loadOBJ(const char * path,
 				   // else : parse lineHeader
 			if (strcmp(lineHeader, "v") == 0) {
 				glm::vec3 vertex;
-				fscanf_s(stream, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
+				fscanf(stream, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
 				temp_vertices.push_back(vertex);
 			}
 			else if (strcmp(lineHeader, "vt") == 0) {
 				glm::vec2 uv;
-				fscanf_s(stream, "%f %f\n", &uv.x, &uv.y);
+				fscanf(stream, "%f %f\n", &uv.x, &uv.y);
 				temp_uvs.push_back(uv);
 			}
 			else if (strcmp(lineHeader, "vn") == 0) {
 				glm::vec3 normal;
-				fscanf_s(stream, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
+				fscanf(stream, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
 				temp_normals.push_back(normal);
 			}
 			else if (strcmp(lineHeader, "f") == 0) {
 				std::string vertex1, vertex2, vertex3;
 				unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-				int matches = fscanf_s(stream, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
+				int matches = fscanf(stream, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &vertexIndex[0], &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
 				if (matches != 9) {
 					std::cerr << "file can't be read by parser" << std::endl;
 				}
@@ -1,11 +1,13 @@
 #pragma once
+#ifndef HEADLESS
 #include <GL/glew.h>
+#endif
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <string>
 #include <vector>
-#include "OBJloader.h"
+#include "OBJLoader.h"
 #include "Shader.h"
 
 /* 
@@ -48,7 +50,8 @@ public:
 	{
 		TRIANGLE,
 		QUAD,
-		CUBE
+		CUBE,
+		SPHERE	// unit radius, its vertices on the sphere
 	};
 	/*
 	** CONSTRUCTORS
@@ -73,7 +76,8 @@ public:
 	glm::mat4 getTranslate() const{ return m_translate; }
 	glm::mat4 getRotate() const{ return m_rotate; }
 	glm::mat4 getScale() const{ return m_scale; }
-	std::vector < Vertex > getVertices() { return m_vertices; }
+	const std::vector<Vertex> &getVertices() const { return m_vertices; } // unique positions
+	const std::vector<glm::uvec3> &getTriangles() const { return m_triangles; } // indices into getVertices(), wound to face along the normals
 	
 
 	Shader getShader() const { return m_shader; }
@@ -112,6 +116,11 @@ public:
 	void initMesh(Vertex* vertices, glm::vec3* normals);
 	// create mesh from model (typically loaded from a file)
 	void InitMesh(const IndexedModel& model);
+	// fill m_vertices with the distinct positions of coords
+	void setUniqueVertices(const glm::vec3 *coords, unsigned int count);
+	// fill m_triangles from count corners of coords, listed by indices or in
+	// order if indices is null, after setUniqueVertices()
+	void setTriangles(const glm::vec3 *coords, const glm::vec3 *normals, const unsigned int *indices, unsigned int count);
 
 
 	// load .obj file
@@ -144,6 +153,7 @@ private:
 	glm::mat4 m_rotate;
 	glm::mat4 m_scale;
 	std::vector<Vertex> m_vertices; 
+	std::vector<glm::uvec3> m_triangles;
 
 	Shader m_shader;
 };
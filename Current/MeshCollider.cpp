@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cmath>
+#include "JobSystem.h"
+#include "MeshCollider.h"
+
+// particles or collider vertices looked up per parallel chunk
+static const unsigned int QUERY_GRAIN = 512;
+// refits of the cloth tree before it is built again, the cloth deforms and
+// the refit boxes grow looser over time
+static const unsigned int CLOTH_REFITS = 32;
+
+MeshCollider::MeshCollider()
+{
+	m_thickness = 0.05f;
+	m_friction = 0.5f;
+	m_clothRefits = 0;
+}
+
+MeshCollider::~MeshCollider()
+{
+}
+
+void MeshCollider::addBody(RigidBody *body)
+{
+	addCollider(body, body->getMesh());
+}
+
+void MeshCollider::addMesh(const Mesh &mesh)
+{
+	addCollider(nullptr, mesh);
+}
+
+void MeshCollider::addCollider(RigidBody *body, const Mesh &mesh)
+{
+	m_colliders.push_back(Collider());
+	Collider &collider = m_colliders.back();
+	collider.body = body;
+	collider.model = mesh.getModel();
+	for (const Vertex &vertex : mesh.getVertices())
+	{
+		collider.local.push_back(vertex.getCoord());
+	}
+	collider.triangles = mesh.getTriangles();
+	collider.tree.build(collider.triangles, collider.local.data());
+
+	collider.world.resize(collider.local.size());
+	for (unsigned int v = 0; v < collider.local.size(); v++)
+	{
+		collider.world[v] = glm::vec3(collider.model * glm::vec4(collider.local[v], 1.0f));
+	}
+	collider.previous = collider.world;
+	collider.normals.resize(collider.triangles.size());
+	for (unsigned int t = 0; t < collider.triangles.size(); t++)
+	{
+		const glm::uvec3 &tri = collider.triangles[t];
+		collider.normals[t] = glm::normalize(glm::cross(collider.world[tri.y] - collider.world[tri.x], collider.world[tri.z] - collider.world[tri.x]));
+	}
+	collider.previousNormals = collider.normals;
+
+	// refit by the first detect(), with the thickness set by then
+	collider.moving = true;
+}
+
+void MeshCollider::setCloth(const std::vector<glm::uvec3> &triangles)
+{
+	m_clothTriangles = triangles;
+	m_clothTree = TriangleBvh();
+	m_clothRefits = 0;
+}
+
+// the collider where its body is now. The tree is refit if it moved this
+// step, around both ends of the step, or if it moved the step before, to
+// shrink the boxes back
+void MeshCollider::update(Collider &collider)
+{
+	const glm::mat4 model = collider.body ? collider.body->getMesh().getModel() : collider.model;
+	const bool moved = model != collider.model;
+	if (!moved && !collider.moving)
+		return;
+
+	collider.previous = collider.world;
+	collider.previousNormals = collider.normals;
+	if (moved)
+	{
+		collider.model = model;
+		for (unsigned int v = 0; v < collider.local.size(); v++)
+		{
+			collider.world[v] = glm::vec3(model * glm::vec4(collider.local[v], 1.0f));
+		}
+		for (unsigned int t = 0; t < collider.triangles.size(); t++)
+		{
+			const glm::uvec3 &tri = collider.triangles[t];
+			collider.normals[t] = glm::normalize(glm::cross(collider.world[tri.y] - collider.world[tri.x], collider.world[tri.z] - collider.world[tri.x]));
+		}
+	}
+	collider.tree.refit(collider.triangles, collider.world.data(), collider.previous.data(), m_thickness);
+	collider.moving = moved;
+}
+
+/*
+** DETECTION
+*/
+void MeshCollider::detect(const ParticleSystem &ps, const std::vector<glm::vec3> &starts, float dt)
+{
+	m_contacts.clear();
+	for (Collider &collider : m_colliders)
+	{
+		update(collider);
+	}
+	if (ps.size() == 0)
+		return;
+
+	// box around the cloth over the step
+	const glm::vec3 *pos = ps.getPositions().data();
+	const glm::vec3 *start = starts.data();
+	Aabb cloth(glm::min(start[0], pos[0]), glm::max(start[0], pos[0]));
+	for (unsigned int i = 1; i < ps.size(); i++)
+	{
+		cloth.lower = glm::min(cloth.lower, glm::min(start[i], pos[i]));
+		cloth.upper = glm::max(cloth.upper, glm::max(start[i], pos[i]));
+	}
+
+	JobSystem &jobs = getJobSystem();
+	const unsigned int particles = ps.size();
+	for (const Collider &collider : m_colliders)
+	{
+		const Aabb &bounds = collider.tree.getBounds();
+		if (collider.triangles.empty() || !bounds.overlaps(cloth))
+			continue;
+
+		// particles against the collider triangles around their path, most
+		// of the cloth is away from the collider and stops at its bounds
+		const unsigned int chunks = (particles + QUERY_GRAIN - 1) / QUERY_GRAIN;
+		if (m_chunkContacts.size() < chunks)
+			m_chunkContacts.resize(chunks);
+		jobs.parallelFor(0, particles, QUERY_GRAIN, [&](unsigned int begin, unsigned int end)
+		{
+			std::vector<MeshContact> &found = m_chunkContacts[begin / QUERY_GRAIN];
+			found.clear();
+			for (unsigned int i = begin; i < end; i++)
+			{
+				const Aabb box(glm::min(start[i], pos[i]), glm::max(start[i], pos[i]));
+				if (!bounds.overlaps(box))
+					continue;
+				collider.tree.query(box, [&](unsigned int t)
+				{
+					MeshContact contact;
+					if (testParticle(collider, pos, start, i, t, dt, contact))
+						found.push_back(contact);
+				});
+			}
+		});
+		merge(particles);
+	}
+
+	if (m_clothTriangles.empty())
+		return;
+
+	// the cloth tree is only kept up to date while some collider is near
+	bool near = false;
+	for (const Collider &collider : m_colliders)
+	{
+		near |= !collider.triangles.empty() && collider.tree.getBounds().overlaps(cloth);
+	}
+	if (!near)
+		return;
+	if (m_clothTree.getTriangleCount() == 0 || m_clothRefits >= CLOTH_REFITS)
+	{
+		m_clothTree.build(m_clothTriangles, pos);
+		m_clothRefits = 0;
+	}
+	m_clothTree.refit(m_clothTriangles, pos, start, m_thickness);
+	m_clothRefits++;
+
+	for (const Collider &collider : m_colliders)
+	{
+		if (collider.triangles.empty() || !collider.tree.getBounds().overlaps(cloth))
+			continue;
+
+		// collider vertices against the cloth triangles around their path
+		const unsigned int vertices = (unsigned int)collider.world.size();
+		const unsigned int chunks = (vertices + QUERY_GRAIN - 1) / QUERY_GRAIN;
+		if (m_chunkContacts.size() < chunks)
+			m_chunkContacts.resize(chunks);
+		jobs.parallelFor(0, vertices, QUERY_GRAIN, [&](unsigned int begin, unsigned int end)
+		{
+			std::vector<MeshContact> &found = m_chunkContacts[begin / QUERY_GRAIN];
+			found.clear();
+			for (unsigned int v = begin; v < end; v++)
+			{
+				const glm::vec3 &p = collider.world[v];
+				const glm::vec3 &p0 = collider.previous[v];
+				m_clothTree.query(Aabb(glm::min(p0, p), glm::max(p0, p)), [&](unsigned int t)
+				{
+					MeshContact contact;
+					if (testVertex(collider, pos, start, v, t, dt, contact))
+						found.push_back(contact);
+				});
+			}
+		});
+		merge(vertices);
+	}
+}
+
+// the contacts of the chunks over count queries, in chunk order
+void MeshCollider::merge(unsigned int count)
+{
+	const unsigned int chunks = (count + QUERY_GRAIN - 1) / QUERY_GRAIN;
+	for (unsigned int c = 0; c < chunks; c++)
+	{
+		m_contacts.insert(m_contacts.end(), m_chunkContacts[c].begin(), m_chunkContacts[c].end());
+	}
+}
+
+// barycentric coordinates of p projected onto the plane of abc, true if
+// they are all in [0, 1]
+static bool barycentric(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, glm::vec3 &uvw)
+{
+	const glm::vec3 ab = b - a;
+	const glm::vec3 ac = c - a;
+	const glm::vec3 ap = p - a;
+	const float d00 = glm::dot(ab, ab);
+	const float d01 = glm::dot(ab, ac);
+	const float d11 = glm::dot(ac, ac);
+	const float d20 = glm::dot(ap, ab);
+	const float d21 = glm::dot(ap, ac);
+	const float denom = d00 * d11 - d01 * d01;
+	if (denom <= 0.0f)
+		return false;
+	uvw.y = (d11 * d20 - d01 * d21) / denom;
+	uvw.z = (d00 * d21 - d01 * d20) / denom;
+	uvw.x = 1.0f - uvw.y - uvw.z;
+	return uvw.x >= 0.0f && uvw.y >= 0.0f && uvw.z >= 0.0f;
+}
+
+// a particle that went from outside the collider triangle to behind it
+// during the step, where the two met, or one that ends the step outside it
+// but closer than the thickness. One that is behind it and did not cross it
+// is left alone, it is near another face of the mesh, such as one around
+// a corner, and pushing it out of this one would throw it sideways
+bool MeshCollider::testParticle(const Collider &collider, const glm::vec3 *pos, const glm::vec3 *start, unsigned int i, unsigned int t, float dt, MeshContact &contact) const
+{
+	const glm::uvec3 &tri = collider.triangles[t];
+	const glm::vec3 *world = collider.world.data();
+	const glm::vec3 *previous = collider.previous.data();
+	const glm::vec3 &n = collider.normals[t];
+	const float distance = glm::dot(n, pos[i] - world[tri.x]);
+	if (distance >= m_thickness)
+		return false;
+
+	const float distance0 = glm::dot(collider.previousNormals[t], start[i] - previous[tri.x]);
+
+	glm::vec3 uvw;
+	if (distance0 >= 0.0f && distance < 0.0f)
+	{
+		const float s = distance0 / (distance0 - distance);
+		auto at = [=](const glm::vec3 &p0, const glm::vec3 &p1) { return p0 + s * (p1 - p0); };
+		if (!barycentric(at(start[i], pos[i]), at(previous[tri.x], world[tri.x]), at(previous[tri.y], world[tri.y]), at(previous[tri.z], world[tri.z]), uvw))
+			return false;
+	}
+	else if (distance < 0.0f || !barycentric(pos[i], world[tri.x], world[tri.y], world[tri.z], uvw))
+	{
+		return false;
+	}
+
+	contact.particles[0] = i;
+	contact.particles[1] = i;
+	contact.particles[2] = i;
+	contact.weights[0] = 1.0f;
+	contact.weights[1] = 0.0f;
+	contact.weights[2] = 0.0f;
+	contact.normal = n;
+	contact.plane = glm::dot(n, world[tri.x]) + m_thickness;
+	contact.velocity = (uvw.x * (world[tri.x] - previous[tri.x]) + uvw.y * (world[tri.y] - previous[tri.y]) + uvw.z * (world[tri.z] - previous[tri.z])) / dt;
+	return true;
+}
+
+// a collider vertex that went through the cloth triangle during the step,
+// or ends it closer than the thickness to it. The triangle is pushed to the
+// side of the vertex it was not on at the start
+bool MeshCollider::testVertex(const Collider &collider, const glm::vec3 *pos, const glm::vec3 *start, unsigned int v, unsigned int t, float dt, MeshContact &contact) const
+{
+	const glm::uvec3 &tri = m_clothTriangles[t];
+	const glm::vec3 &p = collider.world[v];
+	const glm::vec3 &p0 = collider.previous[v];
+	glm::vec3 n = glm::cross(pos[tri.y] - pos[tri.x], pos[tri.z] - pos[tri.x]);
+	const float length = glm::length(n);
+	if (length <= 0.0f)
+		return false;
+	n /= length;
+	const float distance = glm::dot(n, p - pos[tri.x]);
+
+	// distance at the start of the step, against the normal at the start
+	// turned to agree with n
+	const glm::vec3 n0 = glm::cross(start[tri.y] - start[tri.x], start[tri.z] - start[tri.x]);
+	const float length0 = glm::length(n0);
+	const float distance0 = length0 > 0.0f ? glm::dot(n0, p0 - start[tri.x]) / length0 * (glm::dot(n0, n) >= 0.0f ? 1.0f : -1.0f) : distance;
+
+	glm::vec3 uvw;
+	if (distance0 * distance < 0.0f)
+	{
+		const float s = distance0 / (distance0 - distance);
+		auto at = [=](const glm::vec3 &q0, const glm::vec3 &q1) { return q0 + s * (q1 - q0); };
+		if (!barycentric(at(p0, p), at(start[tri.x], pos[tri.x]), at(start[tri.y], pos[tri.y]), at(start[tri.z], pos[tri.z]), uvw))
+			return false;
+	}
+	else if (std::fabs(distance) >= m_thickness || !barycentric(p, pos[tri.x], pos[tri.y], pos[tri.z], uvw))
+	{
+		return false;
+	}
+
+	const float side = distance0 >= 0.0f ? 1.0f : -1.0f;
+	contact.particles[0] = tri.x;
+	contact.particles[1] = tri.y;
+	contact.particles[2] = tri.z;
+	contact.weights[0] = uvw.x;
+	contact.weights[1] = uvw.y;
+	contact.weights[2] = uvw.z;
+	contact.normal = -side * n;
+	contact.plane = glm::dot(contact.normal, p) + m_thickness;
+	contact.velocity = (p - p0) / dt;
+	return true;
+}
+
+/*
+** RESPONSE
+*/
+void MeshCollider::respond(ParticleSystem &ps)
+{
+	std::vector<glm::vec3> &pos = ps.getPositions();
+	std::vector<glm::vec3> &vel = ps.getVelocities();
+	const std::vector<float> &invMass = ps.getInvMasses();
+
+	for (const MeshContact &contact : m_contacts)
+	{
+		float w = 0.0f;
+		glm::vec3 x = glm::vec3(0.0f);
+		glm::vec3 v = glm::vec3(0.0f);
+		for (int k = 0; k < 3; k++)
+		{
+			const unsigned int i = contact.particles[k];
+			w += contact.weights[k] * contact.weights[k] * invMass[i];
+			x += contact.weights[k] * pos[i];
+			v += contact.weights[k] * vel[i];
+		}
+		if (w <= 0.0f)
+			continue;
+
+		const float gap = glm::dot(contact.normal, x) - contact.plane;
+		if (gap < 0.0f)
+		{
+			const glm::vec3 correction = -gap / w * contact.normal;
+			for (int k = 0; k < 3; k++)
+			{
+				pos[contact.particles[k]] += contact.weights[k] * invMass[contact.particles[k]] * correction;
+			}
+		}
+
+		// the approach is stopped and the sliding slowed by at most the
+		// friction times that, relative to the surface
+		const glm::vec3 relative = v - contact.velocity;
+		const float vn = glm::dot(contact.normal, relative);
+		if (vn < 0.0f)
+		{
+			const glm::vec3 tangent = relative - vn * contact.normal;
+			const float slide = glm::length(tangent);
+			glm::vec3 impulse = -vn / w * contact.normal;
+			if (slide > 0.0f)
+				impulse -= std::min(slide / w, -m_friction * vn / w) / slide * tangent;
+			for (int k = 0; k < 3; k++)
+			{
+				vel[contact.particles[k]] += contact.weights[k] * invMass[contact.particles[k]] * impulse;
+			}
+		}
+	}
+}
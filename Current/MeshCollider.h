@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Aabb.h"
+#include "Mesh.h"
+#include "ParticleSystem.h"
+#include "RigidBody.h"
+#include "TriangleBvh.h"
+
+// a particle too close to a collider triangle, or a collider vertex too
+// close to a cloth triangle. The weighted sum of the particles' positions,
+// along the normal, may not be less than plane
+struct MeshContact
+{
+	unsigned int particles[3];	// the particle three times, or the cloth triangle's corners
+	float weights[3];			// 1 then 0 and 0, or the barycentric coordinates of the point on the cloth
+	glm::vec3 normal;			// unit, the way the collider pushes the cloth
+	float plane;				// the surface along normal, plus the thickness
+	glm::vec3 velocity;			// of the collider's surface at the contact
+};
+
+/*
+** MESH COLLIDER CLASS
+** Collision of particles, and optionally of a cloth's triangles, against
+** the triangle meshes of moving rigid bodies and of static meshes such as
+** those loaded from OBJ files. Each collider keeps its mesh's vertices and
+** outward triangles (Mesh::getTriangles()) in model space and a
+** TriangleBvh over them, built once. Every step the world positions are
+** taken through the current model matrix, and if it changed the tree is
+** refit around the triangles' path over the step, so a static mesh costs
+** nothing to keep up to date and a moving one a pass over its nodes.
+** A particle may not come closer than the thickness to the outside of a
+** collider triangle nor go through it during the step, and a cloth
+** triangle may not come that close to a collider vertex, which is what
+** holds the cloth up on the corners of a box. Edges of the collider against
+** edges of the cloth are not tested. Contacts push the cloth out and
+** remove its velocity into the surface, relative to the surface's own
+** velocity, with Coulomb friction, and the bodies are not pushed back: the
+** coupling is one way, the bodies move as their own simulation or the
+** scene makes them.
+** Contacts are found in parallel, in an order that does not depend on the
+** number of threads, and resolved one after another like ClothCollider's.
+*/
+class MeshCollider
+{
+public:
+	MeshCollider();
+	~MeshCollider();
+
+	/*
+	** GET AND SET METHODS
+	*/
+	float getThickness() const { return m_thickness; }
+	float getFriction() const { return m_friction; }
+	unsigned int getColliderCount() const { return (unsigned int)m_colliders.size(); }
+	// found by the last detect(), particle contacts first then vertex contacts
+	const std::vector<MeshContact> &getContacts() const { return m_contacts; }
+
+	void setThickness(float thickness) { m_thickness = thickness; }
+	void setFriction(float friction) { m_friction = friction; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// the body's mesh is followed every step, the body must outlive the collider
+	void addBody(RigidBody *body);
+	// a mesh that does not move from where it is now
+	void addMesh(const Mesh &mesh);
+	// the cloth's triangles as particle indices, for the collider vertices
+	// to be tested against. Without them only particles are tested
+	void setCloth(const std::vector<glm::uvec3> &triangles);
+
+	// contacts at the end of a step of length dt that started with the
+	// particles at start, and the colliders' meshes where they were then
+	void detect(const ParticleSystem &ps, const std::vector<glm::vec3> &start, float dt);
+	// push the contacts found by detect() out and stop them approaching. It
+	// may also be called between detect()s, after each substep, as the
+	// contacts are planes and hold while the cloth and colliders move little
+	void respond(ParticleSystem &ps);
+
+private:
+	struct Collider
+	{
+		RigidBody *body;					// followed every step, null for a static mesh
+		glm::mat4 model;					// the world positions are the local ones through this
+		std::vector<glm::vec3> local;
+		std::vector<glm::vec3> world;		// at the end of the step
+		std::vector<glm::vec3> previous;	// at the start of the step
+		std::vector<glm::uvec3> triangles;	// outward, by the right hand rule
+		std::vector<glm::vec3> normals;		// per triangle, unit, at the end of the step
+		std::vector<glm::vec3> previousNormals;	// at the start of the step
+		TriangleBvh tree;
+		bool moving;						// moved in the last step, its boxes cover the path
+	};
+
+	void addCollider(RigidBody *body, const Mesh &mesh);
+	void update(Collider &collider);
+	bool testParticle(const Collider &collider, const glm::vec3 *pos, const glm::vec3 *start, unsigned int i, unsigned int t, float dt, MeshContact &contact) const;
+	bool testVertex(const Collider &collider, const glm::vec3 *pos, const glm::vec3 *start, unsigned int v, unsigned int t, float dt, MeshContact &contact) const;
+	void merge(unsigned int count);
+
+	float m_thickness;
+	float m_friction;
+	std::vector<Collider> m_colliders;
+
+	std::vector<glm::uvec3> m_clothTriangles;
+	TriangleBvh m_clothTree;
+	unsigned int m_clothRefits;		// since the cloth tree was last built
+
+	std::vector<MeshContact> m_contacts;
+	std::vector<std::vector<MeshContact>> m_chunkContacts;	// contacts found by each chunk
+};
@@ -0,0 +1,175 @@
+#include "NormalConeKernel.h"
+#include "Simd.h"
+
+// partial sums kept, two vectors of the SSE4.1 path
+static const unsigned int LANES = 8;
+
+// partial sums of the normals, lane k holds those of the triangles k, k + 8,
+// k + 16 ... places into the run
+struct NormalSums
+{
+	float x[LANES];
+	float y[LANES];
+	float z[LANES];
+};
+
+/*
+** DISPATCH
+*/
+bool testNormalCone(const glm::uvec3 *triangles, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 &axis, float cosine, glm::vec3 &sum)
+{
+	switch (getSimdLevel())
+	{
+	case SIMD_AVX2:
+	case SIMD_SSE41:
+		return testNormalConeSSE41(triangles, begin, end, pos, axis, cosine, sum);
+	default:
+		return testNormalConeScalar(triangles, begin, end, pos, axis, cosine, sum);
+	}
+}
+
+/*
+** SCALAR
+*/
+
+// the lanes of each component added pairwise
+static float addLanes(const float *lane)
+{
+	return ((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]));
+}
+
+// triangles [first, end) of a run that started at begin, added to the lanes
+// of sums. A normal n is inside the cone if n.axis > 0 and
+// (n.axis)^2 > limit * n.n, with limit the squared cosine times axis.axis
+static bool testRange(const glm::uvec3 *triangles, unsigned int first, unsigned int end, unsigned int begin,
+	const glm::vec3 *pos, const glm::vec3 &axis, float limit, NormalSums &sums)
+{
+	bool inside = true;
+	for (unsigned int t = first; t < end; t++)
+	{
+		const glm::vec3 &a = pos[triangles[t].x];
+		const glm::vec3 &b = pos[triangles[t].y];
+		const glm::vec3 &c = pos[triangles[t].z];
+		const float e1x = b.x - a.x;
+		const float e1y = b.y - a.y;
+		const float e1z = b.z - a.z;
+		const float e2x = c.x - a.x;
+		const float e2y = c.y - a.y;
+		const float e2z = c.z - a.z;
+		const float nx = e1y * e2z - e1z * e2y;
+		const float ny = e1z * e2x - e1x * e2z;
+		const float nz = e1x * e2y - e1y * e2x;
+
+		const float d = (nx * axis.x + ny * axis.y) + nz * axis.z;
+		const float n2 = (nx * nx + ny * ny) + nz * nz;
+		inside &= (d > 0.0f) & (d * d > limit * n2);
+
+		const unsigned int k = (t - begin) % LANES;
+		sums.x[k] += nx;
+		sums.y[k] += ny;
+		sums.z[k] += nz;
+	}
+	return inside;
+}
+
+bool testNormalConeScalar(const glm::uvec3 *triangles, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 &axis, float cosine, glm::vec3 &sum)
+{
+	const float limit = cosine * cosine * glm::dot(axis, axis);
+	NormalSums sums = {};
+	const bool inside = testRange(triangles, begin, end, begin, pos, axis, limit, sums);
+	sum = glm::vec3(addLanes(sums.x), addLanes(sums.y), addLanes(sums.z));
+	return inside;
+}
+
+#if SIMD_X86
+
+/*
+** SSE4.1, 4 triangles at a time
+*/
+
+// normals of triangles t to t + 3
+SIMD_TARGET_SSE41
+static inline void normalsSSE41(const glm::uvec3 *tri, const glm::vec3 *pos, __m128 &nx, __m128 &ny, __m128 &nz)
+{
+	// no gather before AVX2, load the lanes one by one
+	const glm::vec3 &a0 = pos[tri[0].x], &a1 = pos[tri[1].x], &a2 = pos[tri[2].x], &a3 = pos[tri[3].x];
+	const glm::vec3 &b0 = pos[tri[0].y], &b1 = pos[tri[1].y], &b2 = pos[tri[2].y], &b3 = pos[tri[3].y];
+	const glm::vec3 &c0 = pos[tri[0].z], &c1 = pos[tri[1].z], &c2 = pos[tri[2].z], &c3 = pos[tri[3].z];
+	const __m128 ax = _mm_set_ps(a3.x, a2.x, a1.x, a0.x);
+	const __m128 ay = _mm_set_ps(a3.y, a2.y, a1.y, a0.y);
+	const __m128 az = _mm_set_ps(a3.z, a2.z, a1.z, a0.z);
+	const __m128 e1x = _mm_sub_ps(_mm_set_ps(b3.x, b2.x, b1.x, b0.x), ax);
+	const __m128 e1y = _mm_sub_ps(_mm_set_ps(b3.y, b2.y, b1.y, b0.y), ay);
+	const __m128 e1z = _mm_sub_ps(_mm_set_ps(b3.z, b2.z, b1.z, b0.z), az);
+	const __m128 e2x = _mm_sub_ps(_mm_set_ps(c3.x, c2.x, c1.x, c0.x), ax);
+	const __m128 e2y = _mm_sub_ps(_mm_set_ps(c3.y, c2.y, c1.y, c0.y), ay);
+	const __m128 e2z = _mm_sub_ps(_mm_set_ps(c3.z, c2.z, c1.z, c0.z), az);
+	nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+	ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+	nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+}
+
+// all ones in the lanes whose normal is inside the cone
+SIMD_TARGET_SSE41
+static inline __m128 insideSSE41(__m128 nx, __m128 ny, __m128 nz, __m128 axisX, __m128 axisY, __m128 axisZ, __m128 limit)
+{
+	const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, axisX), _mm_mul_ps(ny, axisY)), _mm_mul_ps(nz, axisZ));
+	const __m128 n2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+	return _mm_and_ps(_mm_cmpgt_ps(d, _mm_setzero_ps()), _mm_cmpgt_ps(_mm_mul_ps(d, d), _mm_mul_ps(limit, n2)));
+}
+
+SIMD_TARGET_SSE41
+bool testNormalConeSSE41(const glm::uvec3 *triangles, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 &axis, float cosine, glm::vec3 &sum)
+{
+	const float limitScalar = cosine * cosine * glm::dot(axis, axis);
+	const __m128 limit = _mm_set1_ps(limitScalar);
+	const __m128 axisX = _mm_set1_ps(axis.x);
+	const __m128 axisY = _mm_set1_ps(axis.y);
+	const __m128 axisZ = _mm_set1_ps(axis.z);
+
+	// lanes 0 to 3 and 4 to 7 of the partial sums
+	__m128 sumX[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+	__m128 sumY[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+	__m128 sumZ[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+	__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+	unsigned int t = begin;
+	for (; t + 8 <= end; t += 8)
+	{
+		for (int h = 0; h < 2; h++)
+		{
+			__m128 nx, ny, nz;
+			normalsSSE41(triangles + t + 4 * h, pos, nx, ny, nz);
+			inside = _mm_and_ps(inside, insideSSE41(nx, ny, nz, axisX, axisY, axisZ, limit));
+			sumX[h] = _mm_add_ps(sumX[h], nx);
+			sumY[h] = _mm_add_ps(sumY[h], ny);
+			sumZ[h] = _mm_add_ps(sumZ[h], nz);
+		}
+	}
+
+	NormalSums sums;
+	for (int h = 0; h < 2; h++)
+	{
+		_mm_storeu_ps(sums.x + 4 * h, sumX[h]);
+		_mm_storeu_ps(sums.y + 4 * h, sumY[h]);
+		_mm_storeu_ps(sums.z + 4 * h, sumZ[h]);
+	}
+	bool result = _mm_movemask_ps(inside) == 0xF;
+	result &= testRange(triangles, t, end, begin, pos, axis, limitScalar, sums);
+	sum = glm::vec3(addLanes(sums.x), addLanes(sums.y), addLanes(sums.z));
+	return result;
+}
+
+#else
+
+// no x86 vector units, the dispatcher never selects this
+bool testNormalConeSSE41(const glm::uvec3 *triangles, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 &axis, float cosine, glm::vec3 &sum)
+{
+	return testNormalConeScalar(triangles, begin, end, pos, axis, cosine, sum);
+}
+
+#endif // SIMD_X86
@@ -0,0 +1,31 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/*
+** NORMAL CONE KERNEL
+** Batched test of whether the normals of a run of triangles all lie within
+** a cone around an axis, which is how ClothCollider finds the patches of a
+** cloth that are flat. Every normal is the cross product of two edges and
+** is compared against the axis through squared cosines, so there is no
+** square root or division per triangle. The normals are also summed, into
+** eight partial sums taken by the triangle's position in the run and added
+** together in a fixed order at the end. The SSE4.1 path handles 4 triangles
+** per instruction, chosen at runtime through getSimdLevel(), with a scalar
+** loop for the remainder and for CPUs without it. There is no AVX2 path:
+** the corners are scattered through the particles, and gathering 8 lanes of
+** them cost more than the wider arithmetic saved, so AVX2 CPUs run the
+** SSE4.1 one. Both paths perform the same IEEE operations in the same
+** order, so they give the same result.
+*/
+
+// true if every normal of triangles [begin, end) is less than the angle
+// whose cosine is given away from axis, which need not be unit. The sum of
+// the normals, weighed by area, is written to sum
+bool testNormalCone(const glm::uvec3 *triangles, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 &axis, float cosine, glm::vec3 &sum);
+
+// the individual paths, testNormalCone() picks one of these
+bool testNormalConeScalar(const glm::uvec3 *triangles, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 &axis, float cosine, glm::vec3 &sum);
+bool testNormalConeSSE41(const glm::uvec3 *triangles, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 &axis, float cosine, glm::vec3 &sum);
@@ -10,7 +10,7 @@
 // - no shader allocated by default to avoid creating a Shader object for each particle .
 Particle::Particle()
 {
-	setMesh(Mesh::Mesh());
+	setMesh(Mesh());
 	scale(glm::vec3(0.1f, 0.1f, 0.1f));
 	rotate((GLfloat)M_PI_2, glm::vec3(1.0f, 0.0f, 0.0f));
 
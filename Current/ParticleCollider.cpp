@@ -0,0 +1,57 @@
+#include "ParticleCollider.h"
+
+ParticleCollider::ParticleCollider()
+{
+	m_radius = 0.05f;
+	m_cor = 1.0f;
+}
+
+ParticleCollider::~ParticleCollider()
+{
+}
+
+// spheres overlap when their centres are closer than a diameter
+void ParticleCollider::detect(const ParticleSystem &ps)
+{
+	const glm::vec3 *pos = ps.getPositions().data();
+	m_grid.build(pos, ps.size(), 2.0f * m_radius);
+	m_grid.findPairs(pos, 2.0f * m_radius, m_pairs);
+}
+
+void ParticleCollider::respond(ParticleSystem &ps)
+{
+	std::vector<glm::vec3> &pos = ps.getPositions();
+	std::vector<glm::vec3> &vel = ps.getVelocities();
+	const std::vector<float> &invMass = ps.getInvMasses();
+	const float diameter = 2.0f * m_radius;
+
+	for (const ParticlePair &pair : m_pairs)
+	{
+		unsigned int a = pair.a;
+		unsigned int b = pair.b;
+		float w = invMass[a] + invMass[b];
+		if (w <= 0.0f)
+			continue;
+
+		// an earlier pair may already have pushed them apart
+		glm::vec3 d = pos[b] - pos[a];
+		float distance = glm::length(d);
+		if (distance >= diameter || distance <= 0.0f)
+			continue;
+		glm::vec3 n = d / distance;
+
+		// move both out of contact, the lighter one further
+		glm::vec3 correction = (diameter - distance) / w * n;
+		pos[a] -= invMass[a] * correction;
+		pos[b] += invMass[b] * correction;
+
+		// impulse j = -(1 + e) vn / (1/ma + 1/mb) if they are approaching
+		float vn = glm::dot(vel[b] - vel[a], n);
+		if (vn < 0.0f)
+		{
+			float j = -(1.0f + m_cor) * vn / w;
+			vel[a] -= j * invMass[a] * n;
+			vel[b] += j * invMass[b] * n;
+		}
+	}
+}
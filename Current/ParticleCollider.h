@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include "ParticleSystem.h"
+#include "UniformGrid.h"
+
+/*
+** PARTICLE COLLIDER CLASS
+** Collisions between particles treated as spheres of one radius. detect()
+** finds the overlapping pairs through a UniformGrid, respond() pushes each
+** pair apart along the line between the centres, shared by inverse mass,
+** and removes the approaching velocity with an impulse (restitution e).
+** Pairs are resolved in the order the grid found them, one after another.
+*/
+class ParticleCollider
+{
+public:
+	ParticleCollider();
+	~ParticleCollider();
+
+	/*
+	** GET AND SET METHODS
+	*/
+	float getRadius() const { return m_radius; }
+	float getCor() const { return m_cor; }
+	const UniformGrid &getGrid() const { return m_grid; }
+	const std::vector<ParticlePair> &getPairs() const { return m_pairs; }
+
+	void setRadius(float radius) { m_radius = radius; }
+	void setCor(float cor) { m_cor = cor; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// find the overlapping pairs
+	void detect(const ParticleSystem &ps);
+	// separate the pairs found by detect() and exchange their impulses
+	void respond(ParticleSystem &ps);
+
+private:
+	float m_radius;		// radius of every particle
+	float m_cor;		// coefficient of restitution
+	UniformGrid m_grid;
+	std::vector<ParticlePair> m_pairs;	// overlapping this step
+};
@@ -0,0 +1,91 @@
+#include "JobSystem.h"
+#include "ParticleSystem.h"
+
+// particles per parallel chunk of the per particle loops
+static const unsigned int PARTICLE_GRAIN = 8192;
+
+ParticleSystem::ParticleSystem()
+{
+}
+
+ParticleSystem::~ParticleSystem()
+{
+}
+
+/*
+** STORAGE
+*/
+
+// reserve room for n particles in every attribute array
+void ParticleSystem::reserve(unsigned int n)
+{
+	m_pos.reserve(n);
+	m_vel.reserve(n);
+	m_acc.reserve(n);
+	m_force.reserve(n);
+	m_invMass.reserve(n);
+}
+
+// remove all particles
+void ParticleSystem::clear()
+{
+	m_pos.clear();
+	m_vel.clear();
+	m_acc.clear();
+	m_force.clear();
+	m_invMass.clear();
+}
+
+// append a particle and return a handle to it
+ParticleHandle ParticleSystem::addParticle(const glm::vec3 &pos, const glm::vec3 &vel, float mass)
+{
+	m_pos.push_back(pos);
+	m_vel.push_back(vel);
+	m_acc.push_back(glm::vec3(0.0f));
+	m_force.push_back(glm::vec3(0.0f));
+	m_invMass.push_back(mass > 0.0f ? 1.0f / mass : 0.0f);
+
+	return ParticleHandle(this, size() - 1);
+}
+
+/*
+** PHYSICS
+*/
+
+// reset the force accumulators before the forces of a new step are added
+void ParticleSystem::clearForces()
+{
+	glm::vec3 *force = m_force.data();
+	getJobSystem().parallelFor(0, size(), PARTICLE_GRAIN, [force](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			force[i] = glm::vec3(0.0f);
+		}
+	});
+}
+
+// a = F / m for every particle, fixed particles get no acceleration
+void ParticleSystem::computeAccelerations()
+{
+	getJobSystem().parallelFor(0, size(), PARTICLE_GRAIN, [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			m_acc[i] = m_force[i] * m_invMass[i];
+		}
+	});
+}
+
+// semi-implicit (symplectic) Euler over the whole system
+void ParticleSystem::integrate(float dt)
+{
+	getJobSystem().parallelFor(0, size(), PARTICLE_GRAIN, [this, dt](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			m_vel[i] += m_acc[i] * dt;
+			m_pos[i] += m_vel[i] * dt;
+		}
+	});
+}
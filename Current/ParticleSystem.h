@@ -0,0 +1,132 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+class ParticleSystem; // forward declaration, handles point back to their container
+
+/*
+** PARTICLE HANDLE CLASS
+** A light-weight view of a single particle living in a ParticleSystem.
+** It mirrors the Body get and set methods so per-particle code can keep
+** working while the data itself stays in the contiguous arrays.
+*/
+class ParticleHandle
+{
+public:
+	// constructors
+	ParticleHandle() : m_system(nullptr), m_index(0) {}
+	ParticleHandle(ParticleSystem *system, unsigned int index) : m_system(system), m_index(index) {}
+
+	// get methods
+	unsigned int getIndex() const { return m_index; }
+	ParticleSystem *getSystem() const { return m_system; }
+	bool isValid() const { return m_system != nullptr; }
+
+	// dynamic variables
+	glm::vec3 &getPos();
+	glm::vec3 &getVel();
+	glm::vec3 &getAcc();
+	glm::vec3 &getForce();
+
+	// physical properties
+	float getMass() const;
+	float getInvMass() const;
+
+	// set methods
+	void setPos(const glm::vec3 &vect) { getPos() = vect; }
+	void setPos(int i, float p) { getPos()[i] = p; } // set the ith coordinate of the position vector
+	void setVel(const glm::vec3 &vect) { getVel() = vect; }
+	void setVel(int i, float v) { getVel()[i] = v; } // set the ith coordinate of the velocity vector
+	void setAcc(const glm::vec3 &vect) { getAcc() = vect; }
+	void setMass(float mass);
+	void setInvMass(float invMass);
+
+	// other methods
+	void translate(const glm::vec3 &vect) { getPos() += vect; }
+	void addForce(const glm::vec3 &force) { getForce() += force; }
+
+private:
+	ParticleSystem *m_system;	// container the particle lives in
+	unsigned int m_index;		// index of the particle in every attribute array
+};
+
+/*
+** PARTICLE SYSTEM CLASS
+** Stores the state of many particles as one array per attribute (structure
+** of arrays). A step then streams through position, velocity, force and
+** inverse mass separately instead of visiting one large Body at a time.
+** A particle with an inverse mass of 0 is fixed in place.
+*/
+class ParticleSystem
+{
+public:
+	ParticleSystem();
+	~ParticleSystem();
+
+	/*
+	** GET METHODS
+	*/
+	unsigned int size() const { return (unsigned int)m_pos.size(); }
+	ParticleHandle getParticle(unsigned int i) { return ParticleHandle(this, i); }
+
+	// single particle access
+	glm::vec3 &getPos(unsigned int i) { return m_pos[i]; }
+	glm::vec3 &getVel(unsigned int i) { return m_vel[i]; }
+	glm::vec3 &getAcc(unsigned int i) { return m_acc[i]; }
+	glm::vec3 &getForce(unsigned int i) { return m_force[i]; }
+	float getInvMass(unsigned int i) const { return m_invMass[i]; }
+	float getMass(unsigned int i) const { return m_invMass[i] > 0.0f ? 1.0f / m_invMass[i] : 0.0f; }
+	bool isFixed(unsigned int i) const { return m_invMass[i] == 0.0f; }
+
+	// whole attribute arrays
+	std::vector<glm::vec3> &getPositions() { return m_pos; }
+	std::vector<glm::vec3> &getVelocities() { return m_vel; }
+	std::vector<glm::vec3> &getAccelerations() { return m_acc; }
+	std::vector<glm::vec3> &getForces() { return m_force; }
+	std::vector<float> &getInvMasses() { return m_invMass; }
+	const std::vector<glm::vec3> &getPositions() const { return m_pos; }
+	const std::vector<glm::vec3> &getVelocities() const { return m_vel; }
+	const std::vector<glm::vec3> &getAccelerations() const { return m_acc; }
+	const std::vector<glm::vec3> &getForces() const { return m_force; }
+	const std::vector<float> &getInvMasses() const { return m_invMass; }
+
+	/*
+	** SET METHODS
+	*/
+	void setMass(unsigned int i, float mass) { m_invMass[i] = mass > 0.0f ? 1.0f / mass : 0.0f; }
+	void setInvMass(unsigned int i, float invMass) { m_invMass[i] = invMass; }
+	void setFixed(unsigned int i) { m_invMass[i] = 0.0f; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// storage
+	void reserve(unsigned int n);
+	void clear();
+	ParticleHandle addParticle(const glm::vec3 &pos, const glm::vec3 &vel = glm::vec3(0.0f), float mass = 1.0f);
+
+	// physics
+	void clearForces();
+	void computeAccelerations();
+	void integrate(float dt);
+
+private:
+	std::vector<glm::vec3> m_pos;	// positions
+	std::vector<glm::vec3> m_vel;	// velocities
+	std::vector<glm::vec3> m_acc;	// accelerations
+	std::vector<glm::vec3> m_force;	// force accumulators
+	std::vector<float> m_invMass;	// inverse masses (0 = fixed particle)
+};
+
+/*
+** HANDLE METHODS
+*/
+inline glm::vec3 &ParticleHandle::getPos() { return m_system->getPos(m_index); }
+inline glm::vec3 &ParticleHandle::getVel() { return m_system->getVel(m_index); }
+inline glm::vec3 &ParticleHandle::getAcc() { return m_system->getAcc(m_index); }
+inline glm::vec3 &ParticleHandle::getForce() { return m_system->getForce(m_index); }
+inline float ParticleHandle::getMass() const { return m_system->getMass(m_index); }
+inline float ParticleHandle::getInvMass() const { return m_system->getInvMass(m_index); }
+inline void ParticleHandle::setMass(float mass) { m_system->setMass(m_index, mass); }
+inline void ParticleHandle::setInvMass(float invMass) { m_system->setInvMass(m_index, invMass); }
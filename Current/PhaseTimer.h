@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+
+// phases a simulation step is split into for timing
+enum StepPhase
+{
+	PHASE_FORCE,
+	PHASE_INTEGRATION,
+	PHASE_COLLISION,
+	PHASE_RESPONSE,
+	PHASE_COUNT
+};
+
+/*
+** PHASE TIMER CLASS
+** Accumulates wall clock time per step phase. start() is called once at the
+** beginning of a step, then lap(phase) after each phase adds the time since
+** the previous call to that phase.
+*/
+class PhaseTimer
+{
+public:
+	PhaseTimer() { reset(); }
+
+	// clear the accumulated times
+	void reset()
+	{
+		for (int i = 0; i < PHASE_COUNT; i++)
+		{
+			m_seconds[i] = 0.0;
+		}
+	}
+
+	// begin timing a step
+	void start() { m_last = std::chrono::steady_clock::now(); }
+
+	// add the time since the last start() or lap() to a phase
+	void lap(StepPhase phase)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		m_seconds[phase] += std::chrono::duration<double>(now - m_last).count();
+		m_last = now;
+	}
+
+	// get methods
+	double getSeconds(StepPhase phase) const { return m_seconds[phase]; }
+	double getTotalSeconds() const
+	{
+		double total = 0.0;
+		for (int i = 0; i < PHASE_COUNT; i++)
+		{
+			total += m_seconds[i];
+		}
+		return total;
+	}
+
+	static const char *getPhaseName(StepPhase phase)
+	{
+		static const char *names[PHASE_COUNT] = { "force", "integration", "collision", "response" };
+		return names[phase];
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_last;	// time of the last start() or lap()
+	double m_seconds[PHASE_COUNT];					// accumulated time per phase
+};
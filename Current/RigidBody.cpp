@@ -7,6 +7,8 @@ RigidBody::RigidBody()
 	setVel(glm::vec3(0.0f, 0.0f, 0.0f));
 	setAngVel(glm::vec3(0.0f, 0.0f, 0.0f));
 	setAngAccl(glm::vec3(0.0f, 0.0f, 0.0f));
+	setShape(nullptr);
+	setFast(false);
 
 	setMass(1.0f);
 	setCor(1.0f);
@@ -16,15 +18,43 @@ RigidBody::~RigidBody()
 {
 }
 
+// the hull is built here, once, rather than from a copy of the vertices every step
+void RigidBody::setMesh(Mesh m)
+{
+	std::vector<glm::vec3> points;
+	points.reserve(m.getVertices().size());
+	for (const Vertex &v : m.getVertices())
+	{
+		points.push_back(v.getCoord());
+	}
+	m_hull.setPoints(points);
+	Body::setMesh(m);
+	setInvInertia(calcInvInertia());
+}
+
 glm::mat3 RigidBody::calcInvInertia()
 {
 	glm::mat3 matrix = glm::mat3(0.0f);
+	//Size of the mesh, the unit cube is 2 wide, 1 before there is a mesh
+	glm::vec3 size = glm::vec3(1.0f);
+	const CollisionHull &hull = getHull();
+	if (hull.size() > 0)
+	{
+		glm::vec3 lower = hull.getPoint(0);
+		glm::vec3 upper = hull.getPoint(0);
+		for (unsigned int i = 1; i < hull.size(); i++)
+		{
+			lower = glm::min(lower, hull.getPoint(i));
+			upper = glm::max(upper, hull.getPoint(i));
+		}
+		size = upper - lower;
+	}
 	//Get width - X Scale
-	float w = getScale()[0][0];
+	float w = size.x * getScale()[0][0];
 	//Get height - Y Scale
-	float h = getScale()[1][1];
+	float h = size.y * getScale()[1][1];
 	//Get depth - Z Scale
-	float d = getScale()[2][2];
+	float d = size.z * getScale()[2][2];
 	
 	matrix[0][0] = getMass() * (h * h + d * d) / 12.0f;
 	matrix[1][1] = getMass() * (w * w + d * d) / 12.0f;
@@ -1,5 +1,6 @@
 #pragma once
 #include "Body.h"
+#include "ConvexShape.h"
 
 class RigidBody : public Body
 {
@@ -13,9 +14,15 @@ public:
 	void setAngAccl(const glm::vec3 & alpha) { m_angAcc = alpha; }
 	void setInvInertia(const glm::mat3 &invInertia) { m_invInertia = invInertia; }
 	void setMass(const float & m);
+	void setShape(const ConvexShape *shape) { m_shape = shape; } // collision shape in model space (not owned)
+	void setMesh(Mesh m); // also builds the collision hull from the mesh's vertices
+	void setFast(bool fast) { m_fast = fast; } // swept to its first impact each step so it cannot pass through things
 	//Get
 	glm::vec3 getAngVel() { return m_angVel; }
 	glm::vec3 getAngAcc() { return m_angAcc; }
+	const ConvexShape *getShape() const { if (m_shape) return m_shape; return &m_hull; } // the hull if no shape is set
+	const CollisionHull &getHull() const { return m_hull.getHull(); }
+	bool isFast() const { return m_fast; }
 	glm::mat3 getInvInertia() { return Body::getMesh().getRotate() * glm::mat4(m_invInertia) * glm::transpose(Body::getMesh().getRotate()); }
 	//Set Scale
 	void scale(const glm::vec3 & vect);
@@ -25,5 +32,8 @@ private:
 	glm::mat3 m_invInertia; // Inverse inertia
 	glm::vec3 m_angVel;		// Angular velocity
 	glm::vec3 m_angAcc;		// Angular acceleration
+	const ConvexShape *m_shape; // Collision shape
+	HullShape m_hull;		// Unique vertices of the mesh, built once
+	bool m_fast;			// Continuous collision detection
 	glm::mat3 calcInvInertia(); //calculates the tensor for inverse inertia 
 };
\ No newline at end of file
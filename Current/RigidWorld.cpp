@@ -0,0 +1,928 @@
+#include "RigidWorld.h"
+#include <algorithm>
+#include <cstring>
+#include <glm/gtx/matrix_operation.hpp>
+#include "glm/ext.hpp"
+#include "JobSystem.h"
+
+// bodies per parallel chunk, each body is a few hundred flops
+static const unsigned int BODY_GRAIN = 16;
+// pairs per parallel chunk of the narrowphase
+static const unsigned int PAIR_GRAIN = 16;
+// a fast body is stopped this far (metres) short of what it hits, and
+// counts as touching it within the tolerance
+static const float CCD_TARGET = 0.01f;
+static const float CCD_TOLERANCE = 0.0025f;
+// advancement steps per sweep, and impacts per fast body per step. The
+// rest of the step is dropped after the last impact
+static const unsigned int CCD_ITERATIONS = 32;
+static const unsigned int CCD_IMPACTS = 4;
+// a body is still below these speeds (m/s and rad/s), and its island
+// sleeps once every body in it has been still this long (seconds)
+static const float SLEEP_LINEAR = 0.05f;
+static const float SLEEP_ANGULAR = 0.05f;
+static const float SLEEP_TIME = 0.5f;
+// change in the acceleration from its forces (m/s^2) that wakes a body
+static const float WAKE_ACCELERATION = 1.0e-3f;
+
+static inline bool pairLess(const BodyPair &x, const BodyPair &y)
+{
+	return x.a < y.a || (x.a == y.a && x.b < y.b);
+}
+
+// rotation turned by the angular velocity w for a time t
+static inline glm::mat3 advanceRotation(const glm::mat3 &R, const glm::vec3 &w, float t)
+{
+	return glm::orthonormalize(R + t * glm::matrixCross3(w) * R);
+}
+
+// model matrix of the body once it has moved for a time t
+static glm::mat4 advanceModel(RigidBody &rb, float t)
+{
+	glm::mat4 model = glm::mat4(advanceRotation(glm::mat3(rb.getRotate()), rb.getAngVel(), t)) * rb.getScale();
+	model[3] = glm::vec4(rb.getPos() + t * rb.getVel(), 1.0f);
+	return model;
+}
+
+RigidWorld::RigidWorld()
+{
+	m_groundHeight = 0.0f;
+	m_cor = 1.0f;
+	m_time = 0.0;
+	m_reusedPairs = 0;
+	m_impacts = 0;
+	m_sleeping = true;
+	m_awakeBodies = 0;
+	m_broadphase = BROADPHASE_TREE;
+}
+
+RigidWorld::~RigidWorld()
+{
+}
+
+// advance every body by one fixed step. The contacts are solved between
+// the velocity and the position halves of the integration, so a resting
+// body's weight is cancelled before it can move it into the ground
+void RigidWorld::step(float dt)
+{
+	applyForces(dt);
+	integrateVelocities(dt);
+	detectCollisions();
+	respondCollisions(dt);
+	updateIslands(dt);
+	integratePositions(dt);
+}
+
+// accelerations from the forces attached to each body. Sleeping bodies
+// are evaluated too, a change in their forces wakes their island
+void RigidWorld::applyForces(float dt)
+{
+	// bodies added since the last step start awake, each its own island
+	const unsigned int n = (unsigned int)m_bodies.size();
+	for (unsigned int i = (unsigned int)m_asleep.size(); i < n; i++)
+	{
+		m_asleep.push_back(0);
+		m_sleepTimes.push_back(0.0f);
+		m_sleepAccs.push_back(glm::vec3(0.0f));
+		m_wakeRequests.push_back(0);
+		m_islandLabels.push_back(i);
+	}
+
+	getJobSystem().parallelFor(0, n, BODY_GRAIN, [this, dt](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			RigidBody *rb = m_bodies[i];
+			rb->setAcc(rb->applyForces(rb->getPos(), rb->getVel(), (float)m_time, dt));
+			m_wakeRequests[i] = m_asleep[i] && glm::length(rb->getAcc() - m_sleepAccs[i]) > WAKE_ACCELERATION;
+		}
+	});
+
+	for (unsigned int i = 0; i < n; i++)
+	{
+		if (m_wakeRequests[i] && m_asleep[i])
+			wakeIsland(i);
+	}
+}
+
+// velocities of every body from its accelerations
+void RigidWorld::integrateVelocities(float dt)
+{
+	getJobSystem().parallelFor(0, (unsigned int)m_bodies.size(), BODY_GRAIN, [this, dt](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			if (!m_asleep[i])
+				integrateVelocity(*m_bodies[i], dt);
+		}
+	});
+}
+
+// positions of every body from its velocities, this also advances the
+// simulated time. Fast bodies go last, in order, against where the others
+// have got to
+void RigidWorld::integratePositions(float dt)
+{
+	getJobSystem().parallelFor(0, (unsigned int)m_bodies.size(), BODY_GRAIN, [this, dt](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			if (!m_bodies[i]->isFast() && !m_asleep[i])
+				integratePosition(*m_bodies[i], dt);
+		}
+	});
+
+	m_fastBodies.clear();
+	for (unsigned int i = 0; i < m_bodies.size(); i++)
+	{
+		if (m_bodies[i]->isFast() && !m_asleep[i])
+			m_fastBodies.push_back(i);
+	}
+	m_impacts = 0;
+	if (!m_fastBodies.empty())
+	{
+		// boxes where the bodies have got to, the fast ones keep theirs up to date
+		getJobSystem().parallelFor(0, (unsigned int)m_bodies.size(), BODY_GRAIN, [this](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				m_bounds[i] = m_localBounds[i].transformed(m_bodies[i]->getMesh().getModel());
+			}
+		});
+	}
+	for (unsigned int i : m_fastBodies)
+	{
+		advanceFast(i, dt);
+		m_bounds[i] = m_localBounds[i].transformed(m_bodies[i]->getMesh().getModel());
+	}
+
+	m_time += dt;
+}
+
+// find the pairs of bodies that may touch, their contacts, and the
+// vertices of every body that are below the ground plane. The contacts
+// take the impulses of the same features last step, pairs that were not
+// seen this step are forgotten. Sleeping bodies are not tested, but keep
+// what the cache knows of them for when they wake
+void RigidWorld::detectCollisions()
+{
+	m_cache.beginStep();
+	updateShapes();
+	findPairs();
+	findContacts();
+
+	m_groundManifolds.resize(m_bodies.size());
+
+	getJobSystem().parallelFor(0, (unsigned int)m_bodies.size(), BODY_GRAIN, [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			if (m_asleep[i])
+				m_groundManifolds[i].count = 0;
+			else
+				collideGround(i, m_groundManifolds[i]);
+		}
+	});
+
+	for (unsigned int i = 0; i < m_groundManifolds.size(); i++)
+	{
+		if (m_asleep[i])
+			m_cache.touch(ContactSolver::STATIC_BODY, i);
+		else if (m_groundManifolds[i].count > 0)
+			ContactCache::matchImpulses(m_cache.touch(ContactSolver::STATIC_BODY, i).manifold, m_groundManifolds[i]);
+	}
+	m_cache.endStep();
+
+	buildIslands();
+}
+
+// world space box of every body, then the pairs from the chosen broadphase
+void RigidWorld::findPairs()
+{
+	const unsigned int n = (unsigned int)m_bodies.size();
+
+	// model space box of the bodies added since the last call
+	for (unsigned int i = (unsigned int)m_localBounds.size(); i < n; i++)
+	{
+		const CollisionHull &hull = m_bodies[i]->getHull();
+		Aabb box(hull.getPoint(0), hull.getPoint(0));
+		for (unsigned int k = 1; k < hull.size(); k++)
+		{
+			box.lower = glm::min(box.lower, hull.getPoint(k));
+			box.upper = glm::max(box.upper, hull.getPoint(k));
+		}
+		m_localBounds.push_back(box);
+	}
+
+	m_bounds.resize(n);
+	getJobSystem().parallelFor(0, n, BODY_GRAIN, [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			if (!isAsleep(i))
+				m_bounds[i] = m_localBounds[i].transformed(m_bodies[i]->getMesh().getModel());
+		}
+	});
+
+	switch (m_broadphase)
+	{
+	case BROADPHASE_SWEEP:
+		m_sweep.update(m_bounds.data(), n);
+		break;
+	case BROADPHASE_BRUTE:
+		findBrutePairs();
+		break;
+	default:
+		findTreePairs();
+		break;
+	}
+}
+
+// the tree is updated serially, then every body queries it in parallel and
+// keeps the bodies after it, so each pair is found once and the order does
+// not depend on the thread count
+void RigidWorld::findTreePairs()
+{
+	const unsigned int n = (unsigned int)m_bodies.size();
+
+	// new bodies get a proxy, the others move theirs
+	for (unsigned int i = 0; i < n; i++)
+	{
+		glm::vec3 pos = m_bodies[i]->getPos();
+		if (i < m_proxies.size())
+		{
+			m_tree.moveProxy(m_proxies[i], m_bounds[i], pos - m_lastPos[i]);
+			m_lastPos[i] = pos;
+		}
+		else
+		{
+			m_proxies.push_back(m_tree.createProxy(m_bounds[i], i));
+			m_lastPos.push_back(pos);
+		}
+	}
+
+	findChunkPairs([this](unsigned int i, std::vector<BodyPair> &found)
+	{
+		size_t first = found.size();
+		m_tree.query(m_tree.getFatAabb(m_proxies[i]), [&found, i](unsigned int j)
+		{
+			if (j > i)
+				found.push_back(BodyPair{ i, j });
+		});
+		// the traversal order depends on the tree, sort by the other body
+		std::sort(found.begin() + first, found.end(), [](const BodyPair &x, const BodyPair &y) { return x.b < y.b; });
+	});
+}
+
+// every body against every body after it, kept to compare the others against
+void RigidWorld::findBrutePairs()
+{
+	const unsigned int n = (unsigned int)m_bodies.size();
+	findChunkPairs([this, n](unsigned int i, std::vector<BodyPair> &found)
+	{
+		for (unsigned int j = i + 1; j < n; j++)
+		{
+			if (m_bounds[i].overlaps(m_bounds[j]))
+				found.push_back(BodyPair{ i, j });
+		}
+	});
+}
+
+// pairs of each body found in parallel, joined in body order
+void RigidWorld::findChunkPairs(const std::function<void(unsigned int, std::vector<BodyPair>&)> &bodyPairs)
+{
+	const unsigned int n = (unsigned int)m_bodies.size();
+	const unsigned int chunks = (n + BODY_GRAIN - 1) / BODY_GRAIN;
+	if (m_chunkPairs.size() < chunks)
+		m_chunkPairs.resize(chunks);
+
+	getJobSystem().parallelFor(0, n, BODY_GRAIN, [this, &bodyPairs](unsigned int begin, unsigned int end)
+	{
+		std::vector<BodyPair> &found = m_chunkPairs[begin / BODY_GRAIN];
+		found.clear();
+		for (unsigned int i = begin; i < end; i++)
+		{
+			bodyPairs(i, found);
+		}
+	});
+
+	m_pairs.clear();
+	for (unsigned int chunk = 0; chunk < chunks; chunk++)
+	{
+		m_pairs.insert(m_pairs.end(), m_chunkPairs[chunk].begin(), m_chunkPairs[chunk].end());
+	}
+}
+
+// shape of each body added since the last call, bodies without one use
+// the hull built from their mesh
+void RigidWorld::updateShapes()
+{
+	for (unsigned int i = (unsigned int)m_shapes.size(); i < m_bodies.size(); i++)
+	{
+		m_shapes.push_back(m_bodies[i]->getShape());
+	}
+}
+
+// two boxes are clipped against each other, other shapes go through GJK
+// and EPA, which start from the simplex the pair ended with in the last
+// step. A pair whose bodies have barely moved against each other since its
+// manifold was found keeps that manifold instead. Pairs of two sleeping
+// bodies are skipped, unless a contact found here wakes one of them
+void RigidWorld::findContacts()
+{
+	m_testedPairs = getPairs();
+	if (!std::is_sorted(m_testedPairs.begin(), m_testedPairs.end(), pairLess))
+		std::sort(m_testedPairs.begin(), m_testedPairs.end(), pairLess);
+
+	// entries of every pair first, none are added while the chunks run
+	const unsigned int pairs = (unsigned int)m_testedPairs.size();
+	m_pairEntries.resize(pairs);
+	m_pairReused.resize(pairs);
+	m_sleepingPairs.clear();
+	for (unsigned int p = 0; p < pairs; p++)
+	{
+		m_pairEntries[p] = &m_cache.touch(m_testedPairs[p].a, m_testedPairs[p].b);
+		m_pairReused[p] = 0;
+		if (isAsleep(m_testedPairs[p].a) && isAsleep(m_testedPairs[p].b))
+			m_sleepingPairs.push_back(p);
+	}
+
+	const unsigned int chunks = (pairs + PAIR_GRAIN - 1) / PAIR_GRAIN;
+	if (m_chunkContacts.size() < chunks)
+		m_chunkContacts.resize(chunks);
+	getJobSystem().parallelFor(0, pairs, PAIR_GRAIN, [this](unsigned int begin, unsigned int end)
+	{
+		std::vector<BodyContact> &found = m_chunkContacts[begin / PAIR_GRAIN];
+		found.clear();
+		for (unsigned int p = begin; p < end; p++)
+		{
+			const BodyPair &pair = m_testedPairs[p];
+			if (!isAsleep(pair.a) || !isAsleep(pair.b))
+				testPair(p, found);
+		}
+	});
+
+	m_contacts.clear();
+	for (unsigned int chunk = 0; chunk < chunks; chunk++)
+	{
+		m_contacts.insert(m_contacts.end(), m_chunkContacts[chunk].begin(), m_chunkContacts[chunk].end());
+	}
+
+	// a contact with a sleeping body wakes its island, whose skipped pairs
+	// are then tested and may wake further islands in turn
+	size_t woken = 0;
+	bool added = false;
+	while (woken < m_contacts.size())
+	{
+		for (; woken < m_contacts.size(); woken++)
+		{
+			if (isAsleep(m_contacts[woken].a))
+				wakeIsland(m_contacts[woken].a);
+			if (isAsleep(m_contacts[woken].b))
+				wakeIsland(m_contacts[woken].b);
+		}
+		for (unsigned int k = 0; k < m_sleepingPairs.size();)
+		{
+			const unsigned int p = m_sleepingPairs[k];
+			if (isAsleep(m_testedPairs[p].a) && isAsleep(m_testedPairs[p].b))
+			{
+				k++;
+				continue;
+			}
+			size_t count = m_contacts.size();
+			testPair(p, m_contacts);
+			added = added || m_contacts.size() > count;
+			m_sleepingPairs.erase(m_sleepingPairs.begin() + k);
+		}
+	}
+	if (added)
+		std::sort(m_contacts.begin(), m_contacts.end(), [](const BodyContact &x, const BodyContact &y) { return x.a < y.a || (x.a == y.a && x.b < y.b); });
+
+	m_reusedPairs = (unsigned int)std::count(m_pairReused.begin(), m_pairReused.end(), (unsigned char)1);
+}
+
+// contacts of tested pair p, added to found if they touch
+void RigidWorld::testPair(unsigned int p, std::vector<BodyContact> &found)
+{
+	const BodyPair &pair = m_testedPairs[p];
+	CachedPair &entry = *m_pairEntries[p];
+	RigidBody &bodyA = *m_bodies[pair.a];
+	RigidBody &bodyB = *m_bodies[pair.b];
+	const glm::mat3 rotationA = glm::mat3(bodyA.getMesh().getRotate());
+	const glm::mat3 rotationB = glm::mat3(bodyB.getMesh().getRotate());
+	const glm::vec3 positionA = bodyA.getMesh().getPos();
+	const glm::vec3 positionB = bodyB.getMesh().getPos();
+
+	BodyContact contact;
+	contact.a = pair.a;
+	contact.b = pair.b;
+	m_pairReused[p] = ContactCache::isStill(entry, rotationA, positionA, rotationB, positionB);
+	if (m_pairReused[p])
+	{
+		ContactCache::placeFound(entry, rotationA, positionA, contact.manifold);
+	}
+	else
+	{
+		findContact(pair, entry.gjk, contact.manifold);
+		ContactCache::storeFound(entry, contact.manifold, rotationA, positionA, rotationB, positionB);
+	}
+
+	ContactCache::matchImpulses(entry.manifold, contact.manifold);
+	entry.manifold.count = 0;
+	if (contact.manifold.count > 0)
+		found.push_back(contact);
+}
+
+// manifold of a pair of bodies, count 0 if they are apart
+void RigidWorld::findContact(const BodyPair &pair, GjkCache &gjk, ContactManifold &manifold)
+{
+	const ConvexShape *shapeA = m_shapes[pair.a];
+	const ConvexShape *shapeB = m_shapes[pair.b];
+	const glm::mat4 modelA = m_bodies[pair.a]->getMesh().getModel();
+	const glm::mat4 modelB = m_bodies[pair.b]->getMesh().getModel();
+
+	manifold.count = 0;
+	if (shapeA->getType() == SHAPE_BOX && shapeB->getType() == SHAPE_BOX)
+	{
+		OrientedBox a(static_cast<const BoxShape*>(shapeA)->getHalfExtents(), modelA);
+		OrientedBox b(static_cast<const BoxShape*>(shapeB)->getHalfExtents(), modelB);
+		if (!collideBoxes(a, b, manifold))
+			manifold.count = 0;
+		return;
+	}
+
+	GjkResult result;
+	if (computePenetration(PlacedShape(shapeA, modelA), PlacedShape(shapeB, modelB), &gjk, result))
+	{
+		manifold.normal = result.normal;
+		manifold.points[0] = ContactPoint{ 0.5f * (result.pointA + result.pointB), result.depth, 0 };
+		manifold.count = 1;
+	}
+}
+
+// solve the contacts found by detectCollisions(), with the ground and
+// between bodies, island by island, and keep the solved manifolds for the
+// next step
+void RigidWorld::respondCollisions(float dt)
+{
+	m_solverContacts = m_contacts;
+	for (unsigned int i = 0; i < m_groundManifolds.size(); i++)
+	{
+		if (m_groundManifolds[i].count > 0)
+			m_solverContacts.push_back(BodyContact{ ContactSolver::STATIC_BODY, i, m_groundManifolds[i] });
+	}
+
+	m_solver.solve(m_bodies, m_solverContacts, m_bodyIslands, getIslandCount(), m_cor, dt);
+
+	for (const BodyContact &contact : m_solverContacts)
+	{
+		CachedPair *entry = m_cache.find(contact.a, contact.b);
+		if (entry != nullptr)
+			entry->manifold = contact.manifold;
+	}
+}
+
+// semi-implicit Euler for translation and rotation, first the velocities
+void RigidWorld::integrateVelocity(RigidBody &rb, float dt)
+{
+	rb.setVel(rb.getVel() + dt * rb.getAcc());
+	rb.setAngVel(rb.getAngVel() + dt * rb.getAngAcc());
+}
+
+// then the position and rotation from the new velocities
+void RigidWorld::integratePosition(RigidBody &rb, float dt)
+{
+	// integration (translation)
+	rb.translate(rb.getVel() * dt);
+
+	// integration (rotation)
+	// update rotation matrix by the skew symmetric matrix of w
+	rb.setRotate(glm::mat4(advanceRotation(glm::mat3(rb.getRotate()), rb.getAngVel(), dt)));
+}
+
+/*
+** ISLANDS AND SLEEPING
+*/
+
+// islands of the awake bodies joined by this step's contacts, each in
+// body order, and the island of every awake body
+void RigidWorld::buildIslands()
+{
+	const unsigned int n = (unsigned int)m_bodies.size();
+
+	// union-find, the root of an island is its lowest body
+	m_parents.resize(n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		m_parents[i] = i;
+	}
+	for (const BodyContact &contact : m_contacts)
+	{
+		unsigned int a = findRoot(contact.a);
+		unsigned int b = findRoot(contact.b);
+		if (a != b)
+			m_parents[glm::max(a, b)] = glm::min(a, b);
+	}
+
+	m_awakeBodies = 0;
+	for (unsigned int i = 0; i < n; i++)
+	{
+		if (!m_asleep[i])
+		{
+			m_islandLabels[i] = findRoot(i);
+			m_awakeBodies++;
+		}
+	}
+
+	// the roots number the islands in body order
+	unsigned int islands = 0;
+	m_bodyIslands.resize(n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		m_bodyIslands[i] = ContactSolver::NO_ISLAND;
+		if (!m_asleep[i] && m_islandLabels[i] == i)
+			m_bodyIslands[i] = islands++;
+	}
+	m_islandStarts.assign(islands + 1, 0);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		if (!m_asleep[i])
+		{
+			m_bodyIslands[i] = m_bodyIslands[m_islandLabels[i]];
+			m_islandStarts[m_bodyIslands[i] + 1]++;
+		}
+	}
+	for (unsigned int k = 0; k < islands; k++)
+	{
+		m_islandStarts[k + 1] += m_islandStarts[k];
+	}
+	// each start is the cursor of its island while placing, ending up at
+	// the start of the next
+	m_islandBodies.resize(m_awakeBodies);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		if (!m_asleep[i])
+			m_islandBodies[m_islandStarts[m_bodyIslands[i]]++] = i;
+	}
+	for (unsigned int k = islands; k > 0; k--)
+	{
+		m_islandStarts[k] = m_islandStarts[k - 1];
+	}
+	m_islandStarts[0] = 0;
+}
+
+// how long each awake body has been still. An island whose bodies have all
+// been still for long enough goes to sleep with its velocities zeroed
+void RigidWorld::updateIslands(float dt)
+{
+	for (unsigned int i = 0; i < m_bodies.size(); i++)
+	{
+		if (m_asleep[i])
+			continue;
+		RigidBody *rb = m_bodies[i];
+		bool still = glm::length(rb->getVel()) < SLEEP_LINEAR && glm::length(rb->getAngVel()) < SLEEP_ANGULAR;
+		m_sleepTimes[i] = still ? m_sleepTimes[i] + dt : 0.0f;
+	}
+
+	// islands that have been still long enough sleep and leave the list
+	const unsigned int islands = getIslandCount();
+	unsigned int kept = 0;
+	unsigned int keptBodies = 0;
+	for (unsigned int k = 0; k < islands; k++)
+	{
+		const unsigned int begin = m_islandStarts[k];
+		const unsigned int end = m_islandStarts[k + 1];
+		float stillFor = m_sleepTimes[m_islandBodies[begin]];
+		for (unsigned int b = begin + 1; b < end; b++)
+		{
+			stillFor = glm::min(stillFor, m_sleepTimes[m_islandBodies[b]]);
+		}
+
+		if (m_sleeping && stillFor >= SLEEP_TIME)
+		{
+			for (unsigned int b = begin; b < end; b++)
+			{
+				const unsigned int i = m_islandBodies[b];
+				m_asleep[i] = 1;
+				m_sleepAccs[i] = m_bodies[i]->getAcc();
+				m_bodies[i]->setVel(glm::vec3(0.0f));
+				m_bodies[i]->setAngVel(glm::vec3(0.0f));
+			}
+			m_awakeBodies -= end - begin;
+			continue;
+		}
+
+		m_islandStarts[kept] = keptBodies;
+		for (unsigned int b = begin; b < end; b++)
+		{
+			m_islandBodies[keptBodies++] = m_islandBodies[b];
+		}
+		kept++;
+	}
+	m_islandStarts.resize(kept + 1);
+	m_islandStarts[kept] = keptBodies;
+	m_islandBodies.resize(keptBodies);
+}
+
+unsigned int RigidWorld::findRoot(unsigned int i)
+{
+	while (m_parents[i] != i)
+	{
+		m_parents[i] = m_parents[m_parents[i]];
+		i = m_parents[i];
+	}
+	return i;
+}
+
+// every sleeping body of the island body i belongs to, a linear scan as
+// islands wake rarely
+void RigidWorld::wakeIsland(unsigned int i)
+{
+	const unsigned int label = m_islandLabels[i];
+	for (unsigned int j = 0; j < m_asleep.size(); j++)
+	{
+		if (m_asleep[j] && m_islandLabels[j] == label)
+		{
+			m_asleep[j] = 0;
+			m_sleepTimes[j] = 0.0f;
+		}
+	}
+}
+
+void RigidWorld::wakeBody(unsigned int i)
+{
+	if (isAsleep(i))
+		wakeIsland(i);
+	if (i < m_sleepTimes.size())
+		m_sleepTimes[i] = 0.0f;
+}
+
+void RigidWorld::setSleeping(bool sleeping)
+{
+	m_sleeping = sleeping;
+	if (!sleeping)
+	{
+		std::fill(m_asleep.begin(), m_asleep.end(), (unsigned char)0);
+		std::fill(m_sleepTimes.begin(), m_sleepTimes.end(), 0.0f);
+	}
+}
+
+/*
+** CONTINUOUS COLLISION
+*/
+
+// move a fast body impact by impact through the step
+void RigidWorld::advanceFast(unsigned int i, float dt)
+{
+	RigidBody &rb = *m_bodies[i];
+	float remaining = dt;
+	for (unsigned int k = 0; k < CCD_IMPACTS && remaining > 0.0f; k++)
+	{
+		Impact impact;
+		if (!findImpact(i, remaining, impact))
+		{
+			integratePosition(rb, remaining);
+			return;
+		}
+		integratePosition(rb, impact.time);
+		// the next search sweeps from where the body has got to
+		m_bounds[i] = m_localBounds[i].transformed(rb.getMesh().getModel());
+		resolveImpact(i, impact);
+		remaining -= impact.time;
+		m_impacts++;
+	}
+}
+
+// conservative advancement against the ground and every body near the
+// path, which stay where they are. The distance to each is measured at the
+// pose the body will have at time t, and t moves on by that distance over
+// the fastest any point of the body can approach, so it never steps past
+// the first touch. Shapes that already overlap are left to the solver, but
+// shapes found overlapping later in the step, which the bound should not
+// allow but rotation and the distance tolerance can, are an impact at the
+// last time they were apart
+bool RigidWorld::findImpact(unsigned int i, float dt, Impact &impact)
+{
+	RigidBody &rb = *m_bodies[i];
+	const ConvexShape *shape = m_shapes[i];
+	const glm::vec3 v = rb.getVel();
+	const glm::vec3 w = rb.getAngVel();
+	const glm::vec3 pos = rb.getPos();
+
+	// furthest any point of the body is from its centre of rotation
+	const glm::mat3 basis = glm::mat3(rb.getMesh().getModel());
+	float radius = 0.0f;
+	for (unsigned int k = 0; k < 8; k++)
+	{
+		const Aabb &local = m_localBounds[i];
+		glm::vec3 corner((k & 1) ? local.upper.x : local.lower.x, (k & 2) ? local.upper.y : local.lower.y, (k & 4) ? local.upper.z : local.lower.z);
+		radius = glm::max(radius, glm::length(basis * corner));
+	}
+	const float spin = glm::length(w) * radius;
+
+	// distance at time t, normal from the other towards the body, and a point of the body
+	auto sweep = [&](const std::function<bool(float, float&, glm::vec3&, glm::vec3&)> &distance, unsigned int other)
+	{
+		float t = 0.0f;
+		float d;
+		glm::vec3 normal, point;
+		float apart = 0.0f;
+		glm::vec3 apartNormal, apartPoint;
+		for (unsigned int k = 0; k < CCD_ITERATIONS; k++)
+		{
+			if (!distance(t, d, normal, point))
+			{
+				if (k == 0)
+					return;
+				t = apart;
+				normal = apartNormal;
+				point = apartPoint;
+				break;
+			}
+			apart = t;
+			apartNormal = normal;
+			apartPoint = point;
+
+			// within the tolerance it is an impact once the nearest point closes
+			// in faster than the tolerance per step, until then it creeps on
+			float advance = d - CCD_TARGET;
+			if (d <= CCD_TARGET + CCD_TOLERANCE)
+			{
+				float speed = glm::dot(v + glm::cross(w, point - (pos + t * v)), normal);
+				if (speed * dt < -CCD_TOLERANCE)
+					break;
+				advance = CCD_TOLERANCE;
+			}
+
+			float closing = spin - glm::dot(v, normal);
+			if (closing <= 0.0f)
+				return;
+			t += advance / closing;
+			if (t >= glm::min(dt, impact.time))
+				return;
+		}
+		// out of iterations it stops where it has got to
+		if (t < impact.time)
+			impact = Impact{ t, other, normal, point };
+	};
+
+	impact.time = dt;
+
+	// the lowest point of the body against the ground plane
+	sweep([&](float t, float &d, glm::vec3 &normal, glm::vec3 &point)
+	{
+		PlacedShape placed(shape, advanceModel(rb, t));
+		point = placed.toWorld(placed.localSupport(glm::vec3(0.0f, -1.0f, 0.0f)));
+		d = point.y - m_groundHeight;
+		normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		return d > 0.0f;
+	}, ContactSolver::STATIC_BODY);
+
+	// the bodies whose boxes meet the box swept along the path, grown by
+	// how far the spin can carry any point
+	Aabb path = m_bounds[i];
+	path.lower = glm::min(path.lower, path.lower + dt * v) - glm::vec3(spin * dt + CCD_TARGET);
+	path.upper = glm::max(path.upper, path.upper + dt * v) + glm::vec3(spin * dt + CCD_TARGET);
+	for (unsigned int j = 0; j < m_bodies.size(); j++)
+	{
+		if (j == i || !path.overlaps(m_bounds[j]))
+			continue;
+		const glm::mat4 modelB = m_bodies[j]->getMesh().getModel();
+
+		GjkCache cache;
+		sweep([&](float t, float &d, glm::vec3 &normal, glm::vec3 &point)
+		{
+			GjkResult result;
+			if (computeDistance(PlacedShape(m_shapes[j], modelB), PlacedShape(shape, advanceModel(rb, t)), &cache, result))
+				return false;
+			d = result.distance;
+			normal = result.normal;
+			point = result.pointB;
+			return true;
+		}, j);
+	}
+
+	return impact.time < dt;
+}
+
+// a single impulse at the point of impact that stops the body closing in
+// on what it hit, or bounces it off by the coefficient of restitution.
+// Friction is left to the contact solver next step
+void RigidWorld::resolveImpact(unsigned int i, const Impact &impact)
+{
+	RigidBody &a = *m_bodies[i];
+	const glm::vec3 n = impact.normal;
+	const glm::vec3 ra = impact.point - a.getPos();
+	const glm::mat3 invInertiaA = a.getInvInertia();
+	glm::vec3 dv = a.getVel() + glm::cross(a.getAngVel(), ra);
+	float invMass = 1.0f / a.getMass();
+	glm::vec3 raxn = glm::cross(ra, n);
+	float effective = invMass + glm::dot(raxn, invInertiaA * raxn);
+
+	RigidBody *b = impact.other == ContactSolver::STATIC_BODY ? nullptr : m_bodies[impact.other];
+	glm::vec3 rb;
+	glm::mat3 invInertiaB;
+	if (b)
+	{
+		rb = impact.point - b->getPos();
+		invInertiaB = b->getInvInertia();
+		dv -= b->getVel() + glm::cross(b->getAngVel(), rb);
+		glm::vec3 rbxn = glm::cross(rb, n);
+		effective += 1.0f / b->getMass() + glm::dot(rbxn, invInertiaB * rbxn);
+	}
+
+	const float vn = glm::dot(dv, n);
+	if (vn >= 0.0f)
+		return;
+	const glm::vec3 impulse = (-(1.0f + m_cor) * vn / effective) * n;
+	a.setVel(a.getVel() + invMass * impulse);
+	a.setAngVel(a.getAngVel() + invInertiaA * glm::cross(ra, impulse));
+	if (b)
+	{
+		if (m_asleep[impact.other])
+			wakeIsland(impact.other);
+		b->setVel(b->getVel() - impulse / b->getMass());
+		b->setAngVel(b->getAngVel() - invInertiaB * glm::cross(rb, impulse));
+	}
+}
+
+// the points of the body below the ground plane, as a manifold from the
+// ground to the body
+void RigidWorld::collideGround(unsigned int i, ContactManifold &manifold)
+{
+	static thread_local std::vector<ContactPoint> s_points;
+	s_points.clear();
+	// the id of a point is the corner or hull vertex it came from
+	auto addPoint = [this](const glm::vec3 &point, unsigned int id)
+	{
+		if (point.y <= m_groundHeight)
+		{
+			float depth = m_groundHeight - point.y;
+			s_points.push_back(ContactPoint{ point + glm::vec3(0.0f, 0.5f * depth, 0.0f), depth, id });
+		}
+	};
+
+	// the corners of the shape, or for a round shape its lowest point
+	const ConvexShape *shape = m_shapes[i];
+	const glm::mat4 model = m_bodies[i]->getMesh().getModel();
+	if (shape->getType() == SHAPE_BOX)
+	{
+		OrientedBox box(static_cast<const BoxShape*>(shape)->getHalfExtents(), model);
+		for (unsigned int k = 0; k < 8; k++)
+		{
+			addPoint(box.getCorner(k), k);
+		}
+	}
+	else if (shape->getType() == SHAPE_HULL)
+	{
+		// the whole hull to world space in one batch, into scratch kept per thread
+		static thread_local std::vector<float> s_x, s_y, s_z;
+		const CollisionHull &hull = static_cast<const HullShape*>(shape)->getHull();
+		s_x.resize(hull.getPaddedSize());
+		s_y.resize(hull.getPaddedSize());
+		s_z.resize(hull.getPaddedSize());
+		hull.transform(model, s_x.data(), s_y.data(), s_z.data());
+		for (unsigned int k = 0; k < hull.size(); k++)
+		{
+			addPoint(glm::vec3(s_x[k], s_y[k], s_z[k]), k);
+		}
+	}
+	else
+	{
+		PlacedShape placed(shape, model);
+		addPoint(placed.toWorld(placed.localSupport(glm::vec3(0.0f, -1.0f, 0.0f))), 0);
+	}
+
+	manifold.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+	reduceContacts(s_points.data(), (unsigned int)s_points.size(), manifold.normal, manifold);
+}
+
+/*
+** BROADPHASE NAMES
+*/
+const char *getBroadphaseName(Broadphase broadphase)
+{
+	switch (broadphase)
+	{
+	case BROADPHASE_SWEEP:
+		return "sap";
+	case BROADPHASE_BRUTE:
+		return "brute";
+	default:
+		return "tree";
+	}
+}
+
+bool parseBroadphase(const char *name, Broadphase &broadphase)
+{
+	if (strcmp(name, "tree") == 0)
+		broadphase = BROADPHASE_TREE;
+	else if (strcmp(name, "sap") == 0)
+		broadphase = BROADPHASE_SWEEP;
+	else if (strcmp(name, "brute") == 0)
+		broadphase = BROADPHASE_BRUTE;
+	else
+		return false;
+
+	return true;
+}
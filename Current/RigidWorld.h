@@ -0,0 +1,184 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include "AabbTree.h"
+#include "BoxCollision.h"
+#include "ContactCache.h"
+#include "ContactSolver.h"
+#include "Gjk.h"
+#include "RigidBody.h"
+#include "SweepAndPrune.h"
+
+// how the world finds the pairs of bodies that may touch
+enum Broadphase
+{
+	BROADPHASE_TREE,	// dynamic AABB tree
+	BROADPHASE_SWEEP,	// incremental sweep and prune
+	BROADPHASE_BRUTE	// every pair of boxes
+};
+
+// name used on the command line ("tree", "sap", "brute")
+const char *getBroadphaseName(Broadphase broadphase);
+// false if the name is not one of them
+bool parseBroadphase(const char *name, Broadphase &broadphase);
+
+/*
+** RIGID WORLD CLASS
+** Owns the fixed step of a set of rigid bodies resting on a horizontal
+** ground plane: force evaluation, integration, plane collision detection
+** and the impulse response, which a ContactSolver works out for all the
+** contacts with the ground and between bodies together. Body pairs whose boxes overlap are found by
+** an AabbTree holding a fat box per body, by SweepAndPrune, or by testing
+** every pair. It holds no render state so it can be stepped with or
+** without a window. Pairs of boxes get a clipped manifold from the
+** separating axis test, other pairs are tested by GJK and EPA on each
+** body's convex shape, a hull of its mesh if it was not given one. A
+** ContactCache keeps the contacts of each pair from step to step.
+** Bodies flagged fast are moved last, one at a time, by conservative
+** advancement: each is stepped to its first time of impact with the
+** ground or another body, bounced off it, and moved on for the rest of
+** the step, so they cannot pass through anything thinner than their
+** motion in one step while every other body keeps the same large step.
+** Bodies joined by contacts form islands. An island whose bodies have all
+** been nearly still for a while goes to sleep: its bodies are no longer
+** integrated, tested or solved until an awake body touches one of them or
+** the forces on one of them change.
+*/
+class RigidWorld
+{
+public:
+	RigidWorld();
+	~RigidWorld();
+
+	/*
+	** GET AND SET METHODS
+	*/
+	std::vector<RigidBody*> &getBodies() { return m_bodies; }
+	float getGroundHeight() const { return m_groundHeight; }
+	float getCor() const { return m_cor; }
+	double getTime() const { return m_time; }
+	Broadphase getBroadphase() const { return m_broadphase; }
+	const AabbTree &getTree() const { return m_tree; }
+	const SweepAndPrune &getSweep() const { return m_sweep; }
+	ContactSolver &getSolver() { return m_solver; }
+	// contacts between bodies found by the last detectCollisions(), by a then b
+	const std::vector<BodyContact> &getContacts() const { return m_contacts; }
+	// pairs in the last detectCollisions() that kept their manifold from before, untested
+	unsigned int getReusedPairCount() const { return m_reusedPairs; }
+	// impacts of fast bodies found by the last integratePositions()
+	unsigned int getImpactCount() const { return m_impacts; }
+	bool getSleeping() const { return m_sleeping; }
+	bool isAsleep(unsigned int i) const { return i < m_asleep.size() && m_asleep[i]; }
+	// bodies not asleep
+	unsigned int getAwakeCount() const { return m_awakeBodies; }
+	// islands of awake bodies found by the last detectCollisions(), less those
+	// updateIslands() put to sleep. Island k holds the bodies from
+	// getIslandStarts()[k] up to getIslandStarts()[k + 1]
+	unsigned int getIslandCount() const { return m_islandStarts.empty() ? 0 : (unsigned int)m_islandStarts.size() - 1; }
+	const std::vector<unsigned int> &getIslandStarts() const { return m_islandStarts; }
+	const std::vector<unsigned int> &getIslandBodies() const { return m_islandBodies; }
+	const ContactCache &getCache() const { return m_cache; }
+	// pairs of bodies whose boxes overlapped in the last detectCollisions(),
+	// by a then b except for sweep and prune which keeps them in no order
+	const std::vector<BodyPair> &getPairs() const { return m_broadphase == BROADPHASE_SWEEP ? m_sweep.getPairs() : m_pairs; }
+
+	void setGroundHeight(float y) { m_groundHeight = y; }
+	void setCor(float e) { m_cor = e; }
+	// choose before the first step, the broadphases keep state from step to step
+	void setBroadphase(Broadphase broadphase) { m_broadphase = broadphase; }
+	// let still islands sleep, turning it off wakes every body
+	void setSleeping(bool sleeping);
+
+	/*
+	** OTHER METHODS
+	*/
+	void addBody(RigidBody *rb) { m_bodies.push_back(rb); }
+	// wake the island of a body, for instance after moving it by hand
+	void wakeBody(unsigned int i);
+
+	// advance every body by one fixed step
+	void step(float dt);
+
+	// individual phases of a step, in the order step() runs them
+	void applyForces(float dt);
+	void integrateVelocities(float dt);
+	void detectCollisions();
+	void respondCollisions(float dt);
+	void updateIslands(float dt);
+	void integratePositions(float dt);
+
+	// update the body boxes and collect the overlapping pairs
+	void findPairs();
+	// contacts of the pairs found by findPairs()
+	void findContacts();
+
+private:
+	// first time a fast body touches something while it moves
+	struct Impact
+	{
+		float time;				// from the start of the motion
+		unsigned int other;		// body it hits, STATIC_BODY for the ground
+		glm::vec3 normal;		// unit, from the other body towards the fast one
+		glm::vec3 point;		// world space, on the fast body
+	};
+
+	void integrateVelocity(RigidBody &rb, float dt);
+	void integratePosition(RigidBody &rb, float dt);
+	void advanceFast(unsigned int i, float dt);
+	bool findImpact(unsigned int i, float dt, Impact &impact);
+	void resolveImpact(unsigned int i, const Impact &impact);
+	void updateShapes();
+	void testPair(unsigned int p, std::vector<BodyContact> &found);
+	void findContact(const BodyPair &pair, GjkCache &gjk, ContactManifold &manifold);
+	void wakeIsland(unsigned int i);
+	unsigned int findRoot(unsigned int i);
+	void buildIslands();
+	void collideGround(unsigned int i, ContactManifold &manifold);
+	void findTreePairs();
+	void findBrutePairs();
+	void findChunkPairs(const std::function<void(unsigned int, std::vector<BodyPair>&)> &bodyPairs);
+
+	std::vector<RigidBody*> m_bodies;						// bodies simulated by the world (not owned)
+	std::vector<ContactManifold> m_groundManifolds;			// per body, its points below the ground this step
+
+	Broadphase m_broadphase;
+	AabbTree m_tree;
+	SweepAndPrune m_sweep;
+	std::vector<int> m_proxies;				// tree proxy of each body
+	std::vector<Aabb> m_localBounds;		// per body, box around the mesh in model space
+	std::vector<Aabb> m_bounds;				// per body, world space box this step
+	std::vector<glm::vec3> m_lastPos;		// per body, position at the last refit
+	std::vector<BodyPair> m_pairs;						// pairs found by the tree or brute force
+	std::vector<std::vector<BodyPair>> m_chunkPairs;	// pairs found by each chunk of bodies
+
+	std::vector<const ConvexShape*> m_shapes;			// per body, its shape or its own hull
+	std::vector<BodyPair> m_testedPairs;				// pairs given to the narrowphase, by a then b
+	std::vector<CachedPair*> m_pairEntries;				// per tested pair, its entry in m_cache
+	std::vector<unsigned char> m_pairReused;			// per tested pair, 1 if it kept its last manifold
+	unsigned int m_reusedPairs;
+	ContactCache m_cache;
+	std::vector<BodyContact> m_contacts;
+	std::vector<std::vector<BodyContact>> m_chunkContacts;	// contacts found by each chunk of pairs
+	std::vector<BodyContact> m_solverContacts;				// m_contacts then the ground contacts
+	ContactSolver m_solver;
+	std::vector<unsigned int> m_fastBodies;					// bodies swept to their impacts this step
+	unsigned int m_impacts;
+
+	bool m_sleeping;
+	std::vector<unsigned char> m_asleep;		// per body, 1 while its island sleeps
+	std::vector<float> m_sleepTimes;			// per body, time it has been nearly still
+	std::vector<glm::vec3> m_sleepAccs;			// per body, acceleration when it fell asleep
+	std::vector<unsigned char> m_wakeRequests;	// per body, its forces changed while asleep
+	std::vector<unsigned int> m_islandLabels;	// per body, a body of its island, kept while asleep
+	std::vector<unsigned int> m_parents;		// union-find forest of the awake bodies
+	std::vector<unsigned int> m_islandStarts;	// islands of awake bodies, as offsets into m_islandBodies
+	std::vector<unsigned int> m_islandBodies;
+	std::vector<unsigned int> m_bodyIslands;	// per body, its island this step, NO_ISLAND while asleep
+	std::vector<unsigned int> m_sleepingPairs;	// tested pairs skipped because both bodies sleep
+	unsigned int m_awakeBodies;
+
+	float m_groundHeight;	// y coordinate of the ground plane
+	float m_cor;			// coefficient of restitution of every contact
+	double m_time;			// simulated time
+};
@@ -0,0 +1,296 @@
+#include <cmath>
+#include "RoomKernel.h"
+#include "Simd.h"
+
+// tangential speed below which friction is taken against this instead, so
+// the division never sees zero
+static const float TINY_SPEED = 1.0e-6f;
+
+void Room::set(const glm::vec3 &centre, const glm::vec3 &size, float restitution, float friction)
+{
+	lower = centre - 0.5f * size;
+	upper = centre + 0.5f * size;
+	for (RoomWall &wall : walls)
+	{
+		wall.restitution = restitution;
+		wall.friction = friction;
+	}
+}
+
+/*
+** DISPATCH
+*/
+void collideRoom(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel)
+{
+	switch (getSimdLevel())
+	{
+	case SIMD_AVX2:
+		collideRoomAVX2(room, begin, end, pos, vel);
+		break;
+	case SIMD_SSE41:
+		collideRoomSSE41(room, begin, end, pos, vel);
+		break;
+	default:
+		collideRoomScalar(room, begin, end, pos, vel);
+		break;
+	}
+}
+
+/*
+** SCALAR
+*/
+
+// the walls across one axis first reflect the speed out through them,
+// dv = (1 + e) * speed out, then friction takes up to mu * dv off the speed
+// along them. The selects are written as the vector min, max and blend
+// pick, so every path agrees to the sign of a zero
+static inline void collideAxis(const RoomWall &low, const RoomWall &high, float lower, float upper, float &p, float &v, float &vb, float &vc)
+{
+	const bool below = p < lower;
+	const bool above = p > upper;
+	const float inside = p > lower ? p : lower;
+	p = inside < upper ? inside : upper;
+
+	float out = below ? 0.0f - v : (above ? v : 0.0f);
+	out = out > 0.0f ? out : 0.0f;
+	const float e = below ? low.restitution : high.restitution;
+	const float mu = below ? low.friction : high.friction;
+	const float dv = (1.0f + e) * out;
+	v = v + (below ? dv : 0.0f - dv);
+
+	// with no impulse keep is exactly 1, most particles skip the square root
+	if (dv > 0.0f)
+	{
+		const float tangent = std::sqrt(vb * vb + vc * vc);
+		float keep = 1.0f - (mu * dv) / (tangent > TINY_SPEED ? tangent : TINY_SPEED);
+		keep = keep > 0.0f ? keep : 0.0f;
+		vb = vb * keep;
+		vc = vc * keep;
+	}
+}
+
+void collideRoomScalar(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel)
+{
+	const RoomWall *walls = room.walls;
+	for (unsigned int i = begin; i < end; i++)
+	{
+		glm::vec3 &p = pos[i];
+		glm::vec3 &v = vel[i];
+		collideAxis(walls[WALL_LOWER_X], walls[WALL_UPPER_X], room.lower.x, room.upper.x, p.x, v.x, v.y, v.z);
+		collideAxis(walls[WALL_LOWER_Y], walls[WALL_UPPER_Y], room.lower.y, room.upper.y, p.y, v.y, v.z, v.x);
+		collideAxis(walls[WALL_LOWER_Z], walls[WALL_UPPER_Z], room.lower.z, room.upper.z, p.z, v.z, v.x, v.y);
+	}
+}
+
+#if SIMD_X86
+
+/*
+** SSE4.1, 4 particles at a time
+*/
+
+// the walls of one axis, broadcast
+struct RoomAxisSSE41
+{
+	__m128 lower, upper;
+	__m128 eLow, eHigh;
+	__m128 muLow, muHigh;
+};
+
+SIMD_TARGET_SSE41
+static inline void collideAxisSSE41(const RoomAxisSSE41 &axis, __m128 &p, __m128 &v, __m128 &vb, __m128 &vc)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	const __m128 below = _mm_cmplt_ps(p, axis.lower);
+	const __m128 above = _mm_cmpgt_ps(p, axis.upper);
+	p = _mm_min_ps(_mm_max_ps(p, axis.lower), axis.upper);
+
+	__m128 out = _mm_blendv_ps(_mm_and_ps(v, above), _mm_sub_ps(zero, v), below);
+	out = _mm_max_ps(out, zero);
+	const __m128 e = _mm_blendv_ps(axis.eHigh, axis.eLow, below);
+	const __m128 mu = _mm_blendv_ps(axis.muHigh, axis.muLow, below);
+	const __m128 dv = _mm_mul_ps(_mm_add_ps(one, e), out);
+	v = _mm_add_ps(v, _mm_blendv_ps(_mm_sub_ps(zero, dv), dv, below));
+
+	const __m128 tangent = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vb, vb), _mm_mul_ps(vc, vc)));
+	const __m128 keep = _mm_max_ps(_mm_sub_ps(one, _mm_div_ps(_mm_mul_ps(mu, dv), _mm_max_ps(tangent, _mm_set1_ps(TINY_SPEED)))), zero);
+	vb = _mm_mul_ps(vb, keep);
+	vc = _mm_mul_ps(vc, keep);
+}
+
+// 4 packed vec3 as x0y0z0x1 y1z1x2y2 z2x3y3z3 to one register per axis
+SIMD_TARGET_SSE41
+static inline void loadSSE41(const float *f, __m128 &x, __m128 &y, __m128 &z)
+{
+	const __m128 m0 = _mm_loadu_ps(f);
+	const __m128 m1 = _mm_loadu_ps(f + 4);
+	const __m128 m2 = _mm_loadu_ps(f + 8);
+	const __m128 xy = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+	const __m128 yz = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+	x = _mm_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+	z = _mm_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+SIMD_TARGET_SSE41
+static inline void storeSSE41(float *f, __m128 x, __m128 y, __m128 z)
+{
+	const __m128 xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+	const __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+	const __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+	_mm_storeu_ps(f, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+	_mm_storeu_ps(f + 4, _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)));
+	_mm_storeu_ps(f + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+SIMD_TARGET_SSE41
+void collideRoomSSE41(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel)
+{
+	RoomAxisSSE41 axes[3];
+	for (int a = 0; a < 3; a++)
+	{
+		axes[a].lower = _mm_set1_ps(room.lower[a]);
+		axes[a].upper = _mm_set1_ps(room.upper[a]);
+		axes[a].eLow = _mm_set1_ps(room.walls[2 * a].restitution);
+		axes[a].eHigh = _mm_set1_ps(room.walls[2 * a + 1].restitution);
+		axes[a].muLow = _mm_set1_ps(room.walls[2 * a].friction);
+		axes[a].muHigh = _mm_set1_ps(room.walls[2 * a + 1].friction);
+	}
+
+	unsigned int i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		float *p = &pos[i].x;
+		float *v = &vel[i].x;
+		__m128 px, py, pz, vx, vy, vz;
+		loadSSE41(p, px, py, pz);
+		loadSSE41(v, vx, vy, vz);
+
+		collideAxisSSE41(axes[0], px, vx, vy, vz);
+		collideAxisSSE41(axes[1], py, vy, vz, vx);
+		collideAxisSSE41(axes[2], pz, vz, vx, vy);
+
+		storeSSE41(p, px, py, pz);
+		storeSSE41(v, vx, vy, vz);
+	}
+
+	collideRoomScalar(room, i, end, pos, vel);
+}
+
+/*
+** AVX2, 8 particles at a time
+*/
+
+struct RoomAxisAVX2
+{
+	__m256 lower, upper;
+	__m256 eLow, eHigh;
+	__m256 muLow, muHigh;
+};
+
+SIMD_TARGET_AVX2
+static inline void collideAxisAVX2(const RoomAxisAVX2 &axis, __m256 &p, __m256 &v, __m256 &vb, __m256 &vc)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	const __m256 below = _mm256_cmp_ps(p, axis.lower, _CMP_LT_OQ);
+	const __m256 above = _mm256_cmp_ps(p, axis.upper, _CMP_GT_OQ);
+	p = _mm256_min_ps(_mm256_max_ps(p, axis.lower), axis.upper);
+
+	__m256 out = _mm256_blendv_ps(_mm256_and_ps(v, above), _mm256_sub_ps(zero, v), below);
+	out = _mm256_max_ps(out, zero);
+	const __m256 e = _mm256_blendv_ps(axis.eHigh, axis.eLow, below);
+	const __m256 mu = _mm256_blendv_ps(axis.muHigh, axis.muLow, below);
+	const __m256 dv = _mm256_mul_ps(_mm256_add_ps(one, e), out);
+	v = _mm256_add_ps(v, _mm256_blendv_ps(_mm256_sub_ps(zero, dv), dv, below));
+
+	const __m256 tangent = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(vb, vb), _mm256_mul_ps(vc, vc)));
+	const __m256 keep = _mm256_max_ps(_mm256_sub_ps(one, _mm256_div_ps(_mm256_mul_ps(mu, dv), _mm256_max_ps(tangent, _mm256_set1_ps(TINY_SPEED)))), zero);
+	vb = _mm256_mul_ps(vb, keep);
+	vc = _mm256_mul_ps(vc, keep);
+}
+
+// 8 packed vec3, the low half of each register takes the first 4 and the
+// high half the next 4, transposed as in the SSE4.1 path
+SIMD_TARGET_AVX2
+static inline void loadAVX2(const float *f, __m256 &x, __m256 &y, __m256 &z)
+{
+	const __m256 m0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f)), _mm_loadu_ps(f + 12), 1);
+	const __m256 m1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f + 4)), _mm_loadu_ps(f + 16), 1);
+	const __m256 m2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f + 8)), _mm_loadu_ps(f + 20), 1);
+	const __m256 xy = _mm256_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+	const __m256 yz = _mm256_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+	x = _mm256_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+	z = _mm256_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+SIMD_TARGET_AVX2
+static inline void storeAVX2(float *f, __m256 x, __m256 y, __m256 z)
+{
+	const __m256 xy = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+	const __m256 yz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+	const __m256 zx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+	const __m256 m0 = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+	const __m256 m1 = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+	const __m256 m2 = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+	_mm_storeu_ps(f, _mm256_castps256_ps128(m0));
+	_mm_storeu_ps(f + 4, _mm256_castps256_ps128(m1));
+	_mm_storeu_ps(f + 8, _mm256_castps256_ps128(m2));
+	_mm_storeu_ps(f + 12, _mm256_extractf128_ps(m0, 1));
+	_mm_storeu_ps(f + 16, _mm256_extractf128_ps(m1, 1));
+	_mm_storeu_ps(f + 20, _mm256_extractf128_ps(m2, 1));
+}
+
+SIMD_TARGET_AVX2
+void collideRoomAVX2(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel)
+{
+	RoomAxisAVX2 axes[3];
+	for (int a = 0; a < 3; a++)
+	{
+		axes[a].lower = _mm256_set1_ps(room.lower[a]);
+		axes[a].upper = _mm256_set1_ps(room.upper[a]);
+		axes[a].eLow = _mm256_set1_ps(room.walls[2 * a].restitution);
+		axes[a].eHigh = _mm256_set1_ps(room.walls[2 * a + 1].restitution);
+		axes[a].muLow = _mm256_set1_ps(room.walls[2 * a].friction);
+		axes[a].muHigh = _mm256_set1_ps(room.walls[2 * a + 1].friction);
+	}
+
+	unsigned int i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		float *p = &pos[i].x;
+		float *v = &vel[i].x;
+		__m256 px, py, pz, vx, vy, vz;
+		loadAVX2(p, px, py, pz);
+		loadAVX2(v, vx, vy, vz);
+
+		collideAxisAVX2(axes[0], px, vx, vy, vz);
+		collideAxisAVX2(axes[1], py, vy, vz, vx);
+		collideAxisAVX2(axes[2], pz, vz, vx, vy);
+
+		storeAVX2(p, px, py, pz);
+		storeAVX2(v, vx, vy, vz);
+	}
+
+	// the scalar tail is SSE code, leave the upper halves clean for it
+	_mm256_zeroupper();
+	collideRoomScalar(room, i, end, pos, vel);
+}
+
+#else
+
+// no x86 vector units, the dispatcher never selects these
+void collideRoomSSE41(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel)
+{
+	collideRoomScalar(room, begin, end, pos, vel);
+}
+
+void collideRoomAVX2(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel)
+{
+	collideRoomScalar(room, begin, end, pos, vel);
+}
+
+#endif // SIMD_X86
@@ -0,0 +1,50 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/*
+** ROOM KERNEL
+** Batched collision of particles with the six walls of an axis aligned
+** room (the roomCollision maths). Every particle is clamped into the room
+** with min and max, and on the walls it was outside of the velocity going
+** out is reflected by the wall's restitution and the velocity along the
+** wall is cut by Coulomb friction, through masks rather than branches.
+** The SSE4.1 path handles 4 particles per instruction and the AVX2 path 8,
+** chosen at runtime through getSimdLevel(), with a scalar loop for the
+** remainder and for CPUs without either. All paths perform the same IEEE
+** operations in the same order, so they give the same result.
+*/
+
+// walls of the room, in this order
+enum RoomWallIndex
+{
+	WALL_LOWER_X,
+	WALL_UPPER_X,
+	WALL_LOWER_Y,
+	WALL_UPPER_Y,
+	WALL_LOWER_Z,
+	WALL_UPPER_Z
+};
+
+struct RoomWall
+{
+	float restitution = 1.0f;	// fraction of the speed into the wall given back
+	float friction = 0.0f;		// Coulomb coefficient against the impulse of the wall
+};
+
+struct Room
+{
+	glm::vec3 lower = glm::vec3(0.0f);
+	glm::vec3 upper = glm::vec3(0.0f);
+	RoomWall walls[6];
+
+	// room of the given size around centre, every wall the same
+	void set(const glm::vec3 &centre, const glm::vec3 &size, float restitution = 1.0f, float friction = 0.0f);
+};
+
+// particles [begin, end) back into the room and off its walls
+void collideRoom(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel);
+
+// the individual paths, collideRoom() picks one of these
+void collideRoomScalar(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel);
+void collideRoomSSE41(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel);
+void collideRoomAVX2(const Room &room, unsigned int begin, unsigned int end, glm::vec3 *pos, glm::vec3 *vel);
@@ -0,0 +1,647 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "JobSystem.h"
+#include "Scene.h"
+
+// spring constants shared by the particle scenes (main.cpp values)
+static const float STIFF = 15.0f;
+static const float DAMPER = 10.0f;
+
+// particles per parallel chunk of the room pass
+static const unsigned int ROOM_GRAIN = 8192;
+
+// every particle back inside the room and off its walls (roomCollision),
+// in one branch free pass over the position and velocity arrays
+static void containParticles(ParticleSystem &ps, const Room &room)
+{
+	glm::vec3 *pos = ps.getPositions().data();
+	glm::vec3 *vel = ps.getVelocities().data();
+	getJobSystem().parallelFor(0, ps.size(), ROOM_GRAIN, [&room, pos, vel](unsigned int begin, unsigned int end)
+	{
+		collideRoom(room, begin, end, pos, vel);
+	});
+}
+
+// two triangles per square of an n by n sheet of particles, listed a row of
+// a strip of squares at a time, down one strip and back up the next, so
+// that any run of consecutive triangles, a patch of the self collider or a
+// leaf of a tree over them, is a compact piece of the cloth whatever the
+// size of the sheet
+static std::vector<glm::uvec3> getClothTriangles(unsigned int n)
+{
+	const unsigned int strip = 8;
+	std::vector<glm::uvec3> triangles;
+	triangles.reserve(2 * (n - 1) * (n - 1));
+	for (unsigned int stripCol = 0; stripCol + 1 < n; stripCol += strip)
+	{
+		const bool down = (stripCol / strip) % 2 == 0;
+		for (unsigned int k = 0; k + 1 < n; k++)
+		{
+			const unsigned int row = down ? k : n - 2 - k;
+			for (unsigned int col = stripCol; col < std::min(stripCol + strip, n - 1); col++)
+			{
+				unsigned int i = row * n + col;
+				triangles.push_back(glm::uvec3(i, i + n, i + 1));
+				triangles.push_back(glm::uvec3(i + 1, i + n, i + n + 1));
+			}
+		}
+	}
+	return triangles;
+}
+
+/*
+** CLOTH SCENE
+*/
+
+// height of the pinned row, or less for a sheet too short to reach the ground (m)
+static const float CLOTH_TOP = 4.0f;
+
+template <class Integrator>
+ClothScene<Integrator>::ClothScene(unsigned int n)
+{
+	m_n = n;
+	float rest = 0.5f;
+	float top = std::min(rest * (n - 1), CLOTH_TOP);
+
+	// sheet of particles hanging from row 0 at the top, which is pinned, and
+	// lying flat on the ground from where it reaches it. A large sheet does
+	// not fall from a height it has to stretch down from, its rows pile up
+	// gently where they slide in, so a benchmark run times the cloth settled
+	// on the ground at every size
+	m_particles.reserve(n * n);
+	for (unsigned int row = 0; row < n; row++)
+	{
+		float y = std::max(top - rest * row, 0.0f);
+		float z = std::max(rest * row - top, 0.0f);
+		for (unsigned int col = 0; col < n; col++)
+		{
+			m_particles.addParticle(glm::vec3(rest * col - 0.5f * rest * (n - 1), y, z), glm::vec3(0.0f), row == 0 ? 0.0f : 1.0f);
+		}
+	}
+
+	// every particle below the pinned row feels gravity
+	std::vector<unsigned int> hanging;
+	for (unsigned int i = n; i < n * n; i++)
+	{
+		hanging.push_back(i);
+	}
+	m_forces.addGravity(Gravity(glm::vec3(0.0f, -9.8f, 0.0f)), hanging);
+
+	// one spring per edge to the right and down neighbours
+	m_forces.getSprings().reserve(2 * n * (n - 1));
+	for (unsigned int row = 0; row < n; row++)
+	{
+		for (unsigned int col = 0; col < n; col++)
+		{
+			unsigned int i = row * n + col;
+			if (col + 1 < n && row > 0)
+				m_forces.addSpring(i, i + 1, STIFF, DAMPER, rest);
+			if (row + 1 < n)
+				m_forces.addSpring(i, i + n, STIFF, DAMPER, rest);
+		}
+	}
+
+	m_selfCollider.setTriangles(getClothTriangles(n));
+	m_selfCollider.setThickness(0.2f * rest);
+}
+
+template <class Integrator>
+ClothScene<Integrator>::~ClothScene()
+{
+}
+
+template <class Integrator>
+void ClothScene<Integrator>::step(float dt)
+{
+	m_timer.start();
+
+	// where the step starts from, for the self collision
+	m_start = m_particles.getPositions();
+	m_timer.lap(PHASE_COLLISION);
+
+	// forces and integration, timed by the integrator. The pinned row has
+	// no inverse mass and stays put
+	m_integrator.step(m_particles, m_forces, dt, &m_timer);
+
+	// the ground first, so cloth heaped on it keeps the layers the self
+	// collision holds apart rather than having them squashed onto it
+	collideGround();
+	m_selfCollider.detect(m_particles, m_start);
+	m_timer.lap(PHASE_COLLISION);
+
+	// pushing the layers apart may press the lowest one into the ground
+	m_selfCollider.respond(m_particles);
+	collideGround();
+	m_timer.lap(PHASE_RESPONSE);
+
+	m_time += dt;
+}
+
+template <class Integrator>
+void ClothScene<Integrator>::collideGround()
+{
+	std::vector<glm::vec3> &pos = m_particles.getPositions();
+	std::vector<glm::vec3> &vel = m_particles.getVelocities();
+	for (unsigned int i = m_n; i < m_particles.size(); i++)
+	{
+		if (pos[i].y <= 0.0f)
+		{
+			pos[i].y = 0.0f;
+			vel[i].y = std::max(vel[i].y, 0.0f);
+		}
+	}
+}
+
+/*
+** DRAPE SCENE
+*/
+
+// cloth and box sizes (m), the box's path and the cloth's springs
+static const float DRAPE_WIDTH = 2.4f;
+static const float DRAPE_HEIGHT = 1.6f;
+static const float DRAPE_BOX = 1.0f;
+static const float DRAPE_SWAY = 0.6f;		// farthest the box slides from the centre
+static const float DRAPE_FREQUENCY = 0.8f;	// of the slide, rad/s
+static const float DRAPE_TURN = 0.4f;		// turn of the box, rad/s
+static const float DRAPE_MASS = 0.001f;		// per particle
+static const float DRAPE_STIFF = 250.0f;
+static const float DRAPE_DAMPER = 0.02f;
+
+// horizontal n x n sheet of particles at the drape height, none pinned,
+// with springs along the edges to the right and down neighbours and across
+// both diagonals of every square against shear. n is at least 2. Returns
+// the spacing
+static float addDrapeCloth(unsigned int n, ParticleSystem &particles, ForcePipeline &forces)
+{
+	float rest = DRAPE_WIDTH / (n - 1);
+
+	particles.reserve(n * n);
+	std::vector<unsigned int> all;
+	for (unsigned int row = 0; row < n; row++)
+	{
+		for (unsigned int col = 0; col < n; col++)
+		{
+			all.push_back(row * n + col);
+			particles.addParticle(glm::vec3(rest * col - 0.5f * DRAPE_WIDTH, DRAPE_HEIGHT, rest * row - 0.5f * DRAPE_WIDTH), glm::vec3(0.0f), DRAPE_MASS);
+		}
+	}
+	forces.addGravity(Gravity(glm::vec3(0.0f, -9.8f, 0.0f)), all);
+
+	forces.getSprings().reserve(4 * n * (n - 1));
+	for (unsigned int row = 0; row < n; row++)
+	{
+		for (unsigned int col = 0; col < n; col++)
+		{
+			unsigned int i = row * n + col;
+			if (col + 1 < n)
+				forces.addSpring(i, i + 1, DRAPE_STIFF, DRAPE_DAMPER, rest);
+			if (row + 1 < n)
+				forces.addSpring(i, i + n, DRAPE_STIFF, DRAPE_DAMPER, rest);
+			if (col + 1 < n && row + 1 < n)
+			{
+				forces.addSpring(i, i + n + 1, DRAPE_STIFF, DRAPE_DAMPER, rest * std::sqrt(2.0f));
+				forces.addSpring(i + 1, i + n, DRAPE_STIFF, DRAPE_DAMPER, rest * std::sqrt(2.0f));
+			}
+		}
+	}
+	return rest;
+}
+
+template <class Integrator>
+DrapeScene<Integrator>::DrapeScene(unsigned int n)
+{
+	float rest = addDrapeCloth(n, m_particles, m_forces);
+
+	// the box rests on the ground under the middle of the cloth
+	m_box.setMesh(Mesh(Mesh::CUBE));
+	m_box.scale(glm::vec3(0.5f * DRAPE_BOX));
+	m_box.setPos(glm::vec3(0.0f, 0.5f * DRAPE_BOX, 0.0f));
+	m_meshCollider.addBody(&m_box);
+	m_meshCollider.setCloth(getClothTriangles(n));
+	m_meshCollider.setThickness(0.5f * rest);
+}
+
+template <class Integrator>
+DrapeScene<Integrator>::~DrapeScene()
+{
+}
+
+template <class Integrator>
+void DrapeScene<Integrator>::step(float dt)
+{
+	m_timer.start();
+
+	// where the step starts from, and the box moved to where it ends
+	m_start = m_particles.getPositions();
+	const float t = (float)m_time + dt;
+	m_box.setPos(glm::vec3(DRAPE_SWAY * std::sin(DRAPE_FREQUENCY * t), 0.5f * DRAPE_BOX, 0.0f));
+	m_box.setVel(glm::vec3(DRAPE_SWAY * DRAPE_FREQUENCY * std::cos(DRAPE_FREQUENCY * t), 0.0f, 0.0f));
+	m_box.setRotate(glm::rotate(glm::mat4(1.0f), DRAPE_TURN * t, glm::vec3(0.0f, 1.0f, 0.0f)));
+	m_box.setAngVel(glm::vec3(0.0f, DRAPE_TURN, 0.0f));
+	m_timer.lap(PHASE_COLLISION);
+
+	// forces and integration, timed by the integrator. The box's contacts
+	// of the step before hold the cloth up between the substeps, they are
+	// planes and stay close enough while the box moves a step's worth
+	for (unsigned int k = 0; k < SUBSTEPS; k++)
+	{
+		m_integrator.step(m_particles, m_forces, dt / SUBSTEPS, &m_timer);
+		m_meshCollider.respond(m_particles);
+		m_timer.lap(PHASE_RESPONSE);
+	}
+
+	// the box and the ground plane
+	m_meshCollider.detect(m_particles, m_start, dt);
+	std::vector<glm::vec3> &pos = m_particles.getPositions();
+	m_contacts.clear();
+	for (unsigned int i = 0; i < m_particles.size(); i++)
+	{
+		if (pos[i].y <= 0.0f)
+		{
+			m_contacts.push_back(i);
+		}
+	}
+	m_timer.lap(PHASE_COLLISION);
+
+	// the ground has the last word, as in the hanging cloth
+	m_meshCollider.respond(m_particles);
+	std::vector<glm::vec3> &vel = m_particles.getVelocities();
+	for (unsigned int i : m_contacts)
+	{
+		pos[i].y = std::max(pos[i].y, 0.0f);
+		vel[i].y = std::max(vel[i].y, 0.0f);
+	}
+	m_timer.lap(PHASE_RESPONSE);
+
+	m_time += dt;
+}
+
+/*
+** DOME SCENE
+*/
+
+// the sphere's radius (m), and its field's cells and narrowest and widest
+// band in radii
+static const float DOME_RADIUS = 0.6f;
+static const float DOME_CELL = 1.0f / 48.0f;
+static const float DOME_BAND = 4.0f / 48.0f;
+static const float DOME_MAX_BAND = 8.0f / 48.0f;
+static const float DOME_FRICTION = 0.5f;
+// particles per parallel chunk of the field lookups
+static const unsigned int DOME_GRAIN = 1024;
+
+template <class Integrator>
+DomeScene<Integrator>::DomeScene(unsigned int n) : m_dome(Mesh::SPHERE)
+{
+	float rest = addDrapeCloth(n, m_particles, m_forces);
+
+	// the sphere rests on the ground under the middle of the cloth. The band
+	// is wider than the thickness and than a substep's fall, but no more than
+	// a few cells, as baking costs its volume. A coarse cloth is kept off the
+	// sphere by less than half its spacing rather than baked for minutes
+	float band = glm::clamp(rest, DOME_BAND * DOME_RADIUS, DOME_MAX_BAND * DOME_RADIUS);
+	m_thickness = std::min(0.5f * rest, 0.5f * band);
+	m_dome.scale(glm::vec3(DOME_RADIUS));
+	m_dome.setPos(glm::vec3(0.0f, DOME_RADIUS, 0.0f));
+	m_field.bake(m_dome, DOME_CELL * DOME_RADIUS, band);
+}
+
+template <class Integrator>
+DomeScene<Integrator>::~DomeScene()
+{
+}
+
+template <class Integrator>
+void DomeScene<Integrator>::step(float dt)
+{
+	m_timer.start();
+
+	// forces and integration, timed by the integrator, each substep ending
+	// with every particle near the sphere pushed out of it
+	for (unsigned int k = 0; k < SUBSTEPS; k++)
+	{
+		m_integrator.step(m_particles, m_forces, dt / SUBSTEPS, &m_timer);
+		glm::vec3 *pos = m_particles.getPositions().data();
+		glm::vec3 *vel = m_particles.getVelocities().data();
+		getJobSystem().parallelFor(0, m_particles.size(), DOME_GRAIN, [&](unsigned int begin, unsigned int end)
+		{
+			m_field.collide(m_thickness, DOME_FRICTION, begin, end, pos, vel);
+		});
+		m_timer.lap(PHASE_RESPONSE);
+	}
+
+	// the ground plane has the last word
+	std::vector<glm::vec3> &pos = m_particles.getPositions();
+	std::vector<glm::vec3> &vel = m_particles.getVelocities();
+	for (unsigned int i = 0; i < m_particles.size(); i++)
+	{
+		if (pos[i].y <= 0.0f)
+		{
+			pos[i].y = 0.0f;
+			vel[i].y = std::max(vel[i].y, 0.0f);
+		}
+	}
+	m_timer.lap(PHASE_RESPONSE);
+
+	m_time += dt;
+}
+
+/*
+** CHAIN SCENE
+*/
+template <class Integrator>
+ChainScene<Integrator>::ChainScene(unsigned int n)
+{
+	float rest = 1.0f;
+
+	m_particles.reserve(n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		m_particles.addParticle(glm::vec3(0.0f, 10.0f - rest * i, 0.0f), glm::vec3(0.0f), i == 0 ? 0.0f : 1.0f);
+	}
+
+	// one spring between each pair of consecutive particles
+	std::vector<unsigned int> hanging;
+	for (unsigned int i = 1; i < n; i++)
+	{
+		hanging.push_back(i);
+		m_forces.addSpring(i - 1, i, STIFF, DAMPER, rest);
+	}
+	m_forces.addGravity(Gravity(glm::vec3(0.0f, -9.8f, 0.0f)), hanging);
+}
+
+template <class Integrator>
+ChainScene<Integrator>::~ChainScene()
+{
+}
+
+template <class Integrator>
+void ChainScene<Integrator>::step(float dt)
+{
+	m_timer.start();
+
+	// forces and integration, timed by the integrator. The top particle has
+	// no inverse mass and stays put
+	m_integrator.step(m_particles, m_forces, dt, &m_timer);
+
+	// the chain hangs freely, nothing to collide with
+	m_timer.lap(PHASE_COLLISION);
+	m_timer.lap(PHASE_RESPONSE);
+
+	m_time += dt;
+}
+
+/*
+** BOX SCENE
+*/
+BoxScene::BoxScene(unsigned int boxes) : m_boxShape(glm::vec3(1.0f))
+{
+	m_gravity = Gravity(glm::vec3(0.0f, -9.8f, 0.0f));
+
+	// lay the boxes out on a square grid so they fall side by side
+	unsigned int side = (unsigned int)std::ceil(std::sqrt((float)boxes));
+	float spacing = 4.0f;
+	float offset = 0.5f * spacing * (side - 1);
+
+	m_bodies.reserve(boxes);
+	for (unsigned int i = 0; i < boxes; i++)
+	{
+		RigidBody rb = RigidBody();
+		rb.setMesh(Mesh(Mesh::CUBE));
+		rb.setShape(&m_boxShape);
+		rb.setMass(2.0f);
+		rb.scale(glm::vec3(1.0f, 3.0f, 1.0f));
+		rb.translate(glm::vec3(spacing * (i % side) - offset, 5.0f, spacing * (i / side) - offset));
+		m_bodies.push_back(rb);
+	}
+
+	// pointers are taken once the vector has stopped growing
+	for (RigidBody &rb : m_bodies)
+	{
+		rb.addForce(&m_gravity);
+		m_world.addBody(&rb);
+	}
+	m_world.setGroundHeight(0.0f);
+	m_world.setCor(1.0f);
+}
+
+BoxScene::~BoxScene()
+{
+}
+
+void BoxScene::step(float dt)
+{
+	m_timer.start();
+	m_world.applyForces(dt);
+	m_timer.lap(PHASE_FORCE);
+	m_world.integrateVelocities(dt);
+	m_timer.lap(PHASE_INTEGRATION);
+	m_world.detectCollisions();
+	m_timer.lap(PHASE_COLLISION);
+	m_world.respondCollisions(dt);
+	m_world.updateIslands(dt);
+	m_timer.lap(PHASE_RESPONSE);
+	m_world.integratePositions(dt);
+	m_timer.lap(PHASE_INTEGRATION);
+
+	m_stats.accept(dt);
+	m_time += dt;
+}
+
+/*
+** PILE SCENE
+*/
+PileScene::PileScene(unsigned int piles) : BoxScene(0)
+{
+	// boxes per pile, and the distance between piles. Boxes of a toppled
+	// pile slide up to some 22 m, so two piles stay clear of each other
+	// even when they topple towards each other
+	const unsigned int height = 6;
+	const float spacing = 64.0f;
+
+	unsigned int side = (unsigned int)std::ceil(std::sqrt((float)piles));
+	float offset = 0.5f * spacing * (side - 1);
+
+	m_bodies.reserve(piles * height);
+	for (unsigned int i = 0; i < piles; i++)
+	{
+		glm::vec3 base = glm::vec3(spacing * (i % side) - offset, 0.0f, spacing * (i / side) - offset);
+		for (unsigned int j = 0; j < height; j++)
+		{
+			// each box a little off the one below and turned, so the column falls over
+			RigidBody rb = RigidBody();
+			rb.setMesh(Mesh(Mesh::CUBE));
+			rb.setShape(&m_boxShape);
+			rb.setMass(2.0f);
+			rb.translate(base + glm::vec3(0.3f * j, 1.5f + 2.5f * j, 0.1f * j));
+			rb.rotate(0.2f * j, glm::vec3(0.0f, 1.0f, 0.0f));
+			m_bodies.push_back(rb);
+		}
+	}
+
+	for (RigidBody &rb : m_bodies)
+	{
+		rb.addForce(&m_gravity);
+		m_world.addBody(&rb);
+	}
+	m_world.setCor(0.2f);
+}
+
+/*
+** CLOUD SCENE
+*/
+template <class Integrator>
+CloudScene<Integrator>::CloudScene(unsigned int n)
+{
+	m_boundsPos = glm::vec3(0.0f, 2.5f, 0.0f);
+	m_boundScale = glm::vec3(5.0f);
+	m_room.set(m_boundsPos, m_boundScale);
+
+	// fixed seed so every run simulates the same cloud
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> unit(-0.5f, 0.5f);
+
+	std::vector<unsigned int> all;
+	m_particles.reserve(n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		glm::vec3 pos = m_boundsPos + 0.9f * m_boundScale * glm::vec3(unit(generator), unit(generator), unit(generator));
+		glm::vec3 vel = 10.0f * glm::vec3(unit(generator), unit(generator), unit(generator));
+		m_particles.addParticle(pos, vel);
+		all.push_back(i);
+	}
+	m_forces.addGravity(Gravity(glm::vec3(0.0f, -9.8f, 0.0f)), all);
+}
+
+template <class Integrator>
+CloudScene<Integrator>::~CloudScene()
+{
+}
+
+template <class Integrator>
+void CloudScene<Integrator>::step(float dt)
+{
+	m_timer.start();
+
+	// forces and integration, timed by the integrator
+	m_integrator.step(m_particles, m_forces, dt, &m_timer);
+
+	// particles that left the room go back against the wall, finding and
+	// answering the contacts is one pass
+	containParticles(m_particles, m_room);
+	m_timer.lap(PHASE_RESPONSE);
+
+	m_time += dt;
+}
+
+/*
+** GAS SCENE
+*/
+template <class Integrator>
+GasScene<Integrator>::GasScene(unsigned int n)
+{
+	// the room grows with the particle count so the density stays the same
+	float side = std::max(5.0f, 0.25f * std::cbrt((float)n));
+	m_boundsPos = glm::vec3(0.0f, 0.5f * side, 0.0f);
+	m_boundScale = glm::vec3(side);
+	m_room.set(m_boundsPos, m_boundScale);
+	m_collider.setRadius(0.05f);
+	m_collider.setCor(0.9f);
+
+	// fixed seed so every run simulates the same gas
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> unit(-0.5f, 0.5f);
+
+	m_particles.reserve(n);
+	for (unsigned int i = 0; i < n; i++)
+	{
+		glm::vec3 pos = m_boundsPos + 0.9f * m_boundScale * glm::vec3(unit(generator), unit(generator), unit(generator));
+		glm::vec3 vel = 4.0f * glm::vec3(unit(generator), unit(generator), unit(generator));
+		m_particles.addParticle(pos, vel);
+	}
+}
+
+template <class Integrator>
+GasScene<Integrator>::~GasScene()
+{
+}
+
+template <class Integrator>
+void GasScene<Integrator>::step(float dt)
+{
+	m_timer.start();
+
+	// no forces, the integrator only moves the particles
+	m_integrator.step(m_particles, m_forces, dt, &m_timer);
+
+	// overlapping pairs, then the pairs and the walls are answered
+	m_collider.detect(m_particles);
+	m_timer.lap(PHASE_COLLISION);
+
+	m_collider.respond(m_particles);
+	containParticles(m_particles, m_room);
+	m_timer.lap(PHASE_RESPONSE);
+
+	m_time += dt;
+}
+
+/*
+** SCENE FACTORY
+*/
+std::vector<std::string> getSceneNames()
+{
+	return { "cloth", "drape", "dome", "chain", "boxes", "piles", "cloud", "gas" };
+}
+
+std::vector<std::string> getIntegratorNames()
+{
+	return { SemiImplicitEuler::getName(), VelocityVerlet::getName(), RungeKutta4::getName(),
+		AdaptiveIntegrator<SemiImplicitEuler>::getName(), AdaptiveIntegrator<VelocityVerlet>::getName(), AdaptiveIntegrator<RungeKutta4>::getName() };
+}
+
+// the particle scene named name, built with the integrator given as template argument
+template <class Integrator>
+static Scene *createParticleScene(const std::string &name, unsigned int size)
+{
+	if (name == "cloth")
+		return new ClothScene<Integrator>(size);
+	// the drape cloth is spaced to span its width with at least two particles a side
+	if ((name == "drape" || name == "dome") && size < 2)
+		return nullptr;
+	if (name == "drape")
+		return new DrapeScene<Integrator>(size);
+	if (name == "dome")
+		return new DomeScene<Integrator>(size);
+	if (name == "chain")
+		return new ChainScene<Integrator>(size);
+	if (name == "cloud")
+		return new CloudScene<Integrator>(size);
+	if (name == "gas")
+		return new GasScene<Integrator>(size);
+
+	return nullptr;
+}
+
+Scene *createScene(const std::string &name, unsigned int size, const std::string &integrator)
+{
+	if (name == "boxes")
+		return integrator == SemiImplicitEuler::getName() ? new BoxScene(size) : nullptr;
+	if (name == "piles")
+		return integrator == SemiImplicitEuler::getName() ? new PileScene(size) : nullptr;
+
+	if (integrator == SemiImplicitEuler::getName())
+		return createParticleScene<SemiImplicitEuler>(name, size);
+	if (integrator == VelocityVerlet::getName())
+		return createParticleScene<VelocityVerlet>(name, size);
+	if (integrator == RungeKutta4::getName())
+		return createParticleScene<RungeKutta4>(name, size);
+	if (integrator == AdaptiveIntegrator<SemiImplicitEuler>::getName())
+		return createParticleScene<AdaptiveIntegrator<SemiImplicitEuler>>(name, size);
+	if (integrator == AdaptiveIntegrator<VelocityVerlet>::getName())
+		return createParticleScene<AdaptiveIntegrator<VelocityVerlet>>(name, size);
+	if (integrator == AdaptiveIntegrator<RungeKutta4>::getName())
+		return createParticleScene<AdaptiveIntegrator<RungeKutta4>>(name, size);
+
+	return nullptr;
+}
@@ -0,0 +1,311 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ClothCollider.h"
+#include "DistanceField.h"
+#include "Force.h"
+#include "ForcePipeline.h"
+#include "Integrator.h"
+#include "MeshCollider.h"
+#include "ParticleCollider.h"
+#include "ParticleSystem.h"
+#include "PhaseTimer.h"
+#include "RigidBody.h"
+#include "RigidWorld.h"
+#include "RoomKernel.h"
+
+/*
+** SCENE CLASS
+** A self contained simulation set up from the usual building blocks. Scenes
+** only know how to advance their state by a fixed step, they never draw, so
+** the same scene can run in the window, headless or in a benchmark.
+** The particle scenes take their integrator as a template argument.
+*/
+class Scene
+{
+public:
+	Scene() {}
+	virtual ~Scene() {}
+
+	// name used on the command line and in reports
+	virtual std::string getName() const = 0;
+	// number of simulated elements (bodies or particles)
+	virtual unsigned int getSize() const = 0;
+	// name of the integrator the scene was built with
+	virtual std::string getIntegratorName() const = 0;
+	// advance the scene by one fixed step
+	virtual void step(float dt) = 0;
+	// steps the integrator took, more than step() was called for adaptive ones
+	virtual const StepStats &getStepStats() const = 0;
+	// error tolerance of an adaptive integrator, others ignore it
+	virtual void setTolerance(float) {}
+	// broadphase of a rigid body scene, particle scenes ignore it
+	virtual void setBroadphase(Broadphase) {}
+	// velocity iterations of a rigid body scene's contact solver, particle scenes ignore it
+	virtual void setSolverIterations(unsigned int) {}
+	// whether still bodies of a rigid body scene may sleep, particle scenes ignore it
+	virtual void setSleeping(bool) {}
+
+	double getTime() const { return m_time; }
+	PhaseTimer &getTimer() { return m_timer; }
+
+protected:
+	double m_time = 0.0;	// simulated time
+	PhaseTimer m_timer;		// wall clock time spent in each phase of step()
+};
+
+/*
+** CLOTH SCENE
+** N x N particles joined to their four neighbours by Hooke springs and
+** hanging from a pinned top row, as in Old/5. Spring-Cloth, with the part
+** that reaches the ground lying on it. The cloth collides with itself as
+** well as the ground.
+*/
+template <class Integrator>
+class ClothScene : public Scene
+{
+public:
+	ClothScene(unsigned int n);
+	~ClothScene();
+
+	std::string getName() const { return "cloth"; }
+	unsigned int getSize() const { return m_particles.size(); }
+	std::string getIntegratorName() const { return Integrator::getName(); }
+	void step(float dt);
+	const StepStats &getStepStats() const { return m_integrator.getStats(); }
+	void setTolerance(float tolerance) { m_integrator.setTolerance(tolerance); }
+
+	ParticleSystem &getParticles() { return m_particles; }
+	ClothCollider &getSelfCollider() { return m_selfCollider; }
+
+private:
+	// particles below the ground back onto it, not moving down
+	void collideGround();
+
+	unsigned int m_n;						// particles per side
+	ParticleSystem m_particles;				// row major, row 0 is pinned
+	ForcePipeline m_forces;					// gravity and springs
+	Integrator m_integrator;
+	ClothCollider m_selfCollider;			// two triangles per square of four particles
+	std::vector<glm::vec3> m_start;			// positions at the start of the step
+};
+
+/*
+** DRAPE SCENE
+** A horizontal n x n cloth dropped onto a box that slides to and fro and
+** turns about the vertical, then onto the ground around it. The cloth
+** collides with the box through a MeshCollider, not with itself. It is
+** stiffer than the hanging cloth so it drapes rather than stretches, and
+** takes SUBSTEPS integrator steps per step to stay stable at that
+** stiffness, with collision once per step.
+*/
+template <class Integrator>
+class DrapeScene : public Scene
+{
+public:
+	// integrator steps per step
+	static const unsigned int SUBSTEPS = 10;
+
+	DrapeScene(unsigned int n);
+	~DrapeScene();
+
+	std::string getName() const { return "drape"; }
+	unsigned int getSize() const { return m_particles.size(); }
+	std::string getIntegratorName() const { return Integrator::getName(); }
+	void step(float dt);
+	const StepStats &getStepStats() const { return m_integrator.getStats(); }
+	void setTolerance(float tolerance) { m_integrator.setTolerance(tolerance); }
+
+	ParticleSystem &getParticles() { return m_particles; }
+	RigidBody &getBox() { return m_box; }
+	MeshCollider &getMeshCollider() { return m_meshCollider; }
+
+private:
+	ParticleSystem m_particles;				// row major
+	ForcePipeline m_forces;					// gravity, stretch and shear springs
+	Integrator m_integrator;
+	RigidBody m_box;						// moved by the scene, not simulated
+	MeshCollider m_meshCollider;			// the cloth, two triangles per square, against the box
+	std::vector<glm::vec3> m_start;			// positions at the start of the step
+	std::vector<unsigned int> m_contacts;	// particles below the ground this step
+};
+
+/*
+** DOME SCENE
+** The drape scene's cloth dropped onto a static sphere resting on the
+** ground, which it collides with through a DistanceField baked from the
+** sphere's mesh when the scene is built. A lookup per particle after every
+** substep keeps the cloth off the sphere, there is no detection pass.
+*/
+template <class Integrator>
+class DomeScene : public Scene
+{
+public:
+	// integrator steps per step, as in the drape scene
+	static const unsigned int SUBSTEPS = 10;
+
+	DomeScene(unsigned int n);
+	~DomeScene();
+
+	std::string getName() const { return "dome"; }
+	unsigned int getSize() const { return m_particles.size(); }
+	std::string getIntegratorName() const { return Integrator::getName(); }
+	void step(float dt);
+	const StepStats &getStepStats() const { return m_integrator.getStats(); }
+	void setTolerance(float tolerance) { m_integrator.setTolerance(tolerance); }
+
+	ParticleSystem &getParticles() { return m_particles; }
+	const Mesh &getDome() const { return m_dome; }
+	const DistanceField &getField() const { return m_field; }
+
+private:
+	ParticleSystem m_particles;		// row major
+	ForcePipeline m_forces;			// gravity, stretch and shear springs
+	Integrator m_integrator;
+	Mesh m_dome;					// the sphere, where it stays
+	DistanceField m_field;			// baked from m_dome
+	float m_thickness;				// kept between the cloth and the sphere
+};
+
+/*
+** CHAIN SCENE
+** A long chain of particles joined by Hooke springs hanging from a pinned
+** top particle, as in Old/4. Springs.
+*/
+template <class Integrator>
+class ChainScene : public Scene
+{
+public:
+	ChainScene(unsigned int n);
+	~ChainScene();
+
+	std::string getName() const { return "chain"; }
+	unsigned int getSize() const { return m_particles.size(); }
+	std::string getIntegratorName() const { return Integrator::getName(); }
+	void step(float dt);
+	const StepStats &getStepStats() const { return m_integrator.getStats(); }
+	void setTolerance(float tolerance) { m_integrator.setTolerance(tolerance); }
+
+	ParticleSystem &getParticles() { return m_particles; }
+
+private:
+	ParticleSystem m_particles;	// particle 0 is pinned
+	ForcePipeline m_forces;		// gravity and springs
+	Integrator m_integrator;
+};
+
+/*
+** BOX SCENE
+** M rigid boxes falling onto the ground plane, as in main.cpp.
+*/
+class BoxScene : public Scene
+{
+public:
+	BoxScene(unsigned int boxes);
+	~BoxScene();
+
+	std::string getName() const { return "boxes"; }
+	unsigned int getSize() const { return (unsigned int)m_bodies.size(); }
+	std::string getIntegratorName() const { return SemiImplicitEuler::getName(); }
+	void step(float dt);
+	const StepStats &getStepStats() const { return m_stats; }
+	void setBroadphase(Broadphase broadphase) { m_world.setBroadphase(broadphase); }
+	void setSolverIterations(unsigned int iterations) { m_world.getSolver().setVelocityIterations(iterations); }
+	void setSleeping(bool sleeping) { m_world.setSleeping(sleeping); }
+
+	RigidWorld &getWorld() { return m_world; }
+
+protected:
+	Gravity m_gravity;
+	BoxShape m_boxShape;	// the unit cube, scaled by each body's model matrix
+	std::vector<RigidBody> m_bodies;
+	RigidWorld m_world;
+	StepStats m_stats;	// one fixed step per step()
+};
+
+/*
+** PILE SCENE
+** N piles of boxes dropped in a tilted column each. The piles are further
+** apart than twice the distance a box slides when its pile topples, so
+** they never touch and every pile is an island of its own for the solver.
+*/
+class PileScene : public BoxScene
+{
+public:
+	PileScene(unsigned int piles);
+
+	std::string getName() const { return "piles"; }
+};
+
+/*
+** CLOUD SCENE
+** Free particles under gravity bouncing around inside the room bounds.
+*/
+template <class Integrator>
+class CloudScene : public Scene
+{
+public:
+	CloudScene(unsigned int n);
+	~CloudScene();
+
+	std::string getName() const { return "cloud"; }
+	unsigned int getSize() const { return m_particles.size(); }
+	std::string getIntegratorName() const { return Integrator::getName(); }
+	void step(float dt);
+	const StepStats &getStepStats() const { return m_integrator.getStats(); }
+	void setTolerance(float tolerance) { m_integrator.setTolerance(tolerance); }
+
+	ParticleSystem &getParticles() { return m_particles; }
+	// walls of the room, each with its own restitution and friction
+	Room &getRoom() { return m_room; }
+
+private:
+	ParticleSystem m_particles;
+	ForcePipeline m_forces;					// gravity
+	Integrator m_integrator;
+	glm::vec3 m_boundsPos;					// centre of the room
+	glm::vec3 m_boundScale;					// size of the room
+	Room m_room;							// walls at the bounds
+};
+
+/*
+** GAS SCENE
+** Particles of radius 0.05 with no gravity colliding with each other and
+** the walls of a room sized for the particle count.
+*/
+template <class Integrator>
+class GasScene : public Scene
+{
+public:
+	GasScene(unsigned int n);
+	~GasScene();
+
+	std::string getName() const { return "gas"; }
+	unsigned int getSize() const { return m_particles.size(); }
+	std::string getIntegratorName() const { return Integrator::getName(); }
+	void step(float dt);
+	const StepStats &getStepStats() const { return m_integrator.getStats(); }
+	void setTolerance(float tolerance) { m_integrator.setTolerance(tolerance); }
+
+	ParticleSystem &getParticles() { return m_particles; }
+	ParticleCollider &getCollider() { return m_collider; }
+	Room &getRoom() { return m_room; }
+
+private:
+	ParticleSystem m_particles;
+	ForcePipeline m_forces;					// empty
+	Integrator m_integrator;
+	ParticleCollider m_collider;			// particle-particle contacts
+	glm::vec3 m_boundsPos;					// centre of the room
+	glm::vec3 m_boundScale;					// size of the room
+	Room m_room;							// walls at the bounds
+};
+
+// names of the scenes and integrators createScene() knows about
+std::vector<std::string> getSceneNames();
+std::vector<std::string> getIntegratorNames();
+
+// create a scene from its name, the particle scenes are built with the named
+// integrator, the box scenes only with euler. Returns nullptr for an unknown
+// name, or a drape or dome scene smaller than 2
+Scene *createScene(const std::string &name, unsigned int size, const std::string &integrator = "euler");
@@ -6,6 +6,28 @@
 #include <sstream>
 #include <iostream>
 
+#ifdef HEADLESS
+
+// headless builds have no GL context: keep the GL handle types and a Shader
+// that only remembers its program id so meshes can still be copied around
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef float GLfloat;
+typedef char GLchar;
+
+class Shader
+{
+public:
+	GLuint Program = 0;
+
+	Shader() {}
+	Shader(const GLchar *, const GLchar *) {}
+
+	void Use() {}
+};
+
+#else
+
 #include <GL/glew.h>
 
 class Shader
@@ -98,4 +120,6 @@ public:
 	}
 };
 
+#endif // HEADLESS
+
 #endif
\ No newline at end of file
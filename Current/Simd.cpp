@@ -0,0 +1,104 @@
+#include <atomic>
+#include <cstring>
+#include "Simd.h"
+
+#if SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// selected level, -1 until first use. Kernels read it from the job system's
+// workers, and the first ones may detect it at the same time, which is
+// harmless as they all store the same level
+static std::atomic<int> s_level(-1);
+
+/*
+** DETECTION
+*/
+SimdLevel getSupportedSimdLevel()
+{
+#if SIMD_X86 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	// AVX registers are only usable when the OS saves them on context switch
+	bool avxState = osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+
+	bool avx2 = false;
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+
+	if (avx2 && avxState)
+		return SIMD_AVX2;
+	if (sse41)
+		return SIMD_SSE41;
+	return SIMD_SCALAR;
+#elif SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return SIMD_AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return SIMD_SSE41;
+	return SIMD_SCALAR;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+SimdLevel getSimdLevel()
+{
+	int level = s_level.load(std::memory_order_relaxed);
+	if (level < 0)
+	{
+		// only if no level was set meanwhile, which is then returned instead
+		int unset = -1;
+		level = getSupportedSimdLevel();
+		if (!s_level.compare_exchange_strong(unset, level, std::memory_order_relaxed))
+			level = unset;
+	}
+	return (SimdLevel)level;
+}
+
+void setSimdLevel(SimdLevel level)
+{
+	SimdLevel supported = getSupportedSimdLevel();
+	s_level.store(level < supported ? level : supported, std::memory_order_relaxed);
+}
+
+/*
+** NAMES
+*/
+const char *getSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SIMD_SSE41:
+		return "sse4.1";
+	case SIMD_AVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+bool parseSimdLevel(const char *name, SimdLevel &level)
+{
+	if (strcmp(name, "scalar") == 0)
+		level = SIMD_SCALAR;
+	else if (strcmp(name, "sse4.1") == 0)
+		level = SIMD_SSE41;
+	else if (strcmp(name, "avx2") == 0)
+		level = SIMD_AVX2;
+	else
+		return false;
+
+	return true;
+}
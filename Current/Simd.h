@@ -0,0 +1,46 @@
+#pragma once
+
+/*
+** SIMD SUPPORT
+** Runtime selection between the vector instruction sets a kernel has been
+** written for. Kernels are compiled for every level and the fastest one the
+** CPU supports is picked the first time getSimdLevel() is called, so one
+** binary runs everywhere. setSimdLevel() forces a lower level, which the
+** benchmark uses to compare paths.
+*/
+
+// x86 builds get the SSE4.1 and AVX2 kernels, anything else only the scalar ones
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+// GCC and Clang only emit vector instructions in functions marked for them,
+// MSVC accepts the intrinsics anywhere
+#if SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_SSE41
+#define SIMD_TARGET_AVX2
+#endif
+
+enum SimdLevel
+{
+	SIMD_SCALAR,
+	SIMD_SSE41,
+	SIMD_AVX2
+};
+
+// best level supported by this CPU and OS
+SimdLevel getSupportedSimdLevel();
+// level kernels should use, the supported level unless lowered with setSimdLevel()
+SimdLevel getSimdLevel();
+// select a level, clamped to what the CPU supports
+void setSimdLevel(SimdLevel level);
+
+const char *getSimdLevelName(SimdLevel level);
+// parse "scalar", "sse4.1" or "avx2", returns false for anything else
+bool parseSimdLevel(const char *name, SimdLevel &level);
@@ -0,0 +1,183 @@
+#include <cmath>
+#include "Simd.h"
+#include "SpringKernel.h"
+
+/*
+** DISPATCH
+*/
+void computeSpringForces(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz)
+{
+	switch (getSimdLevel())
+	{
+	case SIMD_AVX2:
+		computeSpringForcesAVX2(springs, begin, end, pos, vel, fx, fy, fz);
+		break;
+	case SIMD_SSE41:
+		computeSpringForcesSSE41(springs, begin, end, pos, vel, fx, fy, fz);
+		break;
+	default:
+		computeSpringForcesScalar(springs, begin, end, pos, vel, fx, fy, fz);
+		break;
+	}
+}
+
+/*
+** SCALAR
+*/
+
+// fsd = -ks * (l0 - l) - kd * (v1 - v2), force = fsd * e with e the unit vector from a to b
+void computeSpringForcesScalar(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz)
+{
+	for (unsigned int s = begin; s < end; s++)
+	{
+		unsigned int a = springs.a[s];
+		unsigned int b = springs.b[s];
+
+		glm::vec3 d = pos[b] - pos[a];
+		float length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+		if (length <= 0.0f)
+		{
+			fx[s] = 0.0f;
+			fy[s] = 0.0f;
+			fz[s] = 0.0f;
+			continue;
+		}
+		glm::vec3 e = d * (1.0f / length);
+
+		// relative velocity along the spring
+		glm::vec3 dv = vel[a] - vel[b];
+		float vRel = e.x * dv.x + e.y * dv.y + e.z * dv.z;
+
+		float fsd = -springs.ks[s] * (springs.rest[s] - length) - springs.kd[s] * vRel;
+		fx[s] = fsd * e.x;
+		fy[s] = fsd * e.y;
+		fz[s] = fsd * e.z;
+	}
+}
+
+#if SIMD_X86
+
+/*
+** SSE4.1, 4 springs at a time
+*/
+SIMD_TARGET_SSE41
+void computeSpringForcesSSE41(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	unsigned int s = begin;
+	for (; s + 4 <= end; s += 4)
+	{
+		const unsigned int *a = springs.a + s;
+		const unsigned int *b = springs.b + s;
+
+		// no gather before AVX2, load the lanes one by one
+		__m128 dx = _mm_sub_ps(_mm_set_ps(pos[b[3]].x, pos[b[2]].x, pos[b[1]].x, pos[b[0]].x), _mm_set_ps(pos[a[3]].x, pos[a[2]].x, pos[a[1]].x, pos[a[0]].x));
+		__m128 dy = _mm_sub_ps(_mm_set_ps(pos[b[3]].y, pos[b[2]].y, pos[b[1]].y, pos[b[0]].y), _mm_set_ps(pos[a[3]].y, pos[a[2]].y, pos[a[1]].y, pos[a[0]].y));
+		__m128 dz = _mm_sub_ps(_mm_set_ps(pos[b[3]].z, pos[b[2]].z, pos[b[1]].z, pos[b[0]].z), _mm_set_ps(pos[a[3]].z, pos[a[2]].z, pos[a[1]].z, pos[a[0]].z));
+		__m128 dvx = _mm_sub_ps(_mm_set_ps(vel[a[3]].x, vel[a[2]].x, vel[a[1]].x, vel[a[0]].x), _mm_set_ps(vel[b[3]].x, vel[b[2]].x, vel[b[1]].x, vel[b[0]].x));
+		__m128 dvy = _mm_sub_ps(_mm_set_ps(vel[a[3]].y, vel[a[2]].y, vel[a[1]].y, vel[a[0]].y), _mm_set_ps(vel[b[3]].y, vel[b[2]].y, vel[b[1]].y, vel[b[0]].y));
+		__m128 dvz = _mm_sub_ps(_mm_set_ps(vel[a[3]].z, vel[a[2]].z, vel[a[1]].z, vel[a[0]].z), _mm_set_ps(vel[b[3]].z, vel[b[2]].z, vel[b[1]].z, vel[b[0]].z));
+
+		// length, with zero length springs masked out
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+		__m128 valid = _mm_cmpgt_ps(length, zero);
+		__m128 safeLength = _mm_blendv_ps(one, length, valid);
+
+		// unit direction
+		__m128 invLength = _mm_div_ps(one, safeLength);
+		__m128 ex = _mm_mul_ps(dx, invLength);
+		__m128 ey = _mm_mul_ps(dy, invLength);
+		__m128 ez = _mm_mul_ps(dz, invLength);
+
+		// relative velocity along the spring
+		__m128 vRel = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, dvx), _mm_mul_ps(ey, dvy)), _mm_mul_ps(ez, dvz));
+
+		// fsd = -ks * (l0 - l) - kd * vRel
+		__m128 negKs = _mm_sub_ps(zero, _mm_loadu_ps(springs.ks + s));
+		__m128 fsd = _mm_sub_ps(_mm_mul_ps(negKs, _mm_sub_ps(_mm_loadu_ps(springs.rest + s), length)), _mm_mul_ps(_mm_loadu_ps(springs.kd + s), vRel));
+		fsd = _mm_and_ps(fsd, valid);
+
+		_mm_storeu_ps(fx + s, _mm_mul_ps(fsd, ex));
+		_mm_storeu_ps(fy + s, _mm_mul_ps(fsd, ey));
+		_mm_storeu_ps(fz + s, _mm_mul_ps(fsd, ez));
+	}
+
+	computeSpringForcesScalar(springs, s, end, pos, vel, fx, fy, fz);
+}
+
+/*
+** AVX2, 8 springs at a time
+*/
+SIMD_TARGET_AVX2
+void computeSpringForcesAVX2(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const float *p = &pos[0].x;
+	const float *v = &vel[0].x;
+
+	unsigned int s = begin;
+	for (; s + 8 <= end; s += 8)
+	{
+		// float offsets of the ends, vec3 is three packed floats
+		__m256i ia = _mm256_loadu_si256((const __m256i *)(springs.a + s));
+		__m256i ib = _mm256_loadu_si256((const __m256i *)(springs.b + s));
+		ia = _mm256_add_epi32(ia, _mm256_add_epi32(ia, ia));
+		ib = _mm256_add_epi32(ib, _mm256_add_epi32(ib, ib));
+
+		__m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(p, ib, 4), _mm256_i32gather_ps(p, ia, 4));
+		__m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(p + 1, ib, 4), _mm256_i32gather_ps(p + 1, ia, 4));
+		__m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(p + 2, ib, 4), _mm256_i32gather_ps(p + 2, ia, 4));
+		__m256 dvx = _mm256_sub_ps(_mm256_i32gather_ps(v, ia, 4), _mm256_i32gather_ps(v, ib, 4));
+		__m256 dvy = _mm256_sub_ps(_mm256_i32gather_ps(v + 1, ia, 4), _mm256_i32gather_ps(v + 1, ib, 4));
+		__m256 dvz = _mm256_sub_ps(_mm256_i32gather_ps(v + 2, ia, 4), _mm256_i32gather_ps(v + 2, ib, 4));
+
+		// length, with zero length springs masked out
+		__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+		__m256 valid = _mm256_cmp_ps(length, zero, _CMP_GT_OQ);
+		__m256 safeLength = _mm256_blendv_ps(one, length, valid);
+
+		// unit direction
+		__m256 invLength = _mm256_div_ps(one, safeLength);
+		__m256 ex = _mm256_mul_ps(dx, invLength);
+		__m256 ey = _mm256_mul_ps(dy, invLength);
+		__m256 ez = _mm256_mul_ps(dz, invLength);
+
+		// relative velocity along the spring
+		__m256 vRel = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, dvx), _mm256_mul_ps(ey, dvy)), _mm256_mul_ps(ez, dvz));
+
+		// fsd = -ks * (l0 - l) - kd * vRel
+		__m256 negKs = _mm256_sub_ps(zero, _mm256_loadu_ps(springs.ks + s));
+		__m256 fsd = _mm256_sub_ps(_mm256_mul_ps(negKs, _mm256_sub_ps(_mm256_loadu_ps(springs.rest + s), length)), _mm256_mul_ps(_mm256_loadu_ps(springs.kd + s), vRel));
+		fsd = _mm256_and_ps(fsd, valid);
+
+		_mm256_storeu_ps(fx + s, _mm256_mul_ps(fsd, ex));
+		_mm256_storeu_ps(fy + s, _mm256_mul_ps(fsd, ey));
+		_mm256_storeu_ps(fz + s, _mm256_mul_ps(fsd, ez));
+	}
+
+	computeSpringForcesScalar(springs, s, end, pos, vel, fx, fy, fz);
+}
+
+#else
+
+// no x86 vector units, the dispatcher never selects these
+void computeSpringForcesSSE41(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz)
+{
+	computeSpringForcesScalar(springs, begin, end, pos, vel, fx, fy, fz);
+}
+
+void computeSpringForcesAVX2(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz)
+{
+	computeSpringForcesScalar(springs, begin, end, pos, vel, fx, fy, fz);
+}
+
+#endif // SIMD_X86
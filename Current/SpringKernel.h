@@ -0,0 +1,35 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/*
+** SPRING KERNEL
+** Batched damped spring evaluation (the Hooke::apply maths) over arrays of
+** springs: length, unit direction, relative velocity along the spring and
+** the resulting force. The SSE4.1 path handles 4 springs per instruction and
+** the AVX2 path 8, chosen at runtime through getSimdLevel(), with a scalar
+** loop for the remainder and for CPUs without either. All paths perform the
+** same IEEE operations in the same order, so they give the same result.
+*/
+
+// spring inputs, one array per attribute, indexed by spring
+struct SpringArrays
+{
+	const unsigned int *a;	// first end
+	const unsigned int *b;	// second end
+	const float *ks;		// stiffness
+	const float *kd;		// damping coefficient
+	const float *rest;		// rest length
+};
+
+// force on end a of every spring in [begin, end), end b receives the opposite,
+// written to fx, fy and fz at the spring index
+void computeSpringForces(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz);
+
+// the individual paths, computeSpringForces() picks one of these
+void computeSpringForcesScalar(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz);
+void computeSpringForcesSSE41(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz);
+void computeSpringForcesAVX2(const SpringArrays &springs, unsigned int begin, unsigned int end,
+	const glm::vec3 *pos, const glm::vec3 *vel, float *fx, float *fy, float *fz);
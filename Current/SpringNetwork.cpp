@@ -0,0 +1,118 @@
+#include "JobSystem.h"
+#include "SpringNetwork.h"
+
+// springs per parallel chunk
+static const unsigned int SPRING_GRAIN = 4096;
+
+SpringNetwork::SpringNetwork()
+{
+	m_colored = false;
+}
+
+SpringNetwork::~SpringNetwork()
+{
+}
+
+/*
+** STORAGE
+*/
+void SpringNetwork::reserve(unsigned int n)
+{
+	m_a.reserve(n);
+	m_b.reserve(n);
+	m_ks.reserve(n);
+	m_kd.reserve(n);
+	m_rest.reserve(n);
+}
+
+void SpringNetwork::clear()
+{
+	m_a.clear();
+	m_b.clear();
+	m_ks.clear();
+	m_kd.clear();
+	m_rest.clear();
+	m_coloring.clear();
+	m_colored = false;
+}
+
+unsigned int SpringNetwork::addSpring(unsigned int a, unsigned int b, float ks, float kd, float rest)
+{
+	m_a.push_back(a);
+	m_b.push_back(b);
+	m_ks.push_back(ks);
+	m_kd.push_back(kd);
+	m_rest.push_back(rest);
+	m_colored = false;
+
+	return size() - 1;
+}
+
+/*
+** PHYSICS
+*/
+
+SpringArrays SpringNetwork::getArrays() const
+{
+	SpringArrays arrays;
+	arrays.a = m_a.data();
+	arrays.b = m_b.data();
+	arrays.ks = m_ks.data();
+	arrays.kd = m_kd.data();
+	arrays.rest = m_rest.data();
+	return arrays;
+}
+
+const ElementColoring &SpringNetwork::getColoring() const
+{
+	if (!m_colored)
+	{
+		const unsigned int *ends[2] = { m_a.data(), m_b.data() };
+		colorElements(size(), 2, ends, m_coloring);
+		m_colored = true;
+	}
+	return m_coloring;
+}
+
+// the spring forces are computed in parallel batches by the SIMD kernel,
+// then +f goes to end a and -f to end b. Springs of one color never share
+// an end, so each color is scattered in parallel, and every particle adds
+// its spring forces in the same order whatever the number of threads
+void SpringNetwork::accumulate(const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *force) const
+{
+	const unsigned int n = size();
+	const ElementColoring &coloring = getColoring();
+	m_fx.resize(n);
+	m_fy.resize(n);
+	m_fz.resize(n);
+
+	const SpringArrays springs = getArrays();
+	float *fx = m_fx.data();
+	float *fy = m_fy.data();
+	float *fz = m_fz.data();
+	getJobSystem().parallelFor(0, n, SPRING_GRAIN, [&](unsigned int begin, unsigned int end)
+	{
+		computeSpringForces(springs, begin, end, pos, vel, fx, fy, fz);
+	});
+
+	auto scatter = [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int k = begin; k < end; k++)
+		{
+			unsigned int s = coloring.order[k];
+			glm::vec3 f = glm::vec3(fx[s], fy[s], fz[s]);
+			force[m_a[s]] += f;
+			force[m_b[s]] -= f;
+		}
+	};
+
+	for (unsigned int c = 0; c < coloring.getColorCount(); c++)
+	{
+		unsigned int begin = coloring.colorStart[c];
+		unsigned int end = coloring.colorStart[c + 1];
+		if (ElementColoring::isShared(c))
+			scatter(begin, end);
+		else
+			getJobSystem().parallelFor(begin, end, SPRING_GRAIN, scatter);
+	}
+}
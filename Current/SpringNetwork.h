@@ -0,0 +1,65 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "GraphColoring.h"
+#include "SpringKernel.h"
+
+/*
+** SPRING NETWORK CLASS
+** Damped springs stored once per edge as a pair of particle indices with
+** their stiffness, damping and rest length. Each spring force is computed
+** once and scattered to both ends, equal and opposite, so memory and work
+** grow with the number of edges rather than particles x neighbours.
+** The springs are colored so that springs of one color share no particle;
+** forces are computed in parallel and scattered one color at a time, which
+** gives the same result for any number of threads.
+*/
+class SpringNetwork
+{
+public:
+	SpringNetwork();
+	~SpringNetwork();
+
+	/*
+	** GET METHODS
+	*/
+	unsigned int size() const { return (unsigned int)m_a.size(); }
+	const std::vector<unsigned int> &getA() const { return m_a; }
+	const std::vector<unsigned int> &getB() const { return m_b; }
+	const std::vector<float> &getStiffness() const { return m_ks; }
+	const std::vector<float> &getDamping() const { return m_kd; }
+	const std::vector<float> &getRestLength() const { return m_rest; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// storage
+	void reserve(unsigned int n);
+	void clear();
+	// add a spring between particles a and b, returns its index
+	unsigned int addSpring(unsigned int a, unsigned int b, float ks, float kd, float rest);
+
+	// add the force of every spring to both of its ends
+	void accumulate(const glm::vec3 *pos, const glm::vec3 *vel, glm::vec3 *force) const;
+	// spring inputs in the layout the SIMD kernel reads
+	SpringArrays getArrays() const;
+	// springs grouped into colors with no shared particle
+	const ElementColoring &getColoring() const;
+
+private:
+	std::vector<unsigned int> m_a;	// first end
+	std::vector<unsigned int> m_b;	// second end
+	std::vector<float> m_ks;		// spring stiffness
+	std::vector<float> m_kd;		// damping coefficient
+	std::vector<float> m_rest;		// rest length
+
+	// per spring force computed by the kernel before it is scattered to the ends
+	mutable std::vector<float> m_fx;
+	mutable std::vector<float> m_fy;
+	mutable std::vector<float> m_fz;
+
+	// rebuilt on the first evaluation after springs are added
+	mutable ElementColoring m_coloring;
+	mutable bool m_colored;
+};
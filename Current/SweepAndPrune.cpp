@@ -0,0 +1,159 @@
+#include <utility>
+#include "SweepAndPrune.h"
+
+// ends at the same value sort lower first, so touching boxes overlap as they do in Aabb::overlaps
+static inline bool endpointLess(float aValue, bool aUpper, float bValue, bool bUpper)
+{
+	return aValue < bValue || (aValue == bValue && !aUpper && bUpper);
+}
+
+// pairs are stored with the lower index first
+static inline unsigned long long pairKey(unsigned int a, unsigned int b)
+{
+	return ((unsigned long long)a << 32) | b;
+}
+
+SweepAndPrune::SweepAndPrune()
+{
+	m_boxCount = 0;
+	m_swaps = 0;
+}
+
+SweepAndPrune::~SweepAndPrune()
+{
+}
+
+void SweepAndPrune::update(const Aabb *boxes, unsigned int n)
+{
+	m_added.clear();
+	m_removed.clear();
+	m_changeIndex.clear();
+	m_swaps = 0;
+
+	// new boxes start past the end of every axis, so sorting them in adds
+	// their pairs like any other box moving down
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (unsigned int b = m_boxCount; b < n; b++)
+		{
+			m_axes[axis].push_back(Endpoint{ boxes[b].lower[axis], b << 1 });
+			m_axes[axis].push_back(Endpoint{ boxes[b].upper[axis], (b << 1) | 1 });
+		}
+	}
+	m_boxCount = n;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		sortAxis(axis, boxes);
+	}
+}
+
+void SweepAndPrune::sortAxis(int axis, const Aabb *boxes)
+{
+	std::vector<Endpoint> &ends = m_axes[axis];
+
+	// refresh the values in place, the order is still the last step's
+	for (Endpoint &e : ends)
+	{
+		const Aabb &box = boxes[e.getBox()];
+		e.value = e.isUpper() ? box.upper[axis] : box.lower[axis];
+	}
+
+	for (unsigned int i = 1; i < ends.size(); i++)
+	{
+		const Endpoint moving = ends[i];
+		const bool movingUpper = moving.isUpper();
+		unsigned int j = i;
+		while (j > 0 && endpointLess(moving.value, movingUpper, ends[j - 1].value, ends[j - 1].isUpper()))
+		{
+			const Endpoint &passed = ends[j - 1];
+			const bool passedUpper = passed.isUpper();
+			if (!movingUpper && passedUpper)
+			{
+				// the boxes now overlap on this axis, they overlap if they do on the others too
+				unsigned int a = moving.getBox();
+				unsigned int b = passed.getBox();
+				if (boxes[a].overlaps(boxes[b]))
+					addPair(a, b);
+			}
+			else if (movingUpper && !passedUpper)
+			{
+				removePair(moving.getBox(), passed.getBox());
+			}
+
+			ends[j] = passed;
+			j--;
+			m_swaps++;
+		}
+		ends[j] = moving;
+	}
+}
+
+// a pair can be found on more than one axis in a step, it is only added
+// once. A pair removed earlier in the same update() is only taken back out
+// of the removed pairs
+void SweepAndPrune::addPair(unsigned int a, unsigned int b)
+{
+	if (a > b)
+		std::swap(a, b);
+	const unsigned long long key = pairKey(a, b);
+	if (!m_pairIndex.emplace(key, (unsigned int)m_pairs.size()).second)
+		return;
+
+	m_pairs.push_back(BodyPair{ a, b });
+	auto changed = m_changeIndex.find(key);
+	if (changed != m_changeIndex.end())
+	{
+		const unsigned int index = changed->second;
+		m_changeIndex.erase(changed);
+		unreport(m_removed, index);
+		return;
+	}
+	m_changeIndex[key] = (unsigned int)m_added.size();
+	m_added.push_back(BodyPair{ a, b });
+}
+
+// the last pair takes the place of the removed one
+void SweepAndPrune::removePair(unsigned int a, unsigned int b)
+{
+	if (a > b)
+		std::swap(a, b);
+	auto found = m_pairIndex.find(pairKey(a, b));
+	if (found == m_pairIndex.end())
+		return;
+
+	unsigned int index = found->second;
+	m_pairIndex.erase(found);
+	const BodyPair last = m_pairs.back();
+	m_pairs.pop_back();
+	if (index < m_pairs.size())
+	{
+		m_pairs[index] = last;
+		m_pairIndex[pairKey(last.a, last.b)] = index;
+	}
+
+	// likewise a pair added earlier in the same update()
+	const unsigned long long key = pairKey(a, b);
+	auto changed = m_changeIndex.find(key);
+	if (changed != m_changeIndex.end())
+	{
+		const unsigned int change = changed->second;
+		m_changeIndex.erase(changed);
+		unreport(m_added, change);
+		return;
+	}
+	m_changeIndex[key] = (unsigned int)m_removed.size();
+	m_removed.push_back(BodyPair{ a, b });
+}
+
+// the last reported pair takes the place of the one at index
+void SweepAndPrune::unreport(std::vector<BodyPair> &reported, unsigned int index)
+{
+	const BodyPair last = reported.back();
+	reported.pop_back();
+	if (index < reported.size())
+	{
+		reported[index] = last;
+		m_changeIndex[pairKey(last.a, last.b)] = index;
+	}
+}
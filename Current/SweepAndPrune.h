@@ -0,0 +1,71 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "Aabb.h"
+
+/*
+** SWEEP AND PRUNE CLASS
+** Incremental broadphase for boxes that move little from one step to the
+** next. The lower and upper ends of every box are kept sorted along each
+** of the three axes between steps, and update() restores the order with
+** an insertion sort. Two boxes can only start or stop overlapping when an
+** end of one passes an end of the other, which is exactly a swap of the
+** sort: a lower end passing an upper end downwards may add the pair, an
+** upper end passing a lower end downwards removes it. The work per step
+** is the refresh of the ends plus the number of swaps, and only the pairs
+** that changed are reported.
+** Boxes are numbered 0 to n - 1 and new ones are added by passing a larger
+** n to update(), they cannot be removed.
+*/
+class SweepAndPrune
+{
+public:
+	SweepAndPrune();
+	~SweepAndPrune();
+
+	/*
+	** GET METHODS
+	*/
+	unsigned int getBoxCount() const { return m_boxCount; }
+	// every overlapping pair, in no particular order
+	const std::vector<BodyPair> &getPairs() const { return m_pairs; }
+	// the pairs that started and stopped overlapping in the last update(),
+	// a pair that did both is in neither
+	const std::vector<BodyPair> &getAddedPairs() const { return m_added; }
+	const std::vector<BodyPair> &getRemovedPairs() const { return m_removed; }
+	// ends swapped by the last update(), summed over the axes
+	unsigned int getSwapCount() const { return m_swaps; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// the boxes are now boxes[0] to boxes[n - 1], n can only grow
+	void update(const Aabb *boxes, unsigned int n);
+
+private:
+	// one end of a box on one axis
+	struct Endpoint
+	{
+		float value;
+		unsigned int data;	// box index << 1, low bit set for an upper end
+
+		unsigned int getBox() const { return data >> 1; }
+		bool isUpper() const { return (data & 1) != 0; }
+	};
+
+	void sortAxis(int axis, const Aabb *boxes);
+	void addPair(unsigned int a, unsigned int b);
+	void removePair(unsigned int a, unsigned int b);
+	void unreport(std::vector<BodyPair> &reported, unsigned int index);
+
+	unsigned int m_boxCount;
+	std::vector<Endpoint> m_axes[3];	// sorted ends along x, y and z
+
+	std::vector<BodyPair> m_pairs;
+	std::unordered_map<unsigned long long, unsigned int> m_pairIndex;	// pair key to its place in m_pairs
+	std::vector<BodyPair> m_added;
+	std::vector<BodyPair> m_removed;
+	std::unordered_map<unsigned long long, unsigned int> m_changeIndex;	// pair key to its place in m_added or m_removed
+	unsigned int m_swaps;
+};
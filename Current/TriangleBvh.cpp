@@ -0,0 +1,103 @@
+#include <algorithm>
+#include "TriangleBvh.h"
+
+thread_local std::vector<unsigned int> TriangleBvh::s_stack;
+
+TriangleBvh::TriangleBvh()
+{
+}
+
+TriangleBvh::~TriangleBvh()
+{
+}
+
+/*
+** BUILD
+*/
+void TriangleBvh::build(const std::vector<glm::uvec3> &triangles, const glm::vec3 *points)
+{
+	m_nodes.clear();
+	m_order.resize(triangles.size());
+	if (triangles.empty())
+		return;
+
+	std::vector<glm::vec3> centres(triangles.size());
+	for (unsigned int t = 0; t < triangles.size(); t++)
+	{
+		m_order[t] = t;
+		centres[t] = (points[triangles[t].x] + points[triangles[t].y] + points[triangles[t].z]) / 3.0f;
+	}
+
+	// a binary tree with leaves of at least half LEAF_TRIANGLES
+	m_nodes.reserve(2 * (triangles.size() / (LEAF_TRIANGLES / 2) + 1));
+	buildNode(0, (unsigned int)triangles.size(), centres);
+	refit(triangles, points, points, 0.0f);
+}
+
+// the node over m_order[begin, end), then its children. The triangles are
+// split at the median centre along the longest axis of their centres' box
+void TriangleBvh::buildNode(unsigned int begin, unsigned int end, const std::vector<glm::vec3> &centres)
+{
+	const unsigned int index = (unsigned int)m_nodes.size();
+	m_nodes.push_back(Node());
+	if (end - begin <= LEAF_TRIANGLES)
+	{
+		m_nodes[index].first = begin;
+		m_nodes[index].count = end - begin;
+		return;
+	}
+
+	Aabb box(centres[m_order[begin]], centres[m_order[begin]]);
+	for (unsigned int k = begin + 1; k < end; k++)
+	{
+		box = Aabb::merge(box, Aabb(centres[m_order[k]], centres[m_order[k]]));
+	}
+	const glm::vec3 extent = box.getExtent();
+	const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+	// ties are broken by index so the tree does not depend on the sort
+	const unsigned int middle = begin + (end - begin) / 2;
+	std::nth_element(m_order.begin() + begin, m_order.begin() + middle, m_order.begin() + end,
+		[&centres, axis](unsigned int a, unsigned int b)
+	{
+		if (centres[a][axis] != centres[b][axis])
+			return centres[a][axis] < centres[b][axis];
+		return a < b;
+	});
+
+	buildNode(begin, middle, centres);
+	m_nodes[index].first = (unsigned int)m_nodes.size();
+	m_nodes[index].count = 0;
+	buildNode(middle, end, centres);
+}
+
+/*
+** REFIT
+*/
+void TriangleBvh::refit(const std::vector<glm::uvec3> &triangles, const glm::vec3 *points, const glm::vec3 *previous, float margin)
+{
+	// children come after their parent, so going backwards every node is
+	// reached after both of its children
+	for (unsigned int index = (unsigned int)m_nodes.size(); index-- > 0;)
+	{
+		Node &node = m_nodes[index];
+		if (!node.isLeaf())
+		{
+			node.box = Aabb::merge(m_nodes[index + 1].box, m_nodes[node.first].box);
+			continue;
+		}
+
+		glm::vec3 lower = points[triangles[m_order[node.first]].x];
+		glm::vec3 upper = lower;
+		for (unsigned int k = node.first; k < node.first + node.count; k++)
+		{
+			const glm::uvec3 &triangle = triangles[m_order[k]];
+			for (int c = 0; c < 3; c++)
+			{
+				lower = glm::min(lower, glm::min(points[triangle[c]], previous[triangle[c]]));
+				upper = glm::max(upper, glm::max(points[triangle[c]], previous[triangle[c]]));
+			}
+		}
+		node.box = Aabb(lower - margin, upper + margin);
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Aabb.h"
+
+/*
+** TRIANGLE BVH CLASS
+** Bounding volume hierarchy over a fixed set of triangles whose corners
+** move, the collider meshes of MeshCollider and the cloth they touch. It is
+** built once, top down, splitting every node's triangles at the median of
+** their centres along its longest axis, and afterwards only refit: the
+** leaves' boxes are recomputed from the new corners and each parent is the
+** merge of its children. A refit tree is always valid but only stays tight
+** while the mesh moves rigidly, one that deforms a lot should be rebuilt
+** now and then.
+** Nodes are stored depth first, every node's first child right after it,
+** so refitting is a single backward pass over the nodes.
+*/
+class TriangleBvh
+{
+public:
+	// most triangles in a leaf
+	static const unsigned int LEAF_TRIANGLES = 4;
+
+	TriangleBvh();
+	~TriangleBvh();
+
+	/*
+	** GET AND SET METHODS
+	*/
+	unsigned int getTriangleCount() const { return (unsigned int)m_order.size(); }
+	unsigned int getNodeCount() const { return (unsigned int)m_nodes.size(); }
+	// box around every triangle, as of the last refit
+	const Aabb &getBounds() const { return m_nodes[0].box; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// the tree over triangles, whose corners index points
+	void build(const std::vector<glm::uvec3> &triangles, const glm::vec3 *points);
+	// boxes around the triangles with their corners at both points and
+	// previous (the same array if they did not move), grown by margin
+	void refit(const std::vector<glm::uvec3> &triangles, const glm::vec3 *points, const glm::vec3 *previous, float margin);
+
+	// callback(triangle) for every triangle whose leaf box overlaps box
+	template <class Callback>
+	void query(const Aabb &box, Callback callback) const;
+
+private:
+	struct Node
+	{
+		Aabb box;
+		unsigned int first;		// first triangle in m_order for a leaf, second child otherwise
+		unsigned int count;		// triangles of a leaf, 0 otherwise
+
+		bool isLeaf() const { return count != 0; }
+	};
+
+	void buildNode(unsigned int begin, unsigned int end, const std::vector<glm::vec3> &centres);
+
+	std::vector<Node> m_nodes;
+	std::vector<unsigned int> m_order;	// triangles by leaf
+
+	// scratch for the traversals, one per thread
+	static thread_local std::vector<unsigned int> s_stack;
+};
+
+template <class Callback>
+void TriangleBvh::query(const Aabb &box, Callback callback) const
+{
+	if (m_order.empty())
+		return;
+
+	std::vector<unsigned int> &stack = s_stack;
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const unsigned int index = stack.back();
+		const Node &node = m_nodes[index];
+		stack.pop_back();
+		if (!node.box.overlaps(box))
+			continue;
+
+		if (node.isLeaf())
+		{
+			for (unsigned int k = node.first; k < node.first + node.count; k++)
+			{
+				callback(m_order[k]);
+			}
+		}
+		else
+		{
+			stack.push_back(node.first);
+			stack.push_back(index + 1);
+		}
+	}
+}
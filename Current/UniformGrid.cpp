@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cmath>
+#include "JobSystem.h"
+#include "UniformGrid.h"
+
+// particles or cells per parallel chunk
+static const unsigned int PARTICLE_GRAIN = 16384;
+static const unsigned int CELL_GRAIN = 4096;
+// cells summed by one job of the prefix sum
+static const unsigned int SCAN_BLOCK = 16384;
+
+UniformGrid::UniformGrid()
+{
+	m_origin = glm::vec3(0.0f);
+	m_cellSize = 1.0f;
+	m_dims = glm::ivec3(1);
+}
+
+UniformGrid::~UniformGrid()
+{
+}
+
+glm::ivec3 UniformGrid::getCell(const glm::vec3 &pos) const
+{
+	glm::ivec3 cell = glm::ivec3(glm::floor((pos - m_origin) / m_cellSize));
+	return glm::clamp(cell, glm::ivec3(0), m_dims - 1);
+}
+
+/*
+** BUILD
+*/
+void UniformGrid::build(const glm::vec3 *pos, unsigned int n, float minCellSize)
+{
+	JobSystem &jobs = getJobSystem();
+
+	// bounding box, one partial box per chunk so the result is the same for any thread count
+	const unsigned int chunks = std::max(1u, (n + PARTICLE_GRAIN - 1) / PARTICLE_GRAIN);
+	const glm::vec3 first = n > 0 ? pos[0] : glm::vec3(0.0f);
+	std::vector<glm::vec3> chunkMin(chunks, first);
+	std::vector<glm::vec3> chunkMax(chunks, first);
+	jobs.parallelFor(0, n, PARTICLE_GRAIN, [&](unsigned int begin, unsigned int end)
+	{
+		glm::vec3 lower = pos[begin];
+		glm::vec3 upper = pos[begin];
+		for (unsigned int i = begin + 1; i < end; i++)
+		{
+			lower = glm::min(lower, pos[i]);
+			upper = glm::max(upper, pos[i]);
+		}
+		chunkMin[begin / PARTICLE_GRAIN] = lower;
+		chunkMax[begin / PARTICLE_GRAIN] = upper;
+	});
+	glm::vec3 lower = chunkMin[0];
+	glm::vec3 upper = chunkMax[0];
+	for (unsigned int c = 1; c < chunks; c++)
+	{
+		lower = glm::min(lower, chunkMin[c]);
+		upper = glm::max(upper, chunkMax[c]);
+	}
+
+	// cells no smaller than asked for, grown until there are about two per particle
+	const double maxCells = 2.0 * n + 8.0;
+	glm::vec3 extent = upper - lower;
+	m_cellSize = std::max(minCellSize, std::cbrt(extent.x * extent.y * extent.z / (float)maxCells));
+	for (;;)
+	{
+		m_dims = glm::ivec3(glm::floor(extent / m_cellSize)) + 1;
+		if ((double)m_dims.x * m_dims.y * m_dims.z <= maxCells)
+			break;
+		m_cellSize *= 1.25f;
+	}
+	m_origin = lower;
+	const unsigned int cells = getCellCount();
+
+	// cell of every particle and the number of particles per cell
+	m_cellOf.resize(n);
+	if (m_count.size() < cells)
+		m_count = std::vector<std::atomic<unsigned int>>(cells);
+	jobs.parallelFor(0, cells, CELL_GRAIN, [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int c = begin; c < end; c++)
+		{
+			m_count[c].store(0, std::memory_order_relaxed);
+		}
+	});
+	jobs.parallelFor(0, n, PARTICLE_GRAIN, [this, pos](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			glm::ivec3 cell = getCell(pos[i]);
+			unsigned int c = (unsigned int)(cell.x + m_dims.x * (cell.y + m_dims.y * cell.z));
+			m_cellOf[i] = c;
+			m_count[c].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	// exclusive prefix sum of the counts: block totals, a scan of the
+	// totals, then each block writes its starts. The counts become the
+	// scatter cursors
+	const unsigned int blocks = (cells + SCAN_BLOCK - 1) / SCAN_BLOCK;
+	std::vector<unsigned int> blockStart(blocks + 1, 0);
+	jobs.parallelFor(0, blocks, 1, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b++)
+		{
+			unsigned int sum = 0;
+			for (unsigned int c = b * SCAN_BLOCK; c < std::min(cells, (b + 1) * SCAN_BLOCK); c++)
+			{
+				sum += m_count[c].load(std::memory_order_relaxed);
+			}
+			blockStart[b + 1] = sum;
+		}
+	});
+	for (unsigned int b = 0; b < blocks; b++)
+	{
+		blockStart[b + 1] += blockStart[b];
+	}
+	m_cellStart.resize(cells + 1);
+	m_cellStart[cells] = n;
+	jobs.parallelFor(0, blocks, 1, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int b = begin; b < end; b++)
+		{
+			unsigned int start = blockStart[b];
+			for (unsigned int c = b * SCAN_BLOCK; c < std::min(cells, (b + 1) * SCAN_BLOCK); c++)
+			{
+				m_cellStart[c] = start;
+				start += m_count[c].load(std::memory_order_relaxed);
+				m_count[c].store(m_cellStart[c], std::memory_order_relaxed);
+			}
+		}
+	});
+
+	// scatter, then put each cell back in particle order since the
+	// threads claimed the slots in whatever order they got there
+	m_sorted.resize(n);
+	jobs.parallelFor(0, n, PARTICLE_GRAIN, [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			m_sorted[m_count[m_cellOf[i]].fetch_add(1, std::memory_order_relaxed)] = i;
+		}
+	});
+	jobs.parallelFor(0, cells, CELL_GRAIN, [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int c = begin; c < end; c++)
+		{
+			// cells hold a handful of particles, insertion sort them
+			for (unsigned int k = m_cellStart[c] + 1; k < m_cellStart[c + 1]; k++)
+			{
+				unsigned int i = m_sorted[k];
+				unsigned int l = k;
+				for (; l > m_cellStart[c] && m_sorted[l - 1] > i; l--)
+				{
+					m_sorted[l] = m_sorted[l - 1];
+				}
+				m_sorted[l] = i;
+			}
+		}
+	});
+}
+
+/*
+** QUERY
+*/
+
+// cells are stored x fastest, so the three cells x - 1 to x + 1 of a row
+// are one range of the sorted arrays. The pairs of a cell are searched in
+// its own cell and x + 1, then in the rows (y + 1, z), (y - 1 to y + 1, z + 1)
+void UniformGrid::findPairs(const glm::vec3 *pos, float distance, std::vector<ParticlePair> &pairs)
+{
+	static const int rowsAhead[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+
+	const unsigned int cells = getCellCount();
+	const unsigned int chunks = (cells + CELL_GRAIN - 1) / CELL_GRAIN;
+	const float distance2 = distance * distance;
+	if (m_chunkPairs.size() < chunks)
+		m_chunkPairs.resize(chunks);
+
+	// positions in sorted order, so a range of cells is contiguous in memory
+	const unsigned int n = (unsigned int)m_sorted.size();
+	m_sortedPos.resize(n);
+	getJobSystem().parallelFor(0, n, PARTICLE_GRAIN, [this, pos](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int k = begin; k < end; k++)
+		{
+			m_sortedPos[k] = pos[m_sorted[k]];
+		}
+	});
+
+	getJobSystem().parallelFor(0, cells, CELL_GRAIN, [&](unsigned int begin, unsigned int end)
+	{
+		std::vector<ParticlePair> &found = m_chunkPairs[begin / CELL_GRAIN];
+		found.clear();
+		const glm::vec3 *sortedPos = m_sortedPos.data();
+
+		// test sorted entry k against the entries [first, last)
+		auto testRange = [&](unsigned int k, unsigned int first, unsigned int last)
+		{
+			const glm::vec3 p = sortedPos[k];
+			for (unsigned int l = first; l < last; l++)
+			{
+				glm::vec3 d = sortedPos[l] - p;
+				if (glm::dot(d, d) < distance2)
+					found.push_back(ParticlePair{ m_sorted[k], m_sorted[l] });
+			}
+		};
+
+		for (unsigned int c = begin; c < end; c++)
+		{
+			const unsigned int first = m_cellStart[c];
+			const unsigned int last = m_cellStart[c + 1];
+			if (first == last)
+				continue;
+
+			const int x = (int)(c % m_dims.x);
+			const int y = (int)((c / m_dims.x) % m_dims.y);
+			const int z = (int)(c / (m_dims.x * m_dims.y));
+			const int x0 = x > 0 ? x - 1 : 0;
+			const int x1 = x + 1 < m_dims.x ? x + 1 : x;
+
+			// the rest of the cell and the cell at x + 1
+			const unsigned int ownLast = m_cellStart[c + (x1 - x) + 1];
+			for (unsigned int k = first; k < last; k++)
+			{
+				testRange(k, k + 1, ownLast);
+			}
+
+			// the rows ahead
+			for (int r = 0; r < 4; r++)
+			{
+				const int oy = y + rowsAhead[r][0];
+				const int oz = z + rowsAhead[r][1];
+				if (oy < 0 || oy >= m_dims.y || oz >= m_dims.z)
+					continue;
+
+				const unsigned int row = (unsigned int)(m_dims.x * (oy + m_dims.y * oz));
+				const unsigned int rowFirst = m_cellStart[row + x0];
+				const unsigned int rowLast = m_cellStart[row + x1 + 1];
+				for (unsigned int k = first; k < last; k++)
+				{
+					testRange(k, rowFirst, rowLast);
+				}
+			}
+		}
+	});
+
+	// join the chunks in cell order
+	pairs.clear();
+	for (unsigned int chunk = 0; chunk < chunks; chunk++)
+	{
+		pairs.insert(pairs.end(), m_chunkPairs[chunk].begin(), m_chunkPairs[chunk].end());
+	}
+}
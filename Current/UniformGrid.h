@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <glm/glm.hpp>
+#include <vector>
+
+// two particles close enough to be tested for contact
+struct ParticlePair
+{
+	unsigned int a;
+	unsigned int b;
+};
+
+/*
+** UNIFORM GRID CLASS
+** Broadphase for particle-particle collisions. The box around the particles
+** is cut into cubic cells at least as wide as the contact distance, and the
+** particles are counting sorted by cell: count per cell, prefix sum, then
+** scatter. A contact can then only be with a particle in the same cell or
+** one of the 26 around it, and each pair is visited once by looking at the
+** cell itself and the 13 neighbours "ahead" of it, read as 5 contiguous
+** runs of cells from a copy of the positions in cell order. Building and querying
+** are linear in the number of particles and run on the job system; pairs
+** are written to buffers that keep their capacity from step to step.
+** The order of the particles within a cell, and so the order of the pairs,
+** does not depend on the number of threads.
+*/
+class UniformGrid
+{
+public:
+	UniformGrid();
+	~UniformGrid();
+
+	/*
+	** GET METHODS
+	*/
+	float getCellSize() const { return m_cellSize; }
+	glm::ivec3 getDimensions() const { return m_dims; }
+	unsigned int getCellCount() const { return (unsigned int)m_dims.x * m_dims.y * m_dims.z; }
+	// particle indices sorted by cell, cell c holds getSorted()[getCellStart()[c]] to getSorted()[getCellStart()[c + 1]]
+	const std::vector<unsigned int> &getSorted() const { return m_sorted; }
+	const std::vector<unsigned int> &getCellStart() const { return m_cellStart; }
+
+	/*
+	** OTHER METHODS
+	*/
+
+	// sort n particles into cells of at least minCellSize. Cells are made
+	// larger when the particles are spread out so the grid stays near 2n cells
+	void build(const glm::vec3 *pos, unsigned int n, float minCellSize);
+	// every pair of particles closer than distance (at most the cell size), replaces pairs
+	void findPairs(const glm::vec3 *pos, float distance, std::vector<ParticlePair> &pairs);
+
+private:
+	glm::ivec3 getCell(const glm::vec3 &pos) const;
+
+	glm::vec3 m_origin;		// lower corner of cell (0, 0, 0)
+	float m_cellSize;
+	glm::ivec3 m_dims;		// cells along each axis
+
+	std::vector<unsigned int> m_cellOf;				// cell of each particle
+	std::vector<std::atomic<unsigned int>> m_count;	// particles per cell, then the scatter cursor
+	std::vector<unsigned int> m_cellStart;			// first sorted entry of each cell
+	std::vector<unsigned int> m_sorted;				// particle indices grouped by cell
+	std::vector<glm::vec3> m_sortedPos;				// their positions in the same order
+
+	std::vector<std::vector<ParticlePair>> m_chunkPairs;	// pairs found by each chunk of cells
+};
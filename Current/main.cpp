@@ -25,6 +25,8 @@
 #include "Particle.h"
 #include "Force.h"
 #include "RigidBody.h"
+#include "RigidWorld.h"
+#include "JobSystem.h"
 
 // include 
 using namespace std;
@@ -61,25 +63,6 @@ float randf(float lo, float hi)
 	float r = random * diff;
 	return lo + r;
 }
-//Simplectic Euler integration
-void integrate(Particle &par, float dt)
-{
-	//Calc new Velocity
-	par.setVel(par.getVel() + par.getAcc() * dt);
-	//Translate
-	par.translate(par.getVel() * dt);
-}
-//Forward Euler integration
-void integrateForward(Particle &par, float dt)
-{
-	//Energy loss
-	float eLoss = 0.5f;
-	//Get prev Velocity
-	glm::vec3 preVel = par.getVel() * eLoss;
-	//Calc velocity
-	par.setVel(par.getVel() + dt * par.getAcc());
-	par.translate(dt * preVel);
-}
 // Apply impulse 
 void applyImpulse(RigidBody &rb, glm::vec3 magnitude, glm::vec3 r, glm::vec3 normal)
 {
@@ -185,8 +168,6 @@ int main()
 		
 	//impulse vars
 	float e = 1.0f;
-	std::vector<glm::vec3> collisionEdges; //Collision vertices
-	glm::vec3 coM; //Center of mass
 
 	//Shaders
 	Shader lambert = Shader("resources/shaders/physics.vert", "resources/shaders/physics.frag");
@@ -222,6 +203,15 @@ int main()
 	//add gravity to Rigidbody
 	rb.addForce(g);
 
+	//Run the physics step on every hardware thread
+	getJobSystem().setThreadCount(0);
+
+	//Let the world step the rigidbody against the ground plane
+	RigidWorld world;
+	world.addBody(&rb);
+	world.setGroundHeight(plane.getPos().y);
+	world.setCor(e);
+
 	cout << "Inertia matrix " << glm::to_string(rb.getInvInertia()) << endl;
 
 #pragma region GameLoop
@@ -252,92 +242,8 @@ int main()
 			**	SIMULATION
 			//*/
 
-			//intergration ( movement) 
-			//integration (translation)
-			rb.setAcc(rb.applyForces(rb.getPos(), rb.getVel(), time, dt));
-			rb.setVel(rb.getVel() + dt * rb.getAcc());
-			rb.translate(rb.getVel() * dt);
-
-			//integration ( rotation )
-			rb.setAngVel(rb.getAngVel() + deltaTime * rb.getAngAcc());
-
-			//create skew symmetric matrix for w
-			glm::mat3 angVelSkew = glm::matrixCross3(rb.getAngVel());
-
-			//create 3x3 rotation matrix from rb rotation matrix
-			glm::mat3 R = glm::mat3(rb.getRotate());
-
-			//update rotation matrix
-			R += deltaTime * angVelSkew *R;
-			R = glm::orthonormalize(R);
-			rb.setRotate(glm::mat4(R));
-						
-			//Collisions
-			//Plane collision
-			for (auto vertex : rb.getMesh().getVertices())
-			{
-				//mesh * coords = 3d co-orods
-				glm::vec3 coordinates = rb.getMesh().getModel() * glm::vec4(vertex.getCoord(), 1.0f);
-
-				//if collision
-				if (coordinates.y <= plane.getPos().y)
-				{
-					//Add to collisions
-					collisionEdges.push_back(coordinates);
-					isCollision = true;
-				}
-			}
-
-			//If there are collisions
-			if ((collisionEdges.size() != 0) && (isCollision))
-			{
-				//Vector for average of collision points
-				glm::vec3 averages;
-				//Vertex, 1 point
-				if (collisionEdges.size() == 1)
-					averages = collisionEdges[0];
-				//Edge, 2 points
-				else if (collisionEdges.size() == 2)
-					averages = (collisionEdges[0] + collisionEdges[1]) / 2;
-				//Face, 4 points
-				else if (collisionEdges.size() == 4)
-				{
-					averages = ((collisionEdges[0] + collisionEdges[1]) + (collisionEdges[2] + collisionEdges[3])) / 4;
-				}
-
-				//Print details
-				cout << "Average of collision: " << glm::to_string(averages) << endl;
-				cout << "Co-ordinates of colliding vertices: \n" << endl;
-				for (int i = 0; i < collisionEdges.size(); i++)
-				{
-					cout << i + 1 << " : " << glm::to_string(collisionEdges[i]) << endl;
-					if (i == 3)
-					{ 
-						i = collisionEdges.size();
-					}
-				}
-
-				//Shift first collision point of rb back to above the plane
-				rb.translate(glm::vec3(0.0f, plane.getPos().y - collisionEdges[0].y, 0.0f));
-
-				//Get r (Com and collision point)
-				glm::vec3 r = averages - rb.getPos();
-				//Get normal of the plane
-				glm::vec3 n = glm::vec3(0.0f, 1.0f, 0.0f);
-				//Get the r relative velocity (vel + (Angle Velocity Xross r)
-				glm::vec3 vr = rb.getVel() + glm::cross(rb.getAngVel(), r);
-				
-				//Calculate the impulse (jr)
-				float jr = (-(1.0f + e) * glm::dot(vr, n)) / ((1 / rb.getMass()) + glm::dot(n, (glm::cross(rb.getInvInertia()* glm::cross(r, n), r))));
-				
-				//Update velocity and angular velocity
-				rb.setVel(rb.getVel() + (jr / rb.getMass())*n);
-				rb.setAngVel(rb.getAngVel() + jr * rb.getInvInertia() * glm::cross(r, n));
-				//Clear Array
-				collisionEdges.clear();
-				//Change bool
-				isCollision = false;
-			}
+			//intergration, plane collision and impulse response
+			world.step(dt);
 			
 			//update time step
 			timeAccumulator -= dt;